@@ -27,14 +27,149 @@
 
 #include "TasmanianSparseGrid.hpp"
 #include <vector>
+#include <cstring>
+#include <cstdio>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if !defined(_WIN32) && !defined(WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define TSG_HAS_MMAP
+#endif
 
 namespace TasGrid{
 
+// the binary file starts with an 8 byte magic string (which cannot be confused with the text header),
+// followed by the version of the binary format and an endianness marker,
+// the data follows with all lists starting on 8 byte boundary and the file ends with an Adler-32 checksum of the data
+// version 2 files have the same layout, but the index lists are compressed (see twriteFrames()) and cannot be mapped
+static const char tsg_binary_magic[8] = { '\211', 'T', 'S', 'G', 'B', 'I', 'N', '\n' };
+static const int tsg_binary_version = 1;
+static const int tsg_binary_version_compressed = 2;
+static const int tsg_binary_endian = 0x01020304;
+static const int tsg_binary_header_size = 16;
+static const int tsg_binary_footer_size = 8;
+
+// the value log starts with a magic string, version and endianness marker (same as the binary file),
+// then the number of needed points, the number of outputs and a checksum of the needed points,
+// each record is the index of the needed point, a checksum of the record and the values
+static const char tsg_log_magic[8] = { '\211', 'T', 'S', 'G', 'L', 'O', 'G', '\n' };
+static const int tsg_log_version = 1;
+static const int tsg_log_header_size = 32;
+
+static unsigned int binaryChecksum( std::istream &ifs, std::streamoff start, std::streamoff end ){
+        const int chunk = 1048576;
+        std::vector<char> buffer_vec(chunk);
+        char *buffer = &buffer_vec[0];
+        unsigned int sum = 1;
+        ifs.seekg( start );
+        while( start < end ){
+                int size = ( end - start < chunk ) ? (int) (end - start) : chunk;
+                ifs.read( buffer, size );
+                if ( !ifs.good() ) return 0;
+                sum = tchecksum( sum, buffer, size );
+                start += size;
+        }
+        return sum;
+}
+
+// the stream buffers below let the binary format go through streams that cannot seek (pipes, sockets)
+// and through blocks of memory, the checksum is accumulated while the data passes through
+class ChecksumOutBuffer : public std::streambuf{ // forwards everything to the destination stream
+public:
+        ChecksumOutBuffer( std::ostream &destination ) : dest(destination), sum(1){}
+        unsigned int getChecksum() const{ return sum; }
+protected:
+        std::streamsize xsputn( const char *s, std::streamsize n ){
+                sum = tchecksum( sum, s, (size_t) n );
+                dest.write( s, n );
+                return ( dest.good() ) ? n : 0;
+        }
+        int overflow( int c ){
+                if ( c == traits_type::eof() ) return traits_type::not_eof( c );
+                char b = (char) c;
+                return ( xsputn( &b, 1 ) == 1 ) ? c : traits_type::eof();
+        }
+private:
+        std::ostream &dest;
+        unsigned int sum;
+};
+class ChecksumInBuffer : public std::streambuf{ // reads exactly what is requested from the source, so the footer stays in the source stream
+public:
+        ChecksumInBuffer( std::istream &source ) : src(source), sum(1){}
+        unsigned int getChecksum() const{ return sum; }
+protected:
+        std::streamsize xsgetn( char *s, std::streamsize n ){
+                std::streamsize done = 0;
+                if ( (n > 0) && (gptr() < egptr()) ){ // a character left over from underflow()
+                        *s = *gptr(); setg( 0, 0, 0 );
+                        done = 1;
+                }
+                src.read( s + done, n - done );
+                done += src.gcount();
+                sum = tchecksum( sum, s, (size_t) done );
+                return done;
+        }
+        int underflow(){
+                if ( gptr() < egptr() ) return traits_type::to_int_type( *gptr() );
+                if ( !src.get( c ) ) return traits_type::eof();
+                sum = tchecksum( sum, &c, 1 );
+                setg( &c, &c, &c + 1 );
+                return traits_type::to_int_type( c );
+        }
+private:
+        std::istream &src;
+        unsigned int sum;
+        char c;
+};
+class MemoryOutBuffer : public std::streambuf{ // appends to a vector
+public:
+        MemoryOutBuffer( std::vector<char> &destination ) : dest(destination){}
+protected:
+        std::streamsize xsputn( const char *s, std::streamsize n ){
+                dest.insert( dest.end(), s, s + n );
+                return n;
+        }
+        int overflow( int c ){
+                if ( c != traits_type::eof() ) dest.push_back( (char) c );
+                return traits_type::not_eof( c );
+        }
+private:
+        std::vector<char> &dest;
+};
+class MemoryInBuffer : public std::streambuf{ // reads from a block of memory in place, seeking is allowed
+public:
+        MemoryInBuffer( const char *buffer, size_t length ){
+                char *b = const_cast<char*>( buffer ); // the buffer is never written to
+                setg( b, b, b + length );
+        }
+protected:
+        std::streampos seekoff( std::streamoff off, std::ios_base::seekdir dir, std::ios_base::openmode which ){
+                if ( !(which & std::ios_base::in) ) return std::streampos( -1 );
+                std::streamoff pos = off;
+                if ( dir == std::ios_base::cur ){
+                        pos += gptr() - eback();
+                }else if ( dir == std::ios_base::end ){
+                        pos += egptr() - eback();
+                }
+                if ( (pos < 0) || (pos > egptr() - eback()) ) return std::streampos( -1 );
+                setg( eback(), eback() + pos, egptr() );
+                return std::streampos( pos );
+        }
+        std::streampos seekpos( std::streampos pos, std::ios_base::openmode which ){
+                return seekoff( std::streamoff( pos ), std::ios_base::beg, which );
+        }
+};
 const char* TasmanianSparseGrid::getVersion() const{ return "1.0"; }
 const char* TasmanianSparseGrid::getLicense() const{ return "License GPLv3"; }
 
 TasmanianSparseGrid::TasmanianSparseGrid() : global(0), plocal(0), grid(0), new_global(0), new_plocal(0), new_grid(0), rule(rule_base), transform_a(0), transform_b(0),
-                wavelet(0), new_wavelet(0), fgrid(0), new_fgrid(0)
+                wavelet(0), new_wavelet(0), fgrid(0), new_fgrid(0), mapped_file(0), mapped_length(0),
+                value_log(0), logged_values(0), logged(0), num_logged(0)
 {
         srand(time(0));
 }
@@ -43,19 +178,82 @@ TasmanianSparseGrid::~TasmanianSparseGrid (){
         clear();
 }
 
-void TasmanianSparseGrid::write( const char* filename ) const{ // write the grid to a file
-        std::ofstream ofs; ofs.open( filename );
-        write( ofs );
+void TasmanianSparseGrid::write( const char* filename, bool binary, bool compressed ) const{ // write the grid to a file
+        std::ofstream ofs;
+        if ( binary || compressed ){
+                ofs.open( filename, std::ios::out | std::ios::binary );
+        }else{
+                ofs.open( filename );
+        }
+        write( ofs, binary, compressed );
         ofs.close();
 }
-bool TasmanianSparseGrid::read( const char* filename ){ // reads the grid
-        std::ifstream ifs; ifs.open( filename );
-        bool pass = read( ifs );
-        ifs.close();
+bool TasmanianSparseGrid::read( const char* filename, bool memory_map ){ // reads the grid
+        bool pass;
+        if ( memory_map && mapBinaryFile( filename, pass ) ){
+                return pass;
+        }
+        std::ifstream ifs; ifs.open( filename, std::ios::in | std::ios::binary );
+        char magic[8];
+        ifs.read( magic, 8 );
+        if ( ifs.good() && (memcmp( magic, tsg_binary_magic, 8 ) == 0) ){
+                pass = readBinaryFile( ifs );
+                ifs.close();
+        }else{
+                ifs.close();
+                ifs.clear();
+                ifs.open( filename );
+                pass = readText( ifs );
+                ifs.close();
+        }
         return pass;
 }
 
-void TasmanianSparseGrid::write( std::ofstream &ofs ) const{ // adds the class to an already opened stream
+void TasmanianSparseGrid::write( std::ostream &ofs, bool binary, bool compressed ) const{ // adds the class to an already opened stream
+        if ( !binary && !compressed ){
+                writeText( ofs );
+                return;
+        }
+        ofs.write( tsg_binary_magic, 8 );
+        int header[2] = { (compressed) ? tsg_binary_version_compressed : tsg_binary_version, tsg_binary_endian };
+        twriteBinary( 2, header, ofs );
+        ChecksumOutBuffer buffer( ofs );
+        std::ostream cofs( &buffer );
+        writeBinary( cofs, compressed );
+        int footer[2] = { (int) buffer.getChecksum(), 0 };
+        twriteBinary( 2, footer, ofs );
+}
+bool TasmanianSparseGrid::read( std::istream &ifs ){
+        if ( ifs.peek() != (int) (unsigned char) tsg_binary_magic[0] ){
+                return readText( ifs );
+        }
+        char magic[8];
+        ifs.read( magic, 8 );
+        if ( !ifs.good() || (memcmp( magic, tsg_binary_magic, 8 ) != 0) ){ cerr << "ERROR: wrong binary file format code 1" << endl; return false; }
+        return readBinaryStream( ifs );
+}
+
+void TasmanianSparseGrid::writeBuffer( char* &buffer, size_t &length, bool compressed ) const{
+        std::vector<char> data;
+        MemoryOutBuffer mbuffer( data );
+        std::ostream ofs( &mbuffer );
+        write( ofs, true, compressed );
+        length = data.size();
+        if ( buffer != 0 ){ delete[] buffer; }
+        buffer = new char[length];
+        memcpy( buffer, &(data[0]), length );
+}
+bool TasmanianSparseGrid::readBuffer( const char *buffer, size_t length ){
+        MemoryInBuffer mbuffer( buffer, length );
+        std::istream ifs( &mbuffer );
+        if ( (length >= 8) && (memcmp( buffer, tsg_binary_magic, 8 ) == 0) ){
+                ifs.seekg( 8 );
+                return readBinaryFile( ifs ); // the whole buffer is available, verify the checksum before reading
+        }
+        return readText( ifs );
+}
+
+void TasmanianSparseGrid::writeText( std::ostream &ofs ) const{
         int num_dimension = getNumDimensions();
         ofs << "TASMANIAN SPARSE GRID version " << getVersion() << endl;
         ofs << "WARNING: do not edit this manually" << endl;
@@ -87,12 +285,11 @@ void TasmanianSparseGrid::write( std::ofstream &ofs ) const{ // adds the class t
         ofs << "NewGrid: ";
         if ( new_grid != 0 ){
                 ofs << "yes" << endl;
-                if ( rule == rule_pwpolynomial ){
+                if ( (rule == rule_pwpolynomial) || (rule == rule_pwpolynomial0) ){
                         new_plocal->write( ofs );
                 }else if( rule == rule_wavelet ){
                 	new_wavelet->write(ofs);
                 }else if ( rule == rule_fulltensor ){
-                        ofs << "FullTensor" << endl;
                         new_fgrid->write( ofs );
                 }else{
                         new_global->write( ofs );
@@ -101,7 +298,7 @@ void TasmanianSparseGrid::write( std::ofstream &ofs ) const{ // adds the class t
         }
         ofs << "TASMANIAN SPARSE GRID end" << endl;
 }
-bool TasmanianSparseGrid::read( std::ifstream &ifs ){
+bool TasmanianSparseGrid::readText( std::istream &ifs ){
         bool empty = false;
         bool pw = false, free_bound = true;
         bool gl = false;
@@ -177,7 +374,8 @@ bool TasmanianSparseGrid::read( std::ifstream &ifs ){
                 }
                 ifs >> T; if ( !(T.compare("NewGrid:") == 0) ){ cerr << "ERROR: wrong file format code 10" << endl; return false; }
                 ifs >> T;
-                if ( T.compare("yes") == 0 ){
+                bool has_new = ( T.compare("yes") == 0 );
+                if ( has_new ){
                         if ( pw ){
                                 new_plocal = new LocalPolynomialGrid();
                                 new_grid = new_plocal;
@@ -202,12 +400,244 @@ bool TasmanianSparseGrid::read( std::ifstream &ifs ){
                         }
                 }
                 if ( pass ){ // if everything so far is good, remove the last line
+                        if ( has_new ){ // the new grid is followed by "no" and the end line, skip to the end so the next object on the stream can be read
+                                while( (ifs >> T) && (T.compare("end") != 0) ){};
+                        }
                         getline( ifs, T );
                 }
         }
         return pass;
 }
 
+void TasmanianSparseGrid::writeBinary( std::ostream &ofs, bool compressed ) const{
+        // grid codes: 0 - empty, 1 - global, 2 - local polynomial, 3 - wavelet, 4 - full tensor
+        int num_dimension = getNumDimensions();
+        int domain[2] = { (transform_a == 0) ? 0 : 1, num_dimension };
+        twriteBinary( 2, domain, ofs );
+        if ( transform_a != 0 ){
+                twriteBinary( num_dimension, transform_a, ofs );
+                twriteBinary( num_dimension, transform_b, ofs );
+        }
+        int type[2] = { 1, (new_grid != 0) ? 1 : 0 };
+        if ( rule == rule_base ){
+                type[0] = 0;
+        }else if ( (rule == rule_pwpolynomial) || (rule == rule_pwpolynomial0) ){
+                type[0] = 2;
+        }else if ( rule == rule_wavelet ){
+                type[0] = 3;
+        }else if ( rule == rule_fulltensor ){
+                type[0] = 4;
+        }
+        twriteBinary( 2, type, ofs );
+        if ( grid != 0 ) grid->writeBinary( ofs, compressed );
+        if ( new_grid != 0 ) new_grid->writeBinary( ofs, compressed );
+}
+bool TasmanianSparseGrid::readBinary( std::istream &ifs ){
+        int domain[2], type[2];
+        if ( !treadBinary( 2, domain, ifs ) || (domain[1] < 0) ){ cerr << "ERROR: wrong binary file format code 5" << endl; return false; }
+        std::vector<double> read_xmin_vec(domain[1]+1), read_xmax_vec(domain[1]+1);
+        double *read_xmin = &read_xmin_vec[0], *read_xmax = &read_xmax_vec[0];
+        if ( (domain[0] == 1) && !(treadBinary( domain[1], read_xmin, ifs ) && treadBinary( domain[1], read_xmax, ifs )) ){
+                cerr << "ERROR: wrong binary file format code 6" << endl; return false;
+        }
+        if ( !treadBinary( 2, type, ifs ) || (type[0] < 0) || (type[0] > 4) ){ cerr << "ERROR: wrong binary file format code 7" << endl; return false; }
+
+        clear();
+        rule = rule_base;
+        if ( type[0] == 0 ) return true;
+        for( int g=0; g<=type[1]; g++ ){
+                Grid *next = 0;
+                if ( type[0] == 1 ){
+                        GlobalGrid *gg = new GlobalGrid(); next = gg;
+                        if ( g == 0 ){ global = gg; }else{ new_global = gg; }
+                }else if ( type[0] == 2 ){
+                        LocalPolynomialGrid *lg = new LocalPolynomialGrid(); next = lg;
+                        if ( g == 0 ){ plocal = lg; }else{ new_plocal = lg; }
+                }else if ( type[0] == 3 ){
+                        WaveletGrid *wg = new WaveletGrid(); next = wg;
+                        if ( g == 0 ){ wavelet = wg; }else{ new_wavelet = wg; }
+                }else{
+                        FullTensorGrid *fg = new FullTensorGrid(); next = fg;
+                        if ( g == 0 ){ fgrid = fg; }else{ new_fgrid = fg; }
+                }
+                if ( g == 0 ){ grid = next; }else{ new_grid = next; }
+                if ( !next->readBinary( ifs ) ){ clear(); rule = rule_base; return false; }
+        }
+        rule = grid->getOneDRule();
+        if ( domain[0] == 1 ){
+                setTransformAB( read_xmin, read_xmax );
+        }
+        return true;
+}
+static bool checkBinaryHeader( std::istream &ifs ){
+        // the magic string has already been read
+        int header[2];
+        if ( !treadBinary( 2, header, ifs ) ){ cerr << "ERROR: wrong binary file format code 1" << endl; return false; }
+        if ( header[1] != tsg_binary_endian ){ cerr << "ERROR: the binary file was written on a machine with different endianness" << endl; return false; }
+        if ( (header[0] != tsg_binary_version) && (header[0] != tsg_binary_version_compressed) ){
+                cerr << "ERROR: unknown version of the binary file format " << header[0] << endl; return false;
+        }
+        return true;
+}
+bool TasmanianSparseGrid::readBinaryStream( std::istream &ifs ){
+        if ( !checkBinaryHeader( ifs ) ) return false;
+        ChecksumInBuffer buffer( ifs );
+        std::istream cifs( &buffer );
+        if ( !readBinary( cifs ) ) return false;
+        int footer[2];
+        if ( !treadBinary( 2, footer, ifs ) || (buffer.getChecksum() != (unsigned int) footer[0]) ){
+                cerr << "ERROR: checksum mismatch, the binary data is corrupted" << endl; clear(); rule = rule_base; return false;
+        }
+        return true;
+}
+bool TasmanianSparseGrid::readBinaryFile( std::istream &ifs ){
+        if ( !checkBinaryHeader( ifs ) ) return false;
+
+        ifs.seekg( 0, std::ios::end );
+        std::streamoff end = ifs.tellg();
+        end -= tsg_binary_footer_size;
+        if ( end < tsg_binary_header_size ){ cerr << "ERROR: wrong binary file format code 2" << endl; return false; }
+        unsigned int sum = binaryChecksum( ifs, tsg_binary_header_size, end );
+        int footer[2];
+        if ( !treadBinary( 2, footer, ifs ) || (sum != (unsigned int) footer[0]) ){
+                cerr << "ERROR: checksum mismatch, the binary file is corrupted" << endl; return false;
+        }
+
+        ifs.seekg( tsg_binary_header_size );
+        if ( !readBinary( ifs ) ) return false;
+        if ( ifs.tellg() != end ){ cerr << "ERROR: wrong binary file format code 3" << endl; clear(); rule = rule_base; return false; }
+        return true;
+}
+
+bool TasmanianSparseGrid::mapBinary( const char* &data, const char *end ){
+        const int *domain, *type;
+        const double *read_xmin = 0, *read_xmax = 0;
+        if ( !tmapBinary( 2, domain, data, end ) || (domain[1] < 0) ){ cerr << "ERROR: wrong binary file format code 5" << endl; return false; }
+        if ( (domain[0] == 1) && !(tmapBinary( domain[1], read_xmin, data, end ) && tmapBinary( domain[1], read_xmax, data, end )) ){
+                cerr << "ERROR: wrong binary file format code 6" << endl; return false;
+        }
+        if ( !tmapBinary( 2, type, data, end ) || (type[0] < 0) || (type[0] > 4) ){ cerr << "ERROR: wrong binary file format code 7" << endl; return false; }
+
+        rule = rule_base;
+        if ( type[0] == 0 ) return true;
+        for( int g=0; g<=type[1]; g++ ){
+                Grid *next = 0;
+                if ( type[0] == 1 ){
+                        GlobalGrid *gg = new GlobalGrid(); next = gg;
+                        if ( g == 0 ){ global = gg; }else{ new_global = gg; }
+                }else if ( type[0] == 2 ){
+                        LocalPolynomialGrid *lg = new LocalPolynomialGrid(); next = lg;
+                        if ( g == 0 ){ plocal = lg; }else{ new_plocal = lg; }
+                }else if ( type[0] == 3 ){
+                        WaveletGrid *wg = new WaveletGrid(); next = wg;
+                        if ( g == 0 ){ wavelet = wg; }else{ new_wavelet = wg; }
+                }else{
+                        FullTensorGrid *fg = new FullTensorGrid(); next = fg;
+                        if ( g == 0 ){ fgrid = fg; }else{ new_fgrid = fg; }
+                }
+                if ( g == 0 ){ grid = next; }else{ new_grid = next; }
+                if ( !next->mapBinary( data, end ) ) return false;
+        }
+        rule = grid->getOneDRule();
+        if ( domain[0] == 1 ){
+                setTransformAB( read_xmin, read_xmax );
+        }
+        return true;
+}
+bool TasmanianSparseGrid::mapBinaryFile( const char* filename, bool &pass ){
+#ifdef TSG_HAS_MMAP
+        int fd = open( filename, O_RDONLY );
+        if ( fd == -1 ) return false;
+        return mapBinaryDescriptor( fd, pass );
+#else
+        return false;
+#endif
+}
+bool TasmanianSparseGrid::mapBinaryDescriptor( int fd, bool &pass ){
+#ifdef TSG_HAS_MMAP
+        struct stat file_stat;
+        if ( (fstat( fd, &file_stat ) != 0) || (file_stat.st_size < tsg_binary_header_size + tsg_binary_footer_size) ){ close( fd ); return false; }
+        size_t length = (size_t) file_stat.st_size;
+        void *addr = mmap( 0, length, PROT_READ, MAP_SHARED, fd, 0 );
+        close( fd ); // the mapping stays valid after the file is closed
+        if ( addr == MAP_FAILED ) return false;
+
+        const char *data = (const char*) addr;
+        const int *header = (const int*) (data + 8);
+        if ( memcmp( data, tsg_binary_magic, 8 ) != 0 ){ munmap( addr, length ); return false; } // not a binary file, let read() handle it
+        if ( header[0] == tsg_binary_version_compressed ){ munmap( addr, length ); return false; } // compressed, read() has to decode it
+
+        clear();
+        mapped_file = addr;
+        mapped_length = length;
+        rule = rule_base;
+        pass = false;
+        if ( header[1] != tsg_binary_endian ){ cerr << "ERROR: the binary file was written on a machine with different endianness" << endl; clear(); return true; }
+        if ( header[0] != tsg_binary_version ){ cerr << "ERROR: unknown version of the binary file format " << header[0] << endl; clear(); return true; }
+
+        data += tsg_binary_header_size;
+        const char *end = ((const char*) addr) + length - tsg_binary_footer_size;
+        pass = mapBinary( data, end );
+        if ( pass && (data != end) ){ cerr << "ERROR: wrong binary file format code 3" << endl; pass = false; }
+        if ( !pass ){ clear(); rule = rule_base; }
+        return true;
+#else
+        return false;
+#endif
+}
+
+#ifdef TSG_HAS_MMAP
+static std::string tsgSharedName( const char *name ){ // POSIX names start with a single slash
+        return ( name[0] == '/' ) ? std::string( name ) : std::string( "/" ) + name;
+}
+#endif
+bool TasmanianSparseGrid::writeShared( const char *name ) const{
+#ifdef TSG_HAS_MMAP
+        std::vector<char> data;
+        MemoryOutBuffer mbuffer( data );
+        std::ostream ofs( &mbuffer );
+        write( ofs, true, false );
+
+        // a new segment is made every time, the processes that mapped the old one keep using it
+        std::string shm_name = tsgSharedName( name );
+        shm_unlink( shm_name.c_str() );
+        int fd = shm_open( shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 );
+        if ( fd == -1 ){ cerr << "ERROR: cannot create shared memory segment " << shm_name << endl; return false; }
+        void *addr = MAP_FAILED;
+        if ( ftruncate( fd, (off_t) data.size() ) == 0 ){
+                addr = mmap( 0, data.size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        }
+        close( fd );
+        if ( addr == MAP_FAILED ){ cerr << "ERROR: cannot write shared memory segment " << shm_name << endl; shm_unlink( shm_name.c_str() ); return false; }
+        memcpy( addr, &(data[0]), data.size() );
+        munmap( addr, data.size() );
+        return true;
+#else
+        cerr << "ERROR: shared memory segments are not supported on this platform" << endl;
+        return false;
+#endif
+}
+bool TasmanianSparseGrid::readShared( const char *name ){
+#ifdef TSG_HAS_MMAP
+        std::string shm_name = tsgSharedName( name );
+        int fd = shm_open( shm_name.c_str(), O_RDONLY, 0 );
+        if ( fd == -1 ){ cerr << "ERROR: cannot open shared memory segment " << shm_name << endl; return false; }
+        bool pass;
+        if ( !mapBinaryDescriptor( fd, pass ) ){ cerr << "ERROR: shared memory segment " << shm_name << " does not hold a grid" << endl; return false; }
+        return pass;
+#else
+        cerr << "ERROR: shared memory segments are not supported on this platform" << endl;
+        return false;
+#endif
+}
+bool TasmanianSparseGrid::removeShared( const char *name ){
+#ifdef TSG_HAS_MMAP
+        return ( shm_unlink( tsgSharedName( name ).c_str() ) == 0 );
+#else
+        return false;
+#endif
+}
+
 void TasmanianSparseGrid::makeGlobalGrid( int dimensions, int outputs, int depth, TypeDepth type, TypeOneDRule oned, const int *anisotropic, const double *alpha_beta ){
         clear();
         global = new GlobalGrid( dimensions, outputs, depth, type, oned, anisotropic, alpha_beta );
@@ -312,7 +742,22 @@ const char* TasmanianSparseGrid::getOneDRuleDescription() const{ return grid->ge
 int TasmanianSparseGrid::getNumPoints() const{ return grid->getNumPoints(); }
 
 void TasmanianSparseGrid::getPoints( double* &pnts ) const{
-        grid->getPoints( pnts );
+        if ( pnts != 0 ){ delete[] pnts; }
+        pnts = new double[ getNumPoints() * getNumDimensions() ];
+        fillPoints( pnts );
+}
+void TasmanianSparseGrid::getWeights( double* &weights ) const{
+        if ( weights != 0 ){ delete[] weights; }
+        weights = new double[ getNumPoints() ];
+        fillWeights( weights );
+};
+void TasmanianSparseGrid::getInterpolantWeights( const double x[], double* &weights ) const{
+        if ( weights != 0 ){ delete[] weights; }
+        weights = new double[ getNumPoints() ];
+        fillInterpolantWeights( x, weights );
+};
+void TasmanianSparseGrid::fillPoints( double pnts[] ) const{
+        grid->fillPoints( pnts );
         if ( transform_a != 0 ){
                 int num_dimnensions = getNumDimensions();
                 for( int i=0; i<getNumPoints(); i++ ){
@@ -320,17 +765,16 @@ void TasmanianSparseGrid::getPoints( double* &pnts ) const{
                 }
         }
 }
-void TasmanianSparseGrid::getWeights( double* &weights ) const{
-        grid->getWeights( weights );
+void TasmanianSparseGrid::fillWeights( double weights[] ) const{
+        grid->fillWeights( weights );
         if ( transform_a != 0 ){
                 double scale = getWeightsScale();
                 for( int i=0; i<getNumPoints(); i++ ) weights[i] *= scale;
         }
-
-};
-void TasmanianSparseGrid::getInterpolantWeights( const double x[], double* &weights ) const{
+}
+void TasmanianSparseGrid::fillInterpolantWeights( const double x[], double weights[] ) const{
         if ( transform_a == 0 ){
-                grid->getInterpolantWeights( x, weights );
+                grid->fillInterpolantWeights( x, weights );
         }else{
                 //double x_canonical[getNumDimensions()];
 				std::vector<double> x_canonical_vec(getNumDimensions());
@@ -338,16 +782,39 @@ void TasmanianSparseGrid::getInterpolantWeights( const double x[], double* &weig
 				
                 tcopy( getNumDimensions(), x, x_canonical );
                 mapDomainToCanonical( x_canonical );
-                grid->getInterpolantWeights( x_canonical, weights );
+                grid->fillInterpolantWeights( x_canonical, weights );
         }
-};
+}
+void TasmanianSparseGrid::fillInterpolantWeightsBatch( const double x[], int num_x, double weights[] ) const{
+        int num_dimensions = getNumDimensions();
+        int num_points = getNumPoints();
+#ifdef _OPENMP
+        if ( omp_get_max_threads() > 1 ){ // on one thread the outer region only slows down the nested ones
+                #pragma omp parallel for
+                for( int i=0; i<num_x; i++ ){
+                        fillInterpolantWeights( &(x[((size_t) i) * num_dimensions]), &(weights[((size_t) i) * num_points]) );
+                }
+                return;
+        }
+#endif
+        for( int i=0; i<num_x; i++ ){
+                fillInterpolantWeights( &(x[((size_t) i) * num_dimensions]), &(weights[((size_t) i) * num_points]) );
+        }
+}
 
 int TasmanianSparseGrid::getNumNeededPoints() const{ return ( new_grid == 0) ? grid->getNumNeededPoints() : new_grid->getNumNeededPoints(); }
+bool TasmanianSparseGrid::hasLoadedValues() const{ return (grid != 0) && (grid->getNumOutputs() > 0) && (grid->getNumNeededPoints() == 0); } // the refinement keeps the needed points in new_grid
 void TasmanianSparseGrid::getNeededPoints( double* &pnts ) const{
+        if ( pnts != 0 ){ delete[] pnts; } pnts = 0;
+        if ( getNumNeededPoints() == 0 ) return;
+        pnts = new double[ getNumNeededPoints() * getNumDimensions() ];
+        fillNeededPoints( pnts );
+}
+void TasmanianSparseGrid::fillNeededPoints( double pnts[] ) const{
         if ( new_grid == 0 ){
-                grid->getNeededPoints( pnts );
+                grid->fillNeededPoints( pnts );
         }else{
-                new_grid->getNeededPoints( pnts );
+                new_grid->fillNeededPoints( pnts );
         }
         if ( transform_a != 0 ){
                 int num_dimnensions = getNumDimensions();
@@ -357,6 +824,7 @@ void TasmanianSparseGrid::getNeededPoints( double* &pnts ) const{
         }
 }
 void TasmanianSparseGrid::loadNeededPoints( const double vals[] ){
+        closeValueLog(); // the needed points are about to change
         if ( new_grid == 0 ){
                 grid->loadNeededPoints( vals );
         }else{
@@ -366,14 +834,150 @@ void TasmanianSparseGrid::loadNeededPoints( const double vals[] ){
         }
 }
 
+static unsigned int valueLogRecordChecksum( int index, int num_outputs, const double vals[] ){
+        unsigned int sum = tchecksum( 1, (const char*) &index, sizeof(int) );
+        return tchecksum( sum, (const char*) vals, num_outputs * sizeof(double) );
+}
+unsigned int TasmanianSparseGrid::getNeededPointsChecksum() const{
+        int num_needed = getNumNeededPoints();
+        if ( num_needed == 0 ) return 1;
+        double *pnts = 0;
+        getNeededPoints( pnts );
+        unsigned int sum = tchecksum( 1, (const char*) pnts, ((size_t) num_needed) * getNumDimensions() * sizeof(double) );
+        delete[] pnts;
+        return sum;
+}
+bool TasmanianSparseGrid::openValueLog( const char* filename ){
+        closeValueLog();
+        if ( (grid == 0) || (getNumOutputs() == 0) ){ cerr << "ERROR: the value log requires a grid with outputs" << endl; return false; }
+        int num_needed = getNumNeededPoints(), num_outputs = getNumOutputs();
+        int header[6] = { tsg_log_version, tsg_binary_endian, num_needed, num_outputs, (int) getNeededPointsChecksum(), 0 };
+
+        logged_values = new double[((size_t) num_needed) * num_outputs + 1];
+        logged = new bool[num_needed + 1];
+        for( int i=0; i<num_needed; i++ ) logged[i] = false;
+        num_logged = 0;
+
+        // replay the existing records, stop at the first incomplete or corrupted one
+        bool rewrite = false;
+        std::ifstream ifs; ifs.open( filename, std::ios::in | std::ios::binary );
+        if ( ifs.good() ){
+                char magic[8];
+                int file_header[6];
+                ifs.read( magic, 8 );
+                if ( !ifs.good() || (memcmp( magic, tsg_log_magic, 8 ) != 0) || !treadBinary( 6, file_header, ifs ) ){
+                        cerr << "WARNING: " << filename << " is not a value log, starting a new log" << endl;
+                        rewrite = true;
+                }else if ( memcmp( file_header, header, sizeof(header) ) != 0 ){
+                        cerr << "WARNING: the value log " << filename << " was made for a different set of needed points, starting a new log" << endl;
+                        rewrite = true;
+                }else{
+                        std::vector<double> vals_vec( num_outputs );
+                        double *vals = &vals_vec[0];
+                        int record[2];
+                        while( ifs.peek() != EOF ){
+                                if ( !treadBinary( 2, record, ifs ) || !treadBinary( num_outputs, vals, ifs )
+                                        || (record[0] < 0) || (record[0] >= num_needed) || ((unsigned int) record[1] != valueLogRecordChecksum( record[0], num_outputs, vals )) ){
+                                        cerr << "WARNING: the value log " << filename << " ends with an incomplete record, the record is discarded" << endl;
+                                        rewrite = true;
+                                        break;
+                                }
+                                tcopy( num_outputs, vals, &(logged_values[((size_t) record[0]) * num_outputs]) );
+                                if ( !logged[record[0]] ){ logged[record[0]] = true; num_logged++; }
+                        }
+                }
+        }else{
+                rewrite = true;
+        }
+        ifs.close();
+
+        if ( rewrite ){ // write the header and the good records to a new file, then replace the old one
+                std::string temp_name = std::string( filename ) + ".tmp";
+                std::ofstream ofs; ofs.open( temp_name.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+                ofs.write( tsg_log_magic, 8 );
+                twriteBinary( 6, header, ofs );
+                for( int i=0; i<num_needed; i++ ){
+                        if ( logged[i] ){
+                                const double *vals = &(logged_values[((size_t) i) * num_outputs]);
+                                int record[2] = { i, (int) valueLogRecordChecksum( i, num_outputs, vals ) };
+                                twriteBinary( 2, record, ofs );
+                                twriteBinary( num_outputs, vals, ofs );
+                        }
+                }
+                ofs.close();
+                if ( !ofs.good() || (std::rename( temp_name.c_str(), filename ) != 0) ){
+                        cerr << "ERROR: could not write the value log " << filename << endl;
+                        closeValueLog();
+                        return false;
+                }
+        }
+
+        value_log = new std::ofstream();
+        value_log->open( filename, std::ios::out | std::ios::binary | std::ios::app );
+        if ( !value_log->good() ){
+                cerr << "ERROR: could not open the value log " << filename << endl;
+                closeValueLog();
+                return false;
+        }
+        if ( (num_logged == num_needed) && (num_needed > 0) ){ // the log is complete, e.g., the process ended before the grid was saved
+                loadLoggedValues();
+        }
+        return true;
+}
+bool TasmanianSparseGrid::loadNeededValues( int index, const double vals[] ){
+        if ( value_log == 0 ){ cerr << "ERROR: loadNeededValues() requires an open value log, see openValueLog()" << endl; return false; }
+        int num_needed = getNumNeededPoints(), num_outputs = getNumOutputs();
+        if ( (index < 0) || (index >= num_needed) ){ cerr << "ERROR: there is no needed point with index " << index << endl; return false; }
+        int record[2] = { index, (int) valueLogRecordChecksum( index, num_outputs, vals ) };
+        twriteBinary( 2, record, *value_log );
+        twriteBinary( num_outputs, vals, *value_log );
+        value_log->flush();
+        if ( !value_log->good() ){ cerr << "ERROR: could not write to the value log" << endl; return false; }
+
+        tcopy( num_outputs, vals, &(logged_values[((size_t) index) * num_outputs]) );
+        if ( !logged[index] ){ logged[index] = true; num_logged++; }
+        if ( num_logged == num_needed ){
+                loadLoggedValues();
+        }
+        return true;
+}
+void TasmanianSparseGrid::loadLoggedValues(){
+        double *vals = logged_values; logged_values = 0; // closeValueLog() would delete the values
+        loadNeededPoints( vals );
+        delete[] vals;
+}
+int TasmanianSparseGrid::getNumLoggedValues() const{ return num_logged; }
+void TasmanianSparseGrid::closeValueLog(){
+        if ( value_log != 0 ){ value_log->close(); delete value_log; } value_log = 0;
+        if ( logged_values != 0 ){ delete[] logged_values; } logged_values = 0;
+        if ( logged != 0 ){ delete[] logged; } logged = 0;
+        num_logged = 0;
+}
+
 void TasmanianSparseGrid::evaluate( const double x[], double y[] ) const{
         if ( transform_a == 0 ){
                 grid->evaluate(x, y);
         }else{
-                double *x_canonical = new double[getNumDimensions()];
-                tcopy( getNumDimensions(), x, x_canonical );
-                mapDomainToCanonical( x_canonical );
-                grid->evaluate( x_canonical, y );
+                std::vector<double> x_canonical( getNumDimensions() );
+                tcopy( getNumDimensions(), x, &(x_canonical[0]) );
+                mapDomainToCanonical( &(x_canonical[0]) );
+                grid->evaluate( &(x_canonical[0]), y );
+        }
+}
+void TasmanianSparseGrid::evaluateBatch( const double x[], int num_x, double y[] ) const{
+        int num_dimensions = getNumDimensions();
+        int num_outputs = getNumOutputs();
+#ifdef _OPENMP
+        if ( omp_get_max_threads() > 1 ){ // on one thread the outer region only slows down the nested ones
+                #pragma omp parallel for
+                for( int i=0; i<num_x; i++ ){
+                        evaluate( &(x[((size_t) i) * num_dimensions]), &(y[((size_t) i) * num_outputs]) );
+                }
+                return;
+        }
+#endif
+        for( int i=0; i<num_x; i++ ){
+                evaluate( &(x[((size_t) i) * num_dimensions]), &(y[((size_t) i) * num_outputs]) );
         }
 }
 void TasmanianSparseGrid::integrate( double y[] ) const{
@@ -393,6 +997,10 @@ void TasmanianSparseGrid::clear(){
         grid = 0;
         if ( transform_a != 0 ){ delete[] transform_a; } transform_a = 0;
         if ( transform_b != 0 ){ delete[] transform_b; } transform_b = 0;
+#ifdef TSG_HAS_MMAP
+        if ( mapped_file != 0 ){ munmap( mapped_file, mapped_length ); } // the grids using the data are already gone
+#endif
+        mapped_file = 0; mapped_length = 0;
 }
 
 void TasmanianSparseGrid::mapCanonicalToDomain( double x[] ) const {
@@ -450,6 +1058,7 @@ double TasmanianSparseGrid::getWeightsScale() const{
 }
 
 void TasmanianSparseGrid::clearRefinement(){
+        closeValueLog(); // the needed points change with the refinement
         if ( new_global != 0 ){ delete new_global; }; new_global = 0;
         if ( new_plocal != 0 ){ delete new_plocal; }; new_plocal = 0;
         if ( new_wavelet != 0 ){ delete new_wavelet; }; new_wavelet = 0;
@@ -459,7 +1068,7 @@ void TasmanianSparseGrid::clearRefinement(){
 
 void TasmanianSparseGrid::setRefinement( double tolerance, TypeRefinement criteria ){
         clearRefinement();
-        if ( rule == rule_pwpolynomial ){ // local rule
+        if ( (rule == rule_pwpolynomial) || (rule == rule_pwpolynomial0) ){ // local rule
         	new_plocal = new LocalPolynomialGrid( grid->getNumDimensions(), grid->getNumOutputs(), 1, plocal->getOrder(), plocal->getOneDRule() );
         	new_grid = new_plocal;
         }
@@ -473,8 +1082,10 @@ void TasmanianSparseGrid::setRefinement( double tolerance, TypeRefinement criter
 			
         	tzero( grid->getNumDimensions(), indx );
         	new_fgrid = new FullTensorGrid( grid->getNumDimensions(), grid->getNumOutputs(), indx, fgrid->getOneDRule() );
+        	new_grid = new_fgrid;
         }else{ // global
-                new_global = new GlobalGrid( grid->getNumDimensions(), grid->getNumOutputs(), 1, type_level, rule, global->getAnisotropic() );
+                double ab[2]; ab[0] = global->getAlpha(); ab[1] = global->getBeta();
+                new_global = new GlobalGrid( grid->getNumDimensions(), grid->getNumOutputs(), 1, type_level, rule, global->getAnisotropic(), ab );
                 new_grid = new_global;
         }
 
@@ -491,6 +1102,7 @@ void TasmanianSparseGrid::setRefinement( double tolerance, TypeRefinement criter
 }
 
 void TasmanianSparseGrid::swapGrids(){
+        if ( grid != 0 ){ new_grid->addProfile( grid->getProfile() ); } // the profile covers all refinement iterations
         grid = new_grid; new_grid = 0;
 
         if ( global != 0 ){ delete global; }; global = new_global; new_global = 0;
@@ -500,6 +1112,7 @@ void TasmanianSparseGrid::swapGrids(){
 }
 
 void TasmanianSparseGrid::recycleData(){
+        closeValueLog();
         if ( grid->getNumOutputs() > 0 ){
                 IndexSet *data = 0;
                 grid->getData( data );
@@ -605,6 +1218,51 @@ void TasmanianSparseGrid::printStats(){
                         }
                 }
         }
+
+        GridProfile profile = getProfile();
+        if ( profile.enabled ){
+                cout << std::setw(col1) << "profile:" << std::setw(col2) << "calls" << std::setw(col2) << "seconds" << endl;
+                for( int i=0; i<profile_num_phases; i++ ){
+                        if ( profile.count[i] > 0 ){
+                                cout << std::setw(col1 - 1) << getProfilePhaseName( (TypeProfilePhase) i ) << ":" << std::setw(col2) << profile.count[i]
+                                     << std::setw(col2) << profile.seconds[i] << endl;
+                        }
+                }
+                if ( profile.solver_iterations > 0 ){
+                        cout << std::setw(col1) << "solver iterations:" << std::setw(col2) << profile.solver_iterations << endl;
+                }
+        }
+
+        GridMemory memory = getMemoryUsage();
+        cout << std::setw(col1) << "memory (bytes):" << std::setw(col2) << memory.getTotal() << endl;
+        for( int i=0; i<memory_num_components; i++ ){
+                if ( memory.bytes[i] > 0 ){
+                        cout << std::setw(col1 - 1) << getMemoryComponentName( (TypeMemoryComponent) i ) << ":" << std::setw(col2) << memory.bytes[i] << endl;
+                }
+        }
+}
+
+GridProfile TasmanianSparseGrid::getProfile() const{
+        GridProfile profile;
+        if ( grid != 0 ){ profile.add( grid->getProfile() ); }
+        if ( new_grid != 0 ){ profile.add( new_grid->getProfile() ); } // the refinement waiting for values
+        return profile;
+}
+void TasmanianSparseGrid::clearProfile(){
+        if ( grid != 0 ){ grid->clearProfile(); }
+        if ( new_grid != 0 ){ new_grid->clearProfile(); }
+}
+
+GridMemory TasmanianSparseGrid::getMemoryUsage() const{
+        GridMemory memory;
+        if ( grid != 0 ){ grid->getMemoryUsage( memory ); }
+        if ( new_grid != 0 ){
+                GridMemory refinement;
+                new_grid->getMemoryUsage( refinement );
+                memory.bytes[memory_refinement] += refinement.getTotal();
+                memory.bytes[memory_mapped] += refinement.bytes[memory_mapped];
+        }
+        return memory;
 }
 
 }
@@ -68,28 +68,64 @@ public:
         TypeOneDRule getOneDRule() const;
         const char *getOneDRuleDescription() const;
 
-        void write( const char* filename ) const; // write the grid to a file
-        bool read( const char* filename ); // reads the grid
+        void write( const char* filename, bool binary = false, bool compressed = false ) const; // write the grid to a file (text or binary format)
+        // compressed implies binary, the index lists are delta and variable length encoded in frames of bounded size,
+        // this gives much smaller files for large grids, but read( filename, true ) cannot map them and reads them instead
+        bool read( const char* filename, bool memory_map = false ); // reads the grid, text or binary format is detected automatically
+        // memory_map applies only to binary files: the file is mapped read-only and the grid uses the data in place,
+        // the pages are shared between all processes that map the same file, the checksum is not verified in this mode
+        // and the file must not be overwritten while the grid is using it
 
-        void write( std::ofstream &ofs ) const; // adds the class to an already opened stream
-        bool read( std::ifstream &ifs );
+        void write( std::ostream &ofs, bool binary = false, bool compressed = false ) const; // adds the class to an already opened stream
+        bool read( std::istream &ifs ); // the binary format is detected, the stream does not need to support seeking (e.g. a pipe)
+        // the checksum of binary data is verified after the grid is read, a corrupted stream leaves the grid empty
+
+        void writeBuffer( char* &buffer, size_t &length, bool compressed = false ) const; // binary format, the buffer is allocated with new[]
+        bool readBuffer( const char *buffer, size_t length ); // reads a buffer made by writeBuffer() or any text or binary grid file loaded in memory
+
+        bool writeShared( const char *name ) const; // binary format in a named POSIX shared memory segment, a segment with the same name is replaced
+        bool readShared( const char *name ); // maps the segment read-only and uses the data in place, same as read( filename, true )
+        static bool removeShared( const char *name ); // removes the name, the processes that already mapped the segment keep the data
 
         int getNumPoints() const;
 
         void getPoints( double* &pnts ) const;
         void getWeights( double* &weights ) const;
         void getInterpolantWeights( const double x[], double* &weights ) const;
+        // the fill functions write into an array allocated by the caller, e.g. getNumPoints() * getNumDimensions() for fillPoints()
+        void fillPoints( double pnts[] ) const;
+        void fillWeights( double weights[] ) const;
+        void fillInterpolantWeights( const double x[], double weights[] ) const;
+        void fillInterpolantWeightsBatch( const double x[], int num_x, double weights[] ) const; // x is num_x by getNumDimensions(), weights is num_x by getNumPoints()
 
         int getNumNeededPoints() const;
         void getNeededPoints( double* &pnts ) const;
+        void fillNeededPoints( double pnts[] ) const;
         void loadNeededPoints( const double vals[] );
+        bool hasLoadedValues() const; // false until the first loadNeededPoints(), evaluate() and integrate() need the values
+
+        bool openValueLog( const char* filename ); // attaches an append only log of values for the needed points, values already in the log are loaded
+        // each record holds the index of a needed point and its values, the log is flushed after every record so no values are lost
+        // if the process is terminated, the log belongs to the current set of needed points and a log for a different set is discarded,
+        // thus write the grid file after the last value is loaded and before the next refinement
+        bool loadNeededValues( int index, const double vals[] ); // values for one needed point (as ordered by getNeededPoints()), appended to the log
+        // once all needed points have values, they are loaded with loadNeededPoints() and the log is closed
+        int getNumLoggedValues() const; // number of needed points that already have values
+        void closeValueLog();
 
         void evaluate( const double x[], double y[] ) const;
+        void evaluateBatch( const double x[], int num_x, double y[] ) const; // x is num_x by getNumDimensions(), y is num_x by getNumOutputs()
+        // the batch functions split the points between the OpenMP threads
         void integrate( double y[] ) const;
 
         void setRefinement( double tolerance, TypeRefinement criteria ); // add other falgs later
 
-        void printStats(); // writes out the statistics of the grid
+        void printStats(); // writes out the statistics of the grid, and the profile if the library is compiled with TSG_PROFILING
+
+        GridProfile getProfile() const; // calls and time of each phase, summed over the grids replaced by setRefinement() and the recycle functions
+        void clearProfile(); // the make functions start a new profile too
+
+        GridMemory getMemoryUsage() const; // bytes used by the grid, the refinement waiting for values is reported as one component
 
 
 protected:
@@ -103,6 +139,19 @@ protected:
         void mapDomainToCanonical( double x[] ) const;
         double getWeightsScale() const;
 
+        void writeText( std::ostream &ofs ) const;
+        bool readText( std::istream &ifs );
+        void writeBinary( std::ostream &ofs, bool compressed ) const; // writes the grid data, without the header and checksum of the binary file
+        bool readBinary( std::istream &ifs );
+        bool readBinaryFile( std::istream &ifs ); // checks the header and checksum, then calls readBinary(), the stream must support seeking
+        bool readBinaryStream( std::istream &ifs ); // checks the header, calls readBinary() and then checks the checksum
+        bool mapBinary( const char* &data, const char *end );
+        bool mapBinaryFile( const char* filename, bool &pass ); // returns false if the file is not binary or cannot be mapped
+        bool mapBinaryDescriptor( int fd, bool &pass ); // same as mapBinaryFile() for an open file descriptor, which is closed
+
+        unsigned int getNeededPointsChecksum() const; // identifies the set of needed points in the value log
+        void loadLoggedValues(); // called when all needed points have values in the log, closes the log
+
 private:
         Grid *grid;
 
@@ -120,6 +169,14 @@ private:
 
         double *transform_a, *transform_b; // transformation on the interval of integration
 
+        void *mapped_file; // if not null, the grids use the data of a memory mapped binary file
+        size_t mapped_length;
+
+        std::ofstream *value_log; // if not null, the values given to loadNeededValues() are appended to this file
+        double *logged_values;
+        bool *logged;
+        int num_logged;
+
         TypeOneDRule rule;
 };
 
@@ -26,25 +26,48 @@
 #define __TASMANIAN_TASGRID_EXTERNAL_TESTER_CPP
 
 #include "tasgridExternalTester.hpp"
+#include "tasgridWrapper.hpp"
 #include <vector>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 
 using std::cout;
 using std::endl;
 using std::setw;
 
-ExternalTester::ExternalTester(int num_mc) : num_mc(num_mc), num_tests(4){ srand( time(0) ); };
+ExternalTester::ExternalTester(int num_mc) : num_tests(5), num_mc(num_mc), baseline_filename(0), record_baseline(false),
+        time_tolerance(TASGRID_PERF_TIME_TOLERANCE), error_tolerance(TASGRID_PERF_ERROR_TOLERANCE){ srand( time(0) ); };
 ExternalTester::~ExternalTester(){};
 
 int ExternalTester::getNumTests() const{
         return num_tests;
 };
 
-void ExternalTester::performTests( const bool *tests ){
+bool ExternalTester::performTests( const bool *tests ){
+        bool pass = true;
         for( int t=0; t<num_tests; t++ ){
-                if ( (tests == 0) || tests[t] ){ Test(t); };
+                if ( (tests == 0) || tests[t] ){
+                        if ( t == 4 ){
+                                pass = performanceTest() && pass;
+                        }else{
+                                Test(t);
+                        }
+                };
         }
+        return pass;
 };
 
+void ExternalTester::setBaseline( const char *filename, bool record ){
+        baseline_filename = filename;
+        record_baseline = record;
+}
+void ExternalTester::setTolerances( double time_tol, double error_tol ){
+        time_tolerance = time_tol;
+        error_tolerance = error_tol;
+}
+
 void ExternalTester::Test( int t ){
         if ( t == 0 ){
                 functionalityTest();
@@ -71,7 +94,7 @@ TestResults ExternalTester::getError( BaseFunction *f, TasGrid::TasmanianSparseG
                         grid->getInterpolantWeights( x, weights );
                 }
 
-				std::vector<double> y_vec, r_vec;
+				std::vector<double> y_vec(num_outputs), r_vec(num_outputs);
 				double *y = &y_vec[0], *r = &r_vec[0];
                 //double y[num_outputs];
                 //double r[num_outputs];
@@ -117,7 +140,7 @@ TestResults ExternalTester::getError( BaseFunction *f, TasGrid::TasmanianSparseG
 
                 //double x[num_dimensions];
                 //double y[num_outputs], s[num_outputs], r[num_outputs], n[num_outputs];
-				std::vector<double> x_vec, y_vec, s_vec, r_vec, n_vec;
+				std::vector<double> x_vec(num_dimensions), y_vec(num_outputs), s_vec(num_outputs), r_vec(num_outputs), n_vec(num_outputs);
 				double *x = &x_vec[0], *y = &y_vec[0], *s = &s_vec[0], *r = &r_vec[0], *n = &n_vec[0];
                 for( int i=0; i<num_outputs; i++ ){
                         y[i] = s[i] = r[i] = n[i] = 0.0;
@@ -207,7 +230,13 @@ void ExternalTester::testAllRefinement( BaseFunction *f, double tol, int min_lev
         }
         cout << "------------------------------------------------------------------------------------------------------------" << endl;
         gridc.makeWaveletGrid( 2, 1, min_level - 3, order );
+        gridp.makeWaveletGrid( 2, 1, min_level - 3, order );
+        gridd.makeWaveletGrid( 2, 1, min_level - 3, order );
+        gridf.makeWaveletGrid( 2, 1, min_level - 3, order );
         Rc = getError( f, &gridc, type_internal_interpolation );
+        Rp = getError( f, &gridp, type_internal_interpolation );
+        Rd = getError( f, &gridd, type_internal_interpolation );
+        Rf = getError( f, &gridf, type_internal_interpolation );
         cout << "------------------------------------------------------------------------------------------------------------" << endl;
         cout << gridc.getOneDRuleDescription() << endl;
         cout << "              Using: " << f->getDescription() << endl;
@@ -215,28 +244,28 @@ void ExternalTester::testAllRefinement( BaseFunction *f, double tol, int min_lev
         cout << "              Tolerance: " << tol << endl;
         cout << setw(12) << "Iteration" << setw(18) << "Classic" << setw(24) << "Parents" << setw(24) << "Direction" << setw(30) << "Family-Direction" << endl;
         cout << setw(24) << "Points" << setw(12) << "Error" << setw(12) << "Points" << setw(12) << "Error" << setw(12) << "Points" << setw(12) << "Error" << setw(12) << "Points" << setw(12) << "Error" << endl;
-        cout << setw(12) << "0" << setw(12) << Rc.num_points << setw(12) << Rc.error << setw(12) << "---" << setw(12) << "---"
-        		<< setw(12) << "---" << setw(12) << "---" << setw(12) << "---" << setw(12) << "---" << endl;
+        cout << setw(12) << "0" << setw(12) << Rc.num_points << setw(12) << Rc.error << setw(12) << Rp.num_points << setw(12) << Rp.error
+                                << setw(12) << Rd.num_points << setw(12) << Rd.error << setw(12) << Rf.num_points << setw(12) << Rf.error << endl;
 
         itr = 1;
-        doc = true;//, dop = true, dod = true, dof = true;
+        doc = true, dop = true, dod = true, dof = true;
         while( (itr <= max_iteration) && (itr > 0) ){
         	if ( doc ) gridc.setRefinement( tol, TasGrid::refine_classic );
-        	//                if ( dop ) gridp.setRefinement( tol, TasGrid::refine_parents_first );
-        	//                if ( dod ) gridd.setRefinement( tol, TasGrid::refine_direction_selective );
-        	//                if ( dof ) gridf.setRefinement( tol, TasGrid::refine_fds );
+        	if ( dop ) gridp.setRefinement( tol, TasGrid::refine_parents_first );
+        	if ( dod ) gridd.setRefinement( tol, TasGrid::refine_direction_selective );
+        	if ( dof ) gridf.setRefinement( tol, TasGrid::refine_fds );
 
         	doc = !( (!doc) || (gridc.getNumNeededPoints() == 0) );
-        	//                dop = !( (!dop) || (gridp.getNumNeededPoints() == 0) );
-        	//                dod = !( (!dod) || (gridd.getNumNeededPoints() == 0) );
-        	//                dof = !( (!dof) || (gridf.getNumNeededPoints() == 0) );
+        	dop = !( (!dop) || (gridp.getNumNeededPoints() == 0) );
+        	dod = !( (!dod) || (gridd.getNumNeededPoints() == 0) );
+        	dof = !( (!dof) || (gridf.getNumNeededPoints() == 0) );
 
-        	if ( (!doc)  ){  itr = -2;  };
+        	if ( (!doc) && (!dop) && (!dod) && (!dof) ){  itr = -2;  };
 
         	Rc = getError( f, &gridc, type_internal_interpolation );
-        	//                Rp = getError( f, &gridp, type_internal_interpolation );
-        	//                Rd = getError( f, &gridd, type_internal_interpolation );
-        	//                Rf = getError( f, &gridf, type_internal_interpolation );
+        	Rp = getError( f, &gridp, type_internal_interpolation );
+        	Rd = getError( f, &gridd, type_internal_interpolation );
+        	Rf = getError( f, &gridf, type_internal_interpolation );
 
         	if ( itr > 0 ){
         		cout << setw(12) << itr;
@@ -244,8 +273,8 @@ void ExternalTester::testAllRefinement( BaseFunction *f, double tol, int min_lev
         		cout << setw(12) << "final";
         	}
 
-        	cout << setw(12) << Rc.num_points << setw(12) << Rc.error << setw(12) << "---" << setw(12) << "---"
-        			<< setw(12) << "---" << setw(12) << "---" << setw(12) << "---" << setw(12) << "---" << endl;
+        	cout << setw(12) << Rc.num_points << setw(12) << Rc.error << setw(12) << Rp.num_points << setw(12) << Rp.error
+        			<< setw(12) << Rd.num_points << setw(12) << Rd.error << setw(12) << Rf.num_points << setw(12) << Rf.error << endl;
         	itr++;
         }
         cout << "------------------------------------------------------------------------------------------------------------" << endl;
@@ -275,6 +304,138 @@ void ExternalTester::IntegrationTest(){
         }
 }
 
+bool ExternalTester::performanceTest(){
+        cout << " Performance Test, wall time (fastest of " << TASGRID_PERF_REPEAT << " runs), number of points and error per case" << endl;
+        const PerformanceCase cases[] = {
+                { "f21nx2-cc-level-integration",          &f21nx2,     TasGrid::rule_clenshawcurtis, TasGrid::type_level,  11, 0, type_integration,            0 },
+                { "f21cos-gl-basis-integration",          &f21cos,     TasGrid::rule_gausslegendre,  TasGrid::type_basis,  60, 0, type_integration,            0 },
+                { "f31nx2-chebyshev-level-interpolation", &f31nx2,     TasGrid::rule_chebyshev,      TasGrid::type_level,  12, 0, type_internal_interpolation, 0 },
+                { "f51expsum-cc-level-integration",       &f51expsum,  TasGrid::rule_clenshawcurtis, TasGrid::type_level,   7, 0, type_integration,            0 },
+                { "f51expsum-cc-level-interpolation",     &f51expsum,  TasGrid::rule_clenshawcurtis, TasGrid::type_level,   5, 0, type_internal_interpolation, 0 },
+                { "f31ball-local-linear-integration",     &f31ball,    TasGrid::rule_pwpolynomial,   TasGrid::type_level,   8, 1, type_integration,            0 },
+                { "f21coscos-local-linear-w-interpolation", &f21coscos, TasGrid::rule_pwpolynomial0, TasGrid::type_level,   9, 1, type_nodal_interpolation,    0 },
+                { "f21expm40-local-linear-refinement",    &f21expm40,  TasGrid::rule_pwpolynomial,   TasGrid::type_level,   5, 1, type_internal_interpolation, 6 },
+                { "f21sinsin-local-cubic-refinement",     &f21sinsin,  TasGrid::rule_pwpolynomial,   TasGrid::type_level,   5, 3, type_internal_interpolation, 6 },
+                { "f21nx2-wavelet-interpolation",         &f21nx2,     TasGrid::rule_wavelet,        TasGrid::type_level,   6, 1, type_internal_interpolation, 0 },
+                { "f21nx2-wavelet-refinement",            &f21nx2,     TasGrid::rule_wavelet,        TasGrid::type_level,   3, 1, type_internal_interpolation, 6 } };
+        const int num_cases = sizeof( cases ) / sizeof( PerformanceCase );
+
+        std::vector<PerformanceResults> baseline;
+        bool compare = ( (baseline_filename != 0) && !record_baseline );
+        if ( compare && !readBaseline( baseline ) ){
+                cout << "FAIL: could not read the baseline file " << baseline_filename << endl;
+                return false;
+        }
+
+        cout << std::left << setw(42) << "Case" << std::right << setw(10) << "Points" << setw(14) << "Error" << setw(14) << "Seconds";
+        if ( compare ) cout << setw(14) << "Baseline" << setw(10) << "Ratio" << setw(10) << "Status";
+        cout << endl;
+
+        bool pass = true;
+        std::vector<PerformanceResults> results;
+        for( int c=0; c<num_cases; c++ ){
+                PerformanceResults R = runPerformanceCase( cases[c] );
+                results.push_back( R );
+                cout << std::left << setw(42) << R.name << std::right << setw(10) << R.num_points << std::scientific << std::setprecision(4)
+                     << setw(14) << R.error << setw(14) << R.seconds;
+                if ( compare ){
+                        int b = 0;
+                        while( (b < (int) baseline.size()) && (baseline[b].name != R.name) ) b++;
+                        if ( b == (int) baseline.size() ){
+                                cout << setw(14) << "-" << setw(10) << "-" << setw(10) << "NEW";
+                        }else{
+                                const PerformanceResults &B = baseline[b];
+                                const char *status = "Pass";
+                                if ( R.num_points != B.num_points ){
+                                        status = "POINTS"; // the grid itself changed
+                                }else if ( R.error > B.error * ( 1.0 + error_tolerance ) + NUM_TOL ){
+                                        status = "ERROR";
+                                }else if ( (R.seconds > B.seconds * ( 1.0 + time_tolerance )) && (R.seconds - B.seconds > TASGRID_PERF_MIN_SECONDS) ){
+                                        status = "SLOW";
+                                }
+                                if ( strcmp( status, "Pass" ) != 0 ) pass = false;
+                                cout << setw(14) << B.seconds << std::fixed << std::setprecision(2) << setw(10) << R.seconds / B.seconds << setw(10) << status;
+                        }
+                }
+                cout << endl;
+        }
+
+        if ( record_baseline ){
+                if ( !writeBaseline( results ) ){
+                        cout << "FAIL: could not write the baseline file " << baseline_filename << endl;
+                        return false;
+                }
+                cout << "Baseline written to " << baseline_filename << endl;
+        }
+        if ( compare ){
+                if ( pass ){
+                        cout << "Performance matches the baseline (time tolerance " << time_tolerance << ", error tolerance " << error_tolerance << ")" << endl;
+                }else{
+                        cout << "FAIL FAIL FAIL FAIL FAIL FAIL FAIL FAIL" << endl;
+                        cout << "  Performance regression against " << baseline_filename << endl;
+                        cout << "FAIL FAIL FAIL FAIL FAIL FAIL FAIL FAIL" << endl;
+                }
+        }
+        return pass;
+}
+
+PerformanceResults ExternalTester::runPerformanceCase( const PerformanceCase &pc ){
+        PerformanceResults R;
+        R.name = pc.name;
+        R.seconds = 0.0;
+        int num_dimensions = pc.f->getNumInputs();
+        int num_outputs = ( pc.test == type_internal_interpolation ) ? pc.f->getNumOutputs() : 0;
+        std::vector<double> x( num_dimensions );
+        for( int j=0; j<num_dimensions; j++ ) x[j] = ( j % 2 == 0 ) ? 1.0/3.0 : -1.0/3.0; // not a sample point
+        for( int r=0; r<TASGRID_PERF_REPEAT; r++ ){
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                TasGrid::TasmanianSparseGrid grid;
+                srand( 42 ); // after the constructor, which seeds with the time, so the Monte Carlo error is the same in every run
+                if ( (pc.rule == TasGrid::rule_pwpolynomial) || (pc.rule == TasGrid::rule_pwpolynomial0) ){
+                        grid.makeLocalPolynomialGrid( num_dimensions, num_outputs, pc.depth, pc.order, pc.rule );
+                }else if ( pc.rule == TasGrid::rule_wavelet ){
+                        grid.makeWaveletGrid( num_dimensions, num_outputs, pc.depth, pc.order );
+                }else{
+                        grid.makeGlobalGrid( num_dimensions, num_outputs, pc.depth, pc.type, pc.rule );
+                }
+                TestResults T = getError( pc.f, &grid, pc.test, &(x[0]) );
+                for( int i=0; i<pc.refinement_iterations; i++ ){
+                        grid.setRefinement( 1.E-4, TasGrid::refine_classic );
+                        if ( grid.getNumNeededPoints() == 0 ) break; // nothing left to refine
+                        T = getError( pc.f, &grid, pc.test, &(x[0]) );
+                }
+                double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+                if ( (r == 0) || (seconds < R.seconds) ) R.seconds = seconds;
+                R.num_points = T.num_points;
+                R.error = T.error;
+        }
+        return R;
+}
+
+bool ExternalTester::writeBaseline( const std::vector<PerformanceResults> &results ) const{
+        std::ofstream ofs( baseline_filename );
+        if ( !ofs.good() ) return false;
+        ofs << "TASGRID_PERFORMANCE_BASELINE " << results.size() << endl;
+        ofs << std::scientific; ofs.precision(17);
+        for( size_t i=0; i<results.size(); i++ ){
+                ofs << results[i].name << " " << results[i].seconds << " " << results[i].num_points << " " << results[i].error << endl;
+        }
+        return ofs.good();
+}
+
+bool ExternalTester::readBaseline( std::vector<PerformanceResults> &results ) const{
+        std::ifstream ifs( baseline_filename );
+        std::string header;
+        int num_results = 0;
+        ifs >> header >> num_results;
+        if ( !ifs.good() || (header != "TASGRID_PERFORMANCE_BASELINE") || (num_results < 0) ) return false;
+        results.resize( num_results );
+        for( int i=0; i<num_results; i++ ){
+                ifs >> results[i].name >> results[i].seconds >> results[i].num_points >> results[i].error;
+        }
+        return !ifs.fail();
+}
+
 bool ExternalTester::testRefinement( BaseFunction *f, TasGrid::TasmanianSparseGrid *grid, double tol, const double errs[], int max_iterations ){
         bool tpass = true;
         int itr = 0;
@@ -298,6 +459,201 @@ bool ExternalTester::testRefinement( BaseFunction *f, TasGrid::TasmanianSparseGr
         return tpass;
 }
 
+bool ExternalTester::compareGrids( const TasGrid::TasmanianSparseGrid *a, const TasGrid::TasmanianSparseGrid *b, double tol ){
+        int num_dimensions = a->getNumDimensions();
+        int num_outputs = a->getNumOutputs();
+        if ( (b->getNumDimensions() != num_dimensions) || (b->getNumOutputs() != num_outputs) || (a->getOneDRule() != b->getOneDRule())
+                || (a->getNumPoints() != b->getNumPoints()) || (a->getNumNeededPoints() != b->getNumNeededPoints()) || (a->hasLoadedValues() != b->hasLoadedValues()) ){
+                return false;
+        }
+        bool same = true;
+        double *pa = 0, *pb = 0;
+        a->getPoints( pa ); b->getPoints( pb );
+        for( int i=0; i<a->getNumPoints() * num_dimensions; i++ ){ same = same && ( pa[i] == pb[i] ); }
+        delete[] pa; delete[] pb; pa = 0; pb = 0;
+        a->getNeededPoints( pa ); b->getNeededPoints( pb );
+        for( int i=0; i<a->getNumNeededPoints() * num_dimensions; i++ ){ same = same && ( pa[i] == pb[i] ); }
+        delete[] pa; delete[] pb;
+        if ( same && a->hasLoadedValues() ){
+                std::vector<double> x_vec(num_dimensions), ya_vec(num_outputs), yb_vec(num_outputs);
+                double *x = &x_vec[0], *ya = &ya_vec[0], *yb = &yb_vec[0];
+                for( int k=0; k<num_mc; k++ ){
+                        setRandomX( num_dimensions, x );
+                        a->evaluate( x, ya );
+                        b->evaluate( x, yb );
+                        for( int j=0; j<num_outputs; j++ ){ same = same && ( fabs( ya[j] - yb[j] ) <= tol ); }
+                }
+        }
+        return same;
+}
+
+bool ExternalTester::testFileFormats(){
+        // the binary formats store the doubles as they are, reading or mapping the file must give back the same grid,
+        // the compressed files cannot be mapped and are read instead, the text format rounds to 17 significant digits
+        const char *filename = "tasgrid_test_file_formats.grid";
+        const int N = 5;
+        TasGrid::TasmanianSparseGrid grids[N];
+        grids[0].makeGlobalGrid( 2, 1, 6, TasGrid::type_level, TasGrid::rule_clenshawcurtis );
+        grids[1].makeGlobalGrid( 2, 1, 4, TasGrid::type_basis, TasGrid::rule_gausslegendre ); // no values, only the needed points
+        grids[2].makeLocalPolynomialGrid( 2, 1, 6, 2, TasGrid::rule_pwpolynomial );
+        grids[3].makeWaveletGrid( 2, 1, 4, 1 );
+        grids[4].makeWaveletGrid( 2, 1, 3, 3 );
+        for( int i=0; i<N; i++ ){
+                if ( i != 1 ) getError( &f21nx2, &(grids[i]), type_internal_interpolation ); // loads the values
+        }
+        grids[2].setRefinement( 1.E-4, TasGrid::refine_classic ); // the values and the next needed points
+
+        bool pass = true;
+        for( int i=0; i<N; i++ ){
+                TasGrid::TasmanianSparseGrid text, binary, mapped, compressed, compressed_mapped, streamed;
+                grids[i].write( filename );
+                pass = text.read( filename ) && compareGrids( &(grids[i]), &text, 1.E-14 ) && pass;
+                grids[i].write( filename, true );
+                pass = binary.read( filename ) && compareGrids( &(grids[i]), &binary, 0.0 ) && pass;
+                pass = mapped.read( filename, true ) && compareGrids( &(grids[i]), &mapped, 0.0 ) && pass;
+                grids[i].write( filename, true, true );
+                pass = compressed.read( filename ) && compareGrids( &(grids[i]), &compressed, 0.0 ) && pass;
+                pass = compressed_mapped.read( filename, true ) && compareGrids( &(grids[i]), &compressed_mapped, 0.0 ) && pass;
+                std::ifstream ifs; ifs.open( filename, std::ios::in | std::ios::binary ); // the frames are decoded one at a time
+                pass = streamed.read( ifs ) && compareGrids( &(grids[i]), &streamed, 0.0 ) && pass;
+                ifs.close();
+        }
+        std::remove( filename );
+        return pass;
+}
+
+bool ExternalTester::testValueLog(){
+        // the first half of the values is logged, then the process "ends" in the middle of a record,
+        // a new grid replays the log and gets the rest of the values in reverse order
+        const char *filename = "tasgrid_test_value_log.log";
+        bool pass = true;
+        for( int g=0; g<2; g++ ){
+                TasGrid::TasmanianSparseGrid reference, logged, restarted;
+                for( int k=0; k<3; k++ ){
+                        TasGrid::TasmanianSparseGrid *grid = ( k == 0 ) ? &reference : ( ( k == 1 ) ? &logged : &restarted );
+                        if ( g == 0 ){
+                                grid->makeGlobalGrid( 2, 1, 5, TasGrid::type_level, TasGrid::rule_clenshawcurtis );
+                        }else{
+                                grid->makeLocalPolynomialGrid( 2, 1, 5, 2, TasGrid::rule_pwpolynomial );
+                        }
+                }
+                int num_needed = reference.getNumNeededPoints(), half = num_needed / 2;
+                double *points = 0;
+                reference.getNeededPoints( points );
+                std::vector<double> values( num_needed );
+                for( int i=0; i<num_needed; i++ ){ f21nx2.eval( &(points[2*i]), &(values[i]) ); }
+                delete[] points;
+                reference.loadNeededPoints( &(values[0]) );
+
+                std::remove( filename );
+                pass = logged.openValueLog( filename ) && pass;
+                for( int i=0; i<half; i++ ){ pass = logged.loadNeededValues( i, &(values[i]) ) && pass; }
+                logged.closeValueLog();
+                std::ofstream ofs; ofs.open( filename, std::ios::out | std::ios::binary | std::ios::app );
+                ofs.write( (const char*) &half, sizeof(int) ); // the first bytes of the next record
+                ofs.close();
+
+                std::streambuf *cerr_buffer = std::cerr.rdbuf( 0 ); // the warning about the incomplete record is expected
+                pass = restarted.openValueLog( filename ) && pass;
+                std::cerr.rdbuf( cerr_buffer );
+                pass = ( restarted.getNumLoggedValues() == half ) && !restarted.hasLoadedValues() && pass;
+                for( int i=num_needed-1; i>=half; i-- ){ pass = restarted.loadNeededValues( i, &(values[i]) ) && pass; }
+                pass = pass && compareGrids( &reference, &restarted, 0.0 );
+        }
+        std::remove( filename );
+        return pass;
+}
+
+bool ExternalTester::testStreamEvaluate(){
+        // the points are streamed in chunks of different size, the answers must match the file exactly,
+        // the text files and chunks use 17 significant digits, which is enough to recover the doubles
+        const char *grid_filename = "tasgrid_test_stream.grid";
+        const char *points_filename = "tasgrid_test_stream_points.txt";
+        const char *values_filename = "tasgrid_test_stream_values.txt";
+        const int num_p = 20, chunks[3] = { 7, 1, 12 };
+
+        TasGrid::TasmanianSparseGrid grid;
+        grid.makeLocalPolynomialGrid( 2, 1, 5, 2, TasGrid::rule_pwpolynomial );
+        getError( &f21nx2, &grid, type_internal_interpolation ); // loads the values
+        grid.write( grid_filename, true );
+
+        std::vector<double> x( 2 * num_p );
+        setRandomX( 2 * num_p, &(x[0]) );
+        std::ofstream ofs; ofs.open( points_filename );
+        ofs << num_p << " " << 2 << endl;
+        ofs.precision(17);
+        for( int i=0; i<num_p; i++ ){ ofs << std::scientific << x[2*i] << " " << x[2*i+1] << endl; }
+        ofs.close();
+
+        GridWrapper file_wrapper;
+        file_wrapper.setGridFilename( grid_filename );
+        file_wrapper.setInFilename( points_filename );
+        file_wrapper.setOutFilename( values_filename );
+        file_wrapper.setOperation( op_evaluate );
+        bool pass = file_wrapper.doOperation();
+
+        std::vector<double> y( num_p );
+        int rows = 0, cols = 0;
+        std::ifstream ifs; ifs.open( values_filename );
+        ifs >> rows >> cols;
+        for( int i=0; i<num_p; i++ ){ ifs >> y[i]; }
+        pass = pass && !ifs.fail() && ( rows == num_p ) && ( cols == 1 );
+        ifs.close();
+
+        std::streamsize cout_precision = cout.precision();
+        std::ios::fmtflags cout_flags = cout.flags();
+        for( int s=0; s<2; s++ ){
+                bool text = ( s == 0 );
+                std::stringstream in, out;
+                in.precision(17);
+                int offset = 0;
+                for( int c=0; c<3; c++ ){
+                        int header[2] = { chunks[c], 2 };
+                        if ( text ){
+                                in << header[0] << " " << header[1] << endl;
+                                for( int i=offset; i<offset + chunks[c]; i++ ){ in << std::scientific << x[2*i] << " " << x[2*i+1] << endl; }
+                        }else{
+                                in.write( (const char*) header, 2*sizeof(int) );
+                                in.write( (const char*) &(x[2*offset]), 2 * chunks[c] * sizeof(double) );
+                        }
+                        offset += chunks[c];
+                }
+
+                GridWrapper stream_wrapper;
+                stream_wrapper.setGridFilename( grid_filename );
+                stream_wrapper.setOperation( op_evaluate );
+                stream_wrapper.setStream( (text) ? stream_text : stream_binary );
+                std::streambuf *cin_buffer = std::cin.rdbuf( in.rdbuf() );
+                std::streambuf *cout_buffer = cout.rdbuf( out.rdbuf() );
+                pass = stream_wrapper.doOperation() && pass;
+                std::cin.rdbuf( cin_buffer );
+                cout.rdbuf( cout_buffer );
+
+                offset = 0;
+                for( int c=0; c<3; c++ ){
+                        int header[2] = { 0, 0 };
+                        std::vector<double> answer( chunks[c] );
+                        if ( text ){
+                                out >> header[0] >> header[1];
+                                for( int i=0; i<chunks[c]; i++ ){ out >> answer[i]; }
+                        }else{
+                                out.read( (char*) header, 2*sizeof(int) );
+                                out.read( (char*) &(answer[0]), chunks[c] * sizeof(double) );
+                        }
+                        pass = pass && !out.fail() && ( header[0] == chunks[c] ) && ( header[1] == 1 );
+                        for( int i=0; i<chunks[c]; i++ ){ pass = pass && ( answer[i] == y[offset + i] ); }
+                        offset += chunks[c];
+                }
+        }
+        cout.precision( cout_precision );
+        cout.flags( cout_flags );
+
+        std::remove( grid_filename );
+        std::remove( points_filename );
+        std::remove( values_filename );
+        return pass;
+}
+
 void ExternalTester::setRandomX( int size, double x[] ){
         for( int i=0; i<size; i++ ){
                 x[i] = 2.0 * ((double) rand()) / ( (double) RAND_MAX ) -1.0;
@@ -563,6 +919,13 @@ void ExternalTester::functionalityTest(){
         writeRule( TasGrid::rule_clenshawcurtis ); cout << setw(30) << "refinement interpolation";
         if ( testRefinement( &f21nx2, &grid, 0.0, errs3, 4 ) ){cout << setw(25) << "Pass" << endl; }else{ cout << setw(25) << "FAIL" << endl; pass = false; }
 
+        cout << setw(60) << "write and read back, text, binary and compressed files";
+        if ( testFileFormats() ){ cout << setw(20) << "Pass" << endl; }else{ cout << setw(20) << "FAIL" << endl; pass = false; }
+        cout << setw(60) << "value log, restart and replay";
+        if ( testValueLog() ){ cout << setw(20) << "Pass" << endl; }else{ cout << setw(20) << "FAIL" << endl; pass = false; }
+        cout << setw(60) << "streamed evaluate, text and binary chunks";
+        if ( testStreamEvaluate() ){ cout << setw(20) << "Pass" << endl; }else{ cout << setw(20) << "FAIL" << endl; pass = false; }
+
         if ( !pass ){
                 cout << "FAIL FAIL FAIL FAIL FAIL FAIL FAIL FAIL" << endl;
                 cout << "       Some Tests Have Failed" << endl;
@@ -631,6 +994,8 @@ void ExternalTester::printInfo() const{
         cout << setw(6) << "Test" << setw(25) << "Point Type" << setw(15) << "Depth Type" << setw(25) << "Goal" << endl;
         cout << setw(6) << "0" << setw(25) << "all" << setw(15) << "all" << setw(25) << "basic functionality" << endl;
         cout << setw(6) << "1" << setw(25) << "local" << setw(15) << "-" << setw(25) << "refinement techniques" << endl;
+        cout << setw(6) << "2" << setw(25) << "global" << setw(15) << "level/basis" << setw(25) << "integration" << endl;
+        cout << setw(6) << "4" << setw(25) << "all" << setw(15) << "all" << setw(25) << "performance (perf)" << endl;
 
         cout << endl << " w-interpolation means that only weight are computed by the library and no data is loaded into the SparseGrid class (i.e. getInterpolantWeights() is used)" << endl;
 }
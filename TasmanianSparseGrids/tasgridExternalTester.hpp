@@ -29,6 +29,9 @@
 #include <cstdio>
 #include <iostream>
 #include <iomanip>
+#include <fstream>
+#include <vector>
+#include <string>
 
 #include <stdlib.h>
 #include <time.h>
@@ -45,6 +48,24 @@ enum TestType{
         type_integration, type_nodal_interpolation, type_internal_interpolation
 };
 
+// one case of the performance test: make the grid, compute the error, then do refinement_iterations refinements
+struct PerformanceCase{
+        const char *name;
+        BaseFunction *f;
+        TasGrid::TypeOneDRule rule;
+        TasGrid::TypeDepth type; // ignored by local and wavelet grids
+        int depth, order;
+        TestType test;
+        int refinement_iterations;
+};
+
+struct PerformanceResults{
+        std::string name;
+        double seconds;
+        int num_points;
+        double error;
+};
+
 class ExternalTester{
 public:
         ExternalTester(int num_mc = 1);
@@ -52,7 +73,10 @@ public:
 
         int getNumTests() const; // get the number of available tests
 
-        void performTests( const bool *tests = 0 ); // perform the tests marked with true
+        bool performTests( const bool *tests = 0 ); // perform the tests marked with true, returns false if the performance test found a regression
+
+        void setBaseline( const char *filename, bool record ); // the performance test compares against the baseline file, or writes it if record is true
+        void setTolerances( double time_tolerance, double error_tolerance ); // allowed relative growth of the time and the error before a case fails
 
         void printInfo() const;
 
@@ -61,6 +85,11 @@ protected:
 
         bool testRefinement( BaseFunction *f, TasGrid::TasmanianSparseGrid *grid, double tol, const double errs[], int max_iterations ); // does a series of refinements
 
+        bool compareGrids( const TasGrid::TasmanianSparseGrid *a, const TasGrid::TasmanianSparseGrid *b, double tol ); // same points and needed points, evaluations within tol at num_mc random points
+        bool testFileFormats(); // writes grids in every file format and checks that reading or mapping the file gives back the same grid
+        bool testValueLog(); // loads the values through the value log with a restart half way, compares with loadNeededPoints()
+        bool testStreamEvaluate(); // tasgrid -evaluate with text and binary streams, compares with -evaluate on the same points in a file
+
         void testAllRefinement( BaseFunction *f, double tol, int min_level, int max_iteration, int order = 1 );
 
         void allRefinementTest(); // puts side by side the various refinment types
@@ -69,6 +98,11 @@ protected:
 
         void IntegrationTest(); // do a bunch of integration tests
 
+        bool performanceTest(); // times a fixed set of cases and records or checks the baseline
+        PerformanceResults runPerformanceCase( const PerformanceCase &pc ); // minimum time over TASGRID_PERF_REPEAT runs
+        bool writeBaseline( const std::vector<PerformanceResults> &results ) const;
+        bool readBaseline( std::vector<PerformanceResults> &results ) const;
+
         void Test( int t ); // do a test
 
         void setRandomX( int size, double x[] );
@@ -82,6 +116,10 @@ private:
         const int num_tests;
         int num_mc;
 
+        const char *baseline_filename;
+        bool record_baseline;
+        double time_tolerance, error_tolerance;
+
         OneOneP0 f11p0;
         OneOneP3 f11p3;
         OneOneP4 f11p4;
@@ -0,0 +1,364 @@
+/*
+ * This file is part of
+ * Toolkit for Adaprive Stochastic Modeling And Non-Intrusive Approximation
+ *              a.k.a. TASMANIAN
+ *
+ * TASMANIAN is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TASMANIAN is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TASMANIAN.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+// microbenchmarks of the inner kernels of the library, used to validate optimizations
+// usage: tasgrid_microbench [-filter <substring>] [-time <seconds>]
+//   -filter runs only the kernels whose name contains the substring
+//   -time   sets the minimum run time of each sample (there are 5 samples per case)
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "tsgIndexSet.hpp"
+#include "tsgRuleClenshawCurtis.hpp"
+#include "tsgRuleChebyshev.hpp"
+#include "tsgRuleGaussLegendre.hpp"
+#include "tsgRuleChebyshevNestedTwoPoint.hpp"
+#include "tsgRuleGaussChebyshev1.hpp"
+#include "tsgRuleGaussChebyshev2.hpp"
+#include "tsgRuleFejer.hpp"
+#include "tsgRuleGaussGegenbauer.hpp"
+#include "tsgRuleGaussJacobi.hpp"
+#include "tsgRuleGaussLaguerre.hpp"
+#include "tsgRuleGaussHermite.hpp"
+#include "tsgRulePieceWiseLocal.hpp"
+#include "tsgTensorRule.hpp"
+#include "tsgSparseMatrices.hpp"
+#include "tsgLocalPolynomialGrid.hpp"
+
+using namespace std;
+using namespace TasGrid;
+using namespace TasSparse;
+
+class MicroBenchmark{
+public:
+        MicroBenchmark( const char *kernel_filter, double sample_time ) : sink( 0.0 ), filter( kernel_filter ), min_time( sample_time ){}
+
+        bool selected( const char *kernel ) const{
+                return ( filter == 0 ) || ( strstr( kernel, filter ) != 0 );
+        }
+
+        void printHeader() const{
+                cout << left << setw(41) << "kernel" << setw(34) << "case" << right << setw(12) << "ns/op" << setw(12) << "op/s"
+                     << setw(10) << "GB/s" << "   op" << endl;
+        }
+
+        // runs f() enough times to fill min_time, reports the median of the samples
+        // ops is the number of operations in one call of f(), bytes is the estimated memory traffic of one call (0 if not meaningful)
+        template<class Kernel>
+        void run( const char *kernel, const string &test_case, const char *op, double ops, double bytes, Kernel f ){
+                long long reps = 1;
+                double elapsed = timeCalls( f, reps );
+                while( elapsed < min_time ){
+                        reps = ( elapsed > 0.0 ) ? (long long) ( 1.2 * reps * min_time / elapsed ) + 1 : 2 * reps;
+                        elapsed = timeCalls( f, reps );
+                }
+                vector<double> samples( num_samples );
+                samples[0] = elapsed / reps;
+                for( int i=1; i<num_samples; i++ ) samples[i] = timeCalls( f, reps ) / reps;
+                sort( samples.begin(), samples.end() );
+                double per_call = samples[num_samples / 2];
+
+                cout << left << setw(41) << kernel << setw(34) << test_case << right
+                     << fixed << setprecision(2) << setw(12) << 1.E9 * per_call / ops
+                     << scientific << setprecision(3) << setw(12) << ops / per_call;
+                if ( bytes > 0.0 ){
+                        cout << fixed << setprecision(2) << setw(10) << 1.E-9 * bytes / per_call;
+                }else{
+                        cout << setw(10) << "-";
+                }
+                cout << "   " << op << endl;
+        }
+
+        double sink; // results are accumulated here so the kernels cannot be optimized away
+
+private:
+        template<class Kernel>
+        double timeCalls( Kernel &f, long long reps ){
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                for( long long i=0; i<reps; i++ ) f();
+                return chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+        }
+
+        static const int num_samples = 5;
+        const char *filter;
+        double min_time;
+};
+
+// points in [-1,1], away from the nodes of the rules
+static void benchmarkPoints( int n, vector<double> &x ){
+        x.resize( n );
+        for( int i=0; i<n; i++ ){
+                double a = (i + 1) * 0.6180339887498949;
+                x[i] = 2.0 * ( a - floor( a ) ) - 1.0;
+        }
+}
+
+static void benchOneDRules( MicroBenchmark &bench ){
+        const char *kernel = "OneDRule::eval";
+        if ( !bench.selected( kernel ) ) return;
+        const int max_level = 7;
+        const int num_levels = max_level + 1; // the constructors take the number of levels
+        RuleClenshawCurtis cc( num_levels ); RuleChebyshev ch( num_levels ); RuleGaussLegendre gl( num_levels );
+        RuleChebyshevN2P tp( num_levels ); RuleGaussChebyshev1 gc1( num_levels ); RuleGaussChebyshev2 gc2( num_levels );
+        RuleFejer f2( num_levels ); RuleGaussGegenbauer gg( num_levels, 0.5 ); RuleGaussJacobi gj( num_levels, 0.5, 0.5 );
+        RuleGaussLaguerre glag( num_levels, 0.0 ); RuleGaussHermite gh( num_levels, 0.0 );
+        OneDRule* rules[] = { &cc, &ch, &gl, &tp, &gc1, &gc2, &f2, &gg, &gj, &glag, &gh };
+        const char* names[] = { "clenshaw-curtis", "chebyshev", "gauss-legendre", "chebyshev-n2p", "gauss-chebyshev-1", "gauss-chebyshev-2",
+                "fejer-2", "gauss-gegenbauer", "gauss-jacobi", "gauss-laguerre", "gauss-hermite" };
+        int num_rules = sizeof( rules ) / sizeof( OneDRule* );
+        vector<double> x; benchmarkPoints( 64, x );
+        for( int r=0; r<num_rules; r++ ){
+                for( int level=1; level<=max_level; level+=2 ){
+                        int *pnts = 0;
+                        rules[r]->getPoints( level, pnts );
+                        int num_points = rules[r]->getNumPoints( level );
+                        OneDRule *rule = rules[r];
+                        ostringstream test_case; test_case << names[r] << "; level " << level << "; " << num_points << " points";
+                        bench.run( kernel, test_case.str(), "eval", (double) num_points * x.size(), 0.0, [&](){
+                                double s = 0.0;
+                                for( size_t i=0; i<x.size(); i++ ){
+                                        for( int j=0; j<num_points; j++ ) s += rule->eval( level, pnts[j], x[i] );
+                                }
+                                bench.sink += s;
+                        });
+                        delete[] pnts;
+                }
+        }
+}
+
+static void benchPieceWiseLocal( MicroBenchmark &bench ){
+        const char *kernel = "RulePieceWiseLocal::eval";
+        if ( !bench.selected( kernel ) ) return;
+        vector<double> x; benchmarkPoints( 256, x );
+        for( int order=0; order<=4; order++ ){
+                RulePieceWiseLocal rule( order );
+                for( int level=2; level<=8; level+=3 ){
+                        int first = rule.getNumPoints( level - 1 ), last = rule.getNumPoints( level ); // the points on this level
+                        ostringstream test_case; test_case << "order " << order << "; level " << level;
+                        bench.run( kernel, test_case.str(), "eval", (double) (last - first) * x.size(), 0.0, [&](){
+                                double s = 0.0;
+                                for( size_t i=0; i<x.size(); i++ ){
+                                        for( int j=first; j<last; j++ ) s += rule.eval( level, j, x[i] );
+                                }
+                                bench.sink += s;
+                        });
+                }
+        }
+}
+
+static void benchIndexSet( MicroBenchmark &bench ){
+        const char *kernel_add = "IndexSet::add";
+        const char *kernel_slot = "IndexSet::getSlot";
+        if ( !bench.selected( kernel_add ) && !bench.selected( kernel_slot ) ) return;
+        const int dims = 4;
+        int sizes[] = { 1000, 4000, 16000 }; // add() is linear in the size of the set, building larger sets takes too long
+        for( int s=0; s<3; s++ ){
+                int n = sizes[s];
+                vector<int> indexes( ((size_t) n) * dims );
+                for( int i=0; i<n; i++ ){ // distinct multi-indexes in a shuffled order
+                        long long k = ( ((long long) i) * 7919 ) % n;
+                        for( int j=0; j<dims; j++ ){ indexes[((size_t) i) * dims + j] = (int) ( k % 32 ); k /= 32; }
+                }
+                ostringstream test_case; test_case << dims << " dimensions; " << n << " indexes";
+                if ( bench.selected( kernel_add ) ){
+                        bench.run( kernel_add, test_case.str(), "add", (double) n, 0.0, [&](){
+                                IndexSet set( dims );
+                                for( int i=0; i<n; i++ ) set.add( &(indexes[((size_t) i) * dims]) );
+                                bench.sink += set.getNumIndexes();
+                        });
+                }
+                if ( bench.selected( kernel_slot ) ){
+                        IndexSet set( dims );
+                        for( int i=0; i<n; i++ ) set.add( &(indexes[((size_t) i) * dims]) );
+                        bench.run( kernel_slot, test_case.str(), "lookup", (double) n, 0.0, [&](){
+                                long long s = 0;
+                                for( int i=n-1; i>=0; i-- ) s += set.getSlot( &(indexes[((size_t) i) * dims]) );
+                                bench.sink += (double) s;
+                        });
+                }
+        }
+}
+
+static void benchTensorRule( MicroBenchmark &bench ){
+        const char *kernel = "TensorRule::eval";
+        if ( !bench.selected( kernel ) ) return;
+        RuleClenshawCurtis rule( 7 ); // levels 0 to 6
+        const int outputs = 4;
+        int dims[] = { 2, 3, 4 };
+        int levels[] = { 6, 4, 3 };
+        for( int c=0; c<3; c++ ){
+                vector<int> lindex( dims[c], levels[c] );
+                TensorRule tensor( dims[c], &(lindex[0]), &rule );
+                IndexSet data( dims[c], 0, outputs );
+                vector<double> value( outputs );
+                for( int i=0; i<tensor.getNumPoints(); i++ ){
+                        for( int k=0; k<outputs; k++ ) value[k] = 1.0 / ( i + k + 1.0 );
+                        data.add( tensor.getPoint( i ), &(value[0]) );
+                }
+                tensor.referenceValues( &data );
+                vector<double> x; benchmarkPoints( dims[c], x );
+                vector<double> y( outputs );
+                ostringstream test_case; test_case << dims[c] << " dimensions; " << tensor.getNumPoints() << " points";
+                bench.run( kernel, test_case.str(), "eval", 1.0, 0.0, [&](){
+                        tensor.eval( &(x[0]), &(y[0]) );
+                        bench.sink += y[0];
+                });
+        }
+}
+
+// 5-point Laplacian on a k by k grid, the non-symmetric version adds an upwind convection term
+static TsgSparseCSR* benchmarkMatrix( int k, bool symmetric ){
+        int n = k * k;
+        TsgSparseCOO coo( n, n );
+        double convection = ( symmetric ) ? 0.0 : 0.5;
+        for( int i=0; i<k; i++ ){
+                for( int j=0; j<k; j++ ){
+                        int r = i * k + j;
+                        coo.addPoint( r, r, 4.0 + convection );
+                        if ( i > 0 ) coo.addPoint( r, r - k, -1.0 - convection );
+                        if ( i < k-1 ) coo.addPoint( r, r + k, -1.0 );
+                        if ( j > 0 ) coo.addPoint( r, r - 1, -1.0 );
+                        if ( j < k-1 ) coo.addPoint( r, r + 1, -1.0 );
+                }
+        }
+        return new TsgSparseCSR( coo );
+}
+
+// memory traffic of one CSR product if every array is streamed once
+static double matvecBytes( TsgSparseCSR *mat ){
+        return 12.0 * mat->getNumNonzero() + 4.0 * ( mat->getNumRows() + 1 ) + 8.0 * mat->getNumRows() + 8.0 * mat->getNumCols();
+}
+
+static void benchSparse( MicroBenchmark &bench ){
+        const char *kernel_matvec = "TsgSparseCSR::matvec";
+        const char *kernel_cg = "TsgSparseMatrix::cg";
+        const char *kernel_cga = "TsgSparseMatrix::cga";
+        int sizes[] = { 100, 316, 1000 };
+        const int iterations = 20;
+        for( int s=0; s<3; s++ ){
+                int k = sizes[s];
+                int n = k * k;
+                vector<double> x( n ), y( n ), b( n );
+                for( int i=0; i<n; i++ ){ x[i] = 1.0 / ( i + 1.0 ); b[i] = 1.0; }
+                if ( bench.selected( kernel_matvec ) ){
+                        TsgSparseCSR *mat = benchmarkMatrix( k, true );
+                        ostringstream test_case; test_case << n << " rows; " << mat->getNumNonzero() << " nonzeros";
+                        bench.run( kernel_matvec, test_case.str(), "nonzero", (double) mat->getNumNonzero(), matvecBytes( mat ), [&](){
+                                tzero( n, &(y[0]) );
+                                mat->matvec( &(x[0]), &(y[0]) );
+                                bench.sink += y[n/2];
+                        });
+                        delete mat;
+                }
+                if ( s == 2 ) break; // the solvers on the largest matrix only repeat what the matvec shows
+                ostringstream test_case; test_case << n << " rows; " << iterations << " iterations";
+                if ( bench.selected( kernel_cg ) ){
+                        TsgSparseCSR *mat = benchmarkMatrix( k, true );
+                        // one product and the fused vector updates (about 6 vectors) per iteration
+                        double bytes = iterations * ( matvecBytes( mat ) + 48.0 * n );
+                        bench.run( kernel_cg, test_case.str(), "iteration", (double) iterations, bytes, [&](){
+                                tzero( n, &(y[0]) );
+                                mat->cg( &(b[0]), &(y[0]), iterations, 0.0 );
+                                bench.sink += y[n/2];
+                        });
+                        delete mat;
+                }
+                if ( bench.selected( kernel_cga ) ){
+                        TsgSparseCSR *mat = benchmarkMatrix( k, false );
+                        // two products and the fused vector updates (about 8 vectors) per iteration
+                        double bytes = iterations * ( 2.0 * matvecBytes( mat ) + 64.0 * n );
+                        bench.run( kernel_cga, test_case.str(), "iteration", (double) iterations, bytes, [&](){
+                                tzero( n, &(y[0]) );
+                                mat->cga( &(b[0]), &(y[0]), iterations, 0.0 );
+                                bench.sink += y[n/2];
+                        });
+                        delete mat;
+                }
+        }
+}
+
+static void benchSurpluses( MicroBenchmark &bench ){
+        const char *kernel = "LocalPolynomialGrid::recomputeSurpluses";
+        if ( !bench.selected( kernel ) ) return;
+        int dims[] = { 2, 2, 4 };
+        int depths[] = { 5, 7, 4 };
+        int orders[] = { 1, 2, 1 };
+        const int outputs = 2;
+        for( int c=0; c<3; c++ ){
+                LocalPolynomialGrid grid( dims[c], outputs, depths[c], orders[c], rule_pwpolynomial );
+                int num_points = grid.getNumNeededPoints();
+                double *points = 0;
+                grid.getNeededPoints( points );
+                vector<double> values( ((size_t) num_points) * outputs );
+                for( int i=0; i<num_points; i++ ){
+                        double s = 0.0;
+                        for( int j=0; j<dims[c]; j++ ) s += points[i*dims[c] + j] * points[i*dims[c] + j];
+                        for( int k=0; k<outputs; k++ ) values[i*outputs + k] = exp( -s / ( k + 1.0 ) );
+                }
+                delete[] points;
+                grid.loadNeededPoints( &(values[0]) );
+                ostringstream test_case; test_case << dims[c] << "D; order " << orders[c] << "; " << num_points << " points";
+                // updateOrder() with the same order only recomputes the surpluses
+                bench.run( kernel, test_case.str(), "call", 1.0, 0.0, [&](){
+                        grid.updateOrder( orders[c] );
+                });
+        }
+}
+
+int main( int argc, const char ** argv ){
+        const char *filter = 0;
+        double sample_time = 0.05;
+        for( int i=1; i<argc; i++ ){
+                if ( (strcmp( argv[i], "-filter" ) == 0) && (i+1 < argc) ){
+                        filter = argv[++i];
+                }else if ( (strcmp( argv[i], "-time" ) == 0) && (i+1 < argc) ){
+                        sample_time = atof( argv[++i] );
+                }else{
+                        cerr << "ERROR: unknown option " << argv[i] << endl;
+                        cerr << "usage: tasgrid_microbench [-filter <substring>] [-time <seconds>]" << endl;
+                        return 1;
+                }
+        }
+        if ( !(sample_time > 0.0) ){
+                cerr << "ERROR: -time must be positive" << endl;
+                return 1;
+        }
+
+        MicroBenchmark bench( filter, sample_time );
+        bench.printHeader();
+        benchOneDRules( bench );
+        benchPieceWiseLocal( bench );
+        benchIndexSet( bench );
+        benchTensorRule( bench );
+        benchSparse( bench );
+        benchSurpluses( bench );
+        cout << "GB/s assumes every array is streamed from memory once per call, \"-\" marks compute bound kernels" << endl;
+        cout << "checksum: " << bench.sink << endl;
+        return 0;
+}
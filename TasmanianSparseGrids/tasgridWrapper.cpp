@@ -27,13 +27,32 @@
 
 #include "tasgridWrapper.hpp"
 #include <vector>
+#include <sstream>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+
+#if !defined(_WIN32) && !defined(WIN32)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <new>
+#include <sys/stat.h>
+#define TASGRID_HAS_SOCKETS
+#endif
 
 using std::cout;
 using std::endl;
 using std::setw;
 
-GridWrapper::GridWrapper() : grid_filename(0), in_filename(0), out_filename(0), anisotropic_filename(0), todo(op_none), num_dimensions(1), num_outputs(0), depth(1), order(1), tolerance(0),isTensor(false),
-        type(TasGrid::type_level), oned(TasGrid::rule_clenshawcurtis), print(false), refinement(TasGrid::refine_classic){};
+GridWrapper::GridWrapper() : grid_filename(0), in_filename(0), out_filename(0), anisotropic_filename(0), socket_filename(0), todo(op_none), num_dimensions(1), num_outputs(0), depth(1), order(1), tolerance(0),isTensor(false),
+        type(TasGrid::type_level), oned(TasGrid::rule_clenshawcurtis), print(false), binary(false), compressed(false), npy(false), stream(stream_none), repeat(10), refinement(TasGrid::refine_classic){};
 
 GridWrapper::~GridWrapper(){};
 
@@ -49,6 +68,9 @@ void GridWrapper::setOutFilename( const char * filename ){
 void GridWrapper::setAnisotropicFilename( const char * filename ){
         anisotropic_filename = filename;
 }
+void GridWrapper::setSocketFilename( const char * filename ){
+        socket_filename = filename;
+}
 void GridWrapper::setNumDimensions( int n ){
         num_dimensions = n;
 }
@@ -85,24 +107,51 @@ void GridWrapper::setBeta( double b ){
 void GridWrapper::setPrint( bool p ){
         print = p;
 }
+void GridWrapper::setBinary( bool b ){
+        binary = b;
+}
+void GridWrapper::setCompressed( bool c ){
+        compressed = c;
+}
+void GridWrapper::setNpy( bool n ){
+        npy = n;
+}
+void GridWrapper::setStream( StreamFormat f ){
+        stream = f;
+}
+void GridWrapper::setRepeat( int r ){
+        repeat = r;
+}
 void GridWrapper::setOperation( Operations op ){
         todo = op;
 }
 bool GridWrapper::isValid() const{
         // operations that need a grid filename
-        if ( (todo == op_getpoints) || (todo == op_getquadrature) || (todo == op_loadvalues) || (todo == op_evaluate) || (todo == op_getinterweights) || (todo == op_refine) || (todo == op_info) ){
+        if ( (todo == op_getpoints) || (todo == op_getquadrature) || (todo == op_loadvalues) || (todo == op_evaluate) || (todo == op_getinterweights) || (todo == op_refine) || (todo == op_info) || (todo == op_serve) ){
                 if( grid_filename == 0 ){
                         cerr << "ERROR: must provide a grid filename" << endl;
                         return false;
                 }
         }
         // operations that need an input file
-        if ( (todo == op_loadvalues) || (todo == op_evaluate) || (todo == op_getinterweights) ){
+        if ( (todo == op_loadvalues) || ((todo == op_evaluate) && (stream == stream_none)) || (todo == op_getinterweights) ){
                 if( in_filename == 0 ){
                         cerr << "ERROR: must provide an input file" << endl;
                         return false;
                 }
         }
+        if ( (oned == TasGrid::rule_base) && (todo != op_benchmark) ){
+                cerr << "ERROR: -onedim all can only be used with -benchmark" << endl;
+                return false;
+        }
+        if ( (todo == op_benchmark) && (repeat < 1) ){
+                cerr << "ERROR: -repeat must be at least 1" << endl;
+                return false;
+        }
+        if ( (todo == op_serve) && (socket_filename == 0) ){
+                cerr << "ERROR: must provide a socket filename" << endl;
+                return false;
+        }
         return true;
 }
 const char* GridWrapper::getVersion() const{
@@ -141,12 +190,29 @@ bool GridWrapper::doOperation(){
                 return printInfo();
         }else if ( todo == op_refine ){
                 return refine();
+        }else if ( todo == op_serve ){
+                return serve();
+        }else if ( todo == op_benchmark ){
+                return benchmark();
         };
 
         return true;
 }
 
+// .npy files (version 1.0) have a 10 byte preamble: the magic string, the version and the length of the header,
+// the header is a python dictionary padded with spaces to a multiple of 64 bytes, the data follows in native binary
+static const char npy_magic[6] = { '\223', 'N', 'U', 'M', 'P', 'Y' };
+
+static bool hasNpyExtension( const char *filename ){
+        size_t l = strlen( filename );
+        return ( (l >= 4) && (strcmp( &(filename[l-4]), ".npy" ) == 0) );
+}
+
 void GridWrapper::writeMatrix( int rows, int cols, double x[], const char *filename ) const{
+        if ( npy || hasNpyExtension( filename ) ){
+                writeMatrixNpy( rows, cols, x, filename );
+                return;
+        }
         std::ofstream ofs;
         ofs.open( filename );
         ofs << rows << " " << cols << endl;
@@ -159,6 +225,21 @@ void GridWrapper::writeMatrix( int rows, int cols, double x[], const char *filen
         }
         ofs.close();
 }
+void GridWrapper::writeMatrixNpy( int rows, int cols, double x[], const char *filename ) const{
+        std::ostringstream header;
+        header << "{'descr': '<f8', 'fortran_order': False, 'shape': (" << rows << ", " << cols << "), }";
+        std::string h = header.str();
+        h.append( 63 - (10 + h.size()) % 64, ' ' ); // the header ends with a new line and the data starts on 64 byte boundary
+        h.append( "\n" );
+        unsigned char preamble[4] = { 1, 0, (unsigned char) (h.size() & 0xff), (unsigned char) ((h.size() >> 8) & 0xff) };
+        std::ofstream ofs;
+        ofs.open( filename, std::ios::out | std::ios::binary );
+        ofs.write( npy_magic, 6 );
+        ofs.write( (const char*) preamble, 4 );
+        ofs.write( h.c_str(), h.size() );
+        if ( (rows > 0) && (cols > 0) ) ofs.write( (const char*) x, ((size_t) rows) * ((size_t) cols) * sizeof(double) );
+        ofs.close();
+}
 void GridWrapper::printMatrix( int rows, int cols, double x[] ) const{
         cout << rows << " " << cols << endl;
         cout.precision(17);
@@ -170,13 +251,27 @@ void GridWrapper::printMatrix( int rows, int cols, double x[] ) const{
         }
 }
 void GridWrapper::readMatrix( int &rows, int &cols, double* &x, const char *filename ) const{
-        std::ifstream ifs; ifs.open(filename);
+        std::ifstream ifs; ifs.open( filename, std::ios::in | std::ios::binary );
+        char magic[6];
+        ifs.read( magic, 6 );
+        if ( ifs.good() && (memcmp( magic, npy_magic, 6 ) == 0) ){ // .npy files are detected regardless of the extension
+                if ( !readMatrixNpy( rows, cols, x, ifs ) ){
+                        cerr << "ERROR: unsupported .npy file " << filename << ", expected a 1-D or 2-D array of float64, float32, int32 or int64" << endl;
+                        rows = 0; cols = 0;
+                }
+                ifs.close();
+                return;
+        }
+        ifs.close();
+        ifs.clear();
+        ifs.open(filename);
+        rows = 0; cols = 0;
         ifs >> rows >> cols;
         if ( (rows == 0) && (cols == 0) ){
                 cout << "WARNING: empty file" << endl;
                 return;
         }
-        if ( x != 0 ){ delete x; }
+        if ( x != 0 ){ delete[] x; }
         x = new double[rows*cols];
         for( int i=0; i<rows; i++ ){
                 for( int j=0; j<cols; j++ ){
@@ -185,6 +280,83 @@ void GridWrapper::readMatrix( int &rows, int &cols, double* &x, const char *file
         }
         ifs.close();
 }
+bool GridWrapper::readMatrixNpy( int &rows, int &cols, double* &x, std::ifstream &ifs ) const{
+        // the magic string has been read, the data must be little endian (same as the machine)
+        unsigned char preamble[4];
+        ifs.read( (char*) preamble, 4 );
+        if ( !ifs.good() ) return false;
+        size_t header_length = ((size_t) preamble[2]) + (((size_t) preamble[3]) << 8);
+        if ( preamble[0] != 1 ){ // version 2.0 and 3.0 use 4 bytes for the length
+                unsigned char extra[2];
+                ifs.read( (char*) extra, 2 );
+                header_length += (((size_t) extra[0]) << 16) + (((size_t) extra[1]) << 24);
+        }
+        std::vector<char> header_vec( header_length + 1, '\0' );
+        ifs.read( &(header_vec[0]), header_length );
+        if ( !ifs.good() ) return false;
+        std::string header( &(header_vec[0]) );
+
+        size_t descr = header.find( "'descr'" );
+        size_t fortran = header.find( "'fortran_order'" );
+        size_t shape = header.find( "'shape'" );
+        if ( (descr == std::string::npos) || (fortran == std::string::npos) || (shape == std::string::npos) ) return false;
+        descr = header.find( '\'', descr + 7 );
+        if ( descr == std::string::npos ) return false;
+        std::string type = header.substr( descr + 1, 3 );
+        int size;
+        if ( (type.compare( "<f8" ) == 0) || (type.compare( "<i8" ) == 0) ){
+                size = 8;
+        }else if ( (type.compare( "<f4" ) == 0) || (type.compare( "<i4" ) == 0) ){
+                size = 4;
+        }else{
+                return false;
+        }
+        size_t order = header.find_first_not_of( ": ", fortran + 15 );
+        if ( order == std::string::npos ) return false;
+        bool transposed = ( header.compare( order, 4, "True" ) == 0 );
+
+        // the shape is (rows, cols), (rows,) or (), a 1-D array is read as a single column
+        size_t open = header.find( '(', shape ), close = header.find( ')', shape );
+        if ( (open == std::string::npos) || (close == std::string::npos) || (close < open) ) return false;
+        std::istringstream dims( header.substr( open + 1, close - open - 1 ) );
+        long long d[2] = { 1, 1 };
+        int num_d = 0;
+        char comma;
+        while( (num_d < 2) && (dims >> d[num_d]) ){
+                num_d++;
+                dims >> comma;
+        }
+        if ( (dims >> d[0]) || (d[0] < 0) || (d[1] < 0) || (d[0] * d[1] > 2147483647) ) return false;
+        int r = (int) d[0], c = (int) d[1];
+
+        size_t num_entries = ((size_t) r) * ((size_t) c);
+        std::vector<char> data( num_entries * size + 1 );
+        ifs.read( &(data[0]), num_entries * size );
+        if ( (num_entries > 0) && !ifs.good() ) return false;
+
+        if ( x != 0 ){ delete[] x; }
+        x = new double[num_entries + 1];
+        for( size_t i=0; i<num_entries; i++ ){
+                double v;
+                const char *e = &(data[i*size]);
+                if ( type.compare( "<f8" ) == 0 ){
+                        double t; memcpy( &t, e, 8 ); v = t;
+                }else if ( type.compare( "<f4" ) == 0 ){
+                        float t; memcpy( &t, e, 4 ); v = (double) t;
+                }else if ( type.compare( "<i8" ) == 0 ){
+                        long long t; memcpy( &t, e, 8 ); v = (double) t;
+                }else{
+                        int t; memcpy( &t, e, 4 ); v = (double) t;
+                }
+                if ( transposed ){ // column major, entry i is ( i % r, i / r )
+                        x[(i % r) * c + i / r] = v;
+                }else{
+                        x[i] = v;
+                }
+        }
+        rows = r; cols = c;
+        return true;
+}
 
 bool GridWrapper::makeCanonicalGrid(){
         makeGrid();
@@ -267,13 +439,13 @@ bool GridWrapper::loadValues(){
         readMatrix( num_p, num_o, vals, in_filename );
         if ( num_p != grid.getNumNeededPoints() ){
                 cerr << "ERROR: wrong number of points, there are " << num_p << " points provided, but the grid needs " << grid.getNumNeededPoints() << endl;
-                delete vals;
+                delete[] vals;
                 return false;
         }
         if ( grid.getNumOutputs() != num_o ){
                 cerr << "ERROR: wrong number of outputs, there are " << num_o << " outputs provided, but the grid is set for " << grid.getNumOutputs() << endl;
                 cerr << "       You must change the number of outputs first, use tasgrid for that purpse." << endl;
-                delete vals;
+                delete[] vals;
                 return false;
         }
         grid.loadNeededPoints( vals );
@@ -288,18 +460,19 @@ bool GridWrapper::evaluate(){
                 cerr << "ERROR: the grid is not set for internal evaluations, use the get-interpolation-weights option" << endl;
                 return false;
         }
+        if ( stream != stream_none ){
+                return evaluateStream( std::cin, std::cout );
+        }
         double *points = 0;
         int num_p, num_d;
         readMatrix( num_p, num_d, points, in_filename );
         if ( grid.getNumDimensions() != num_d ){
                 cerr << "ERROR: wrong number of dimensions, there are " << num_d << " provided, but the grid is set for " << grid.getNumDimensions() << endl;
-                delete points;
+                delete[] points;
                 return false;
         }
         double *res = new double[num_p * grid.getNumOutputs()];
-        for( int i=0; i<num_p; i++ ){
-                grid.evaluate( &(points[i*num_d]), &(res[i*num_o]) );
-        }
+        grid.evaluateBatch( points, num_p, res );
         if ( out_filename != 0 ){
                 writeMatrix( num_p, num_o, res, out_filename );
         }
@@ -310,6 +483,63 @@ bool GridWrapper::evaluate(){
         delete[] points;
         return true;
 }
+bool GridWrapper::evaluateStream( std::istream &is, std::ostream &os ){
+        // each chunk has the layout of a matrix file: text chunks are "rows cols" followed by the rows,
+        // binary chunks are two ints followed by the doubles, the values are written in the same format
+        // and flushed so the next chunk can depend on them
+        int num_d = grid.getNumDimensions();
+        int num_o = grid.getNumOutputs();
+        std::vector<double> points, res;
+        os.precision(17);
+        while( true ){
+                int header[2];
+                bool end_of_stream; // the stream may end only between two chunks, a partial header is an error
+                if ( stream == stream_binary ){
+                        is.read( (char*) header, 2*sizeof(int) );
+                        end_of_stream = is.eof() && (is.gcount() == 0);
+                }else{
+                        is >> std::ws;
+                        end_of_stream = is.eof();
+                        if ( !end_of_stream ) is >> header[0] >> header[1];
+                }
+                if ( end_of_stream ) return true;
+                if ( is.fail() ){
+                        cerr << "ERROR: could not read the size of the next chunk" << endl;
+                        return false;
+                }
+                if ( (header[0] < 0) || (header[1] != num_d) ){
+                        cerr << "ERROR: wrong chunk " << header[0] << " by " << header[1] << ", the grid is set for " << num_d << " dimensions" << endl;
+                        return false;
+                }
+                int num_p = header[0];
+                points.resize( ((size_t) num_p) * num_d + 1 );
+                res.resize( ((size_t) num_p) * num_o + 1 );
+                if ( stream == stream_binary ){
+                        is.read( (char*) &(points[0]), ((size_t) num_p) * num_d * sizeof(double) );
+                }else{
+                        for( size_t i=0; i<((size_t) num_p) * num_d; i++ ) is >> points[i];
+                }
+                if ( is.fail() ){
+                        cerr << "ERROR: the stream ended in the middle of a chunk" << endl;
+                        return false;
+                }
+                grid.evaluateBatch( &(points[0]), num_p, &(res[0]) );
+                if ( stream == stream_binary ){
+                        header[1] = num_o;
+                        os.write( (const char*) header, 2*sizeof(int) );
+                        os.write( (const char*) &(res[0]), ((size_t) num_p) * num_o * sizeof(double) );
+                }else{
+                        os << num_p << " " << num_o << "\n";
+                        for( int i=0; i<num_p; i++ ){
+                                for( int j=0; j<num_o; j++ ){
+                                        os << setw(25) << std::scientific << res[((size_t) i) * num_o + j] << " ";
+                                }
+                                os << "\n";
+                        }
+                }
+                os.flush();
+        }
+}
 bool GridWrapper::getInterWeights(){
         if ( !readGrid() ) return false;
         double *points = 0;
@@ -317,7 +547,7 @@ bool GridWrapper::getInterWeights(){
         readMatrix( num_p, num_d, points, in_filename );
         if ( grid.getNumDimensions() != num_d ){
                 cerr << "ERROR: wrong number of dimensions, there are " << num_d << " provided, but the grid is set for " << grid.getNumDimensions() << endl;
-                delete points;
+                delete[] points;
                 return false;
         }
         int num_w = grid.getNumPoints();
@@ -380,9 +610,8 @@ bool GridWrapper::printInfo(){
 
 void GridWrapper::makeGrid(){
         if ( isTensor ){
-                //int indx[num_dimensions];
-				std::vector<int> indx_vec;
-				int* indx = &indx_vec[0];
+                std::vector<int> indx_vec( num_dimensions );
+                int* indx = &indx_vec[0];
                 if ( anisotropic_filename != 0 ){
                         int rows, cols;
                         double *float_anisotropic = 0;
@@ -432,9 +661,8 @@ bool GridWrapper::recycleGrid(){
                 grid.recycleWaveletGrid( depth, order );
         }else{
                 if ( grid.isFullTensor() ){
-                        //int indx[num_dimensions];
-						std::vector<int> indx_vec;
-						int *indx = &indx_vec[0];
+                        std::vector<int> indx_vec( num_dimensions );
+                        int *indx = &indx_vec[0];
                         if ( anisotropic_filename != 0 ){
                                 int rows, cols;
                                 double *float_anisotropic = 0;
@@ -480,7 +708,7 @@ bool GridWrapper::readGrid(){
 }
 void GridWrapper::writeGrid(){
         if ( grid_filename != 0 ){
-                grid.write( grid_filename );
+                grid.write( grid_filename, binary, compressed );
         }
 }
 bool GridWrapper::refine(){
@@ -493,4 +721,353 @@ bool GridWrapper::refine(){
         return true;
 }
 
+static const char* benchmarkRuleName( TasGrid::TypeOneDRule rule ){ // the names used by -onedim
+        switch( rule ){
+                case TasGrid::rule_clenshawcurtis: return "clenshaw-curtis";
+                case TasGrid::rule_chebyshev: return "chebyshev";
+                case TasGrid::rule_chebyshevN2P: return "chebyshev-nested-twopoint";
+                case TasGrid::rule_gausslegendre: return "gauss-legendre";
+                case TasGrid::rule_gausschebyshev1: return "gauss-chebyshev-1";
+                case TasGrid::rule_gausschebyshev2: return "gauss-chebyshev-2";
+                case TasGrid::rule_fejer2: return "fejer-2";
+                case TasGrid::rule_gaussgegenbauer: return "gauss-gegenbauer";
+                case TasGrid::rule_gaussjacobi: return "gauss-jacobi";
+                case TasGrid::rule_gausslaguerre: return "gauss-laguerre";
+                case TasGrid::rule_gausshermite: return "gauss-hermite";
+                case TasGrid::rule_pwpolynomial: return "local-polynomial";
+                case TasGrid::rule_pwpolynomial0: return "local-polynomial-zero";
+                case TasGrid::rule_wavelet: return "local-wavelet";
+                default: return "unknown";
+        }
+}
+static void benchmarkWriteStats( std::ostream &os, const char *name, std::vector<double> &t, bool last ){
+        // nearest rank percentiles of the sorted times, in seconds
+        std::sort( t.begin(), t.end() );
+        size_t n = t.size();
+        double median = ( n % 2 == 1 ) ? t[n/2] : 0.5 * ( t[n/2 - 1] + t[n/2] );
+        size_t p90 = (size_t) ceil( 0.9 * n ) - 1;
+        os << "        \"" << name << "\": { \"min\": " << t[0] << ", \"median\": " << median
+           << ", \"p90\": " << t[p90] << ", \"max\": " << t[n-1] << " }" << ( last ? "" : "," ) << "\n";
+}
+
+bool GridWrapper::benchmark(){
+        static const TasGrid::TypeOneDRule all_rules[] = {
+                TasGrid::rule_clenshawcurtis, TasGrid::rule_chebyshev, TasGrid::rule_chebyshevN2P, TasGrid::rule_gausslegendre, TasGrid::rule_gausschebyshev1,
+                TasGrid::rule_gausschebyshev2, TasGrid::rule_fejer2, TasGrid::rule_gaussgegenbauer, TasGrid::rule_gaussjacobi,
+                TasGrid::rule_gausslaguerre, TasGrid::rule_gausshermite, TasGrid::rule_pwpolynomial, TasGrid::rule_pwpolynomial0,
+                TasGrid::rule_wavelet };
+        std::vector<TasGrid::TypeOneDRule> rules;
+        if ( oned == TasGrid::rule_base ){
+                for( size_t i=0; i<sizeof(all_rules) / sizeof(TasGrid::TypeOneDRule); i++ ){
+                        // full tensor grids implement only the global rules without the nested two-point Chebyshev rule
+                        if ( isTensor && ( (all_rules[i] == TasGrid::rule_chebyshevN2P) || (all_rules[i] == TasGrid::rule_pwpolynomial)
+                                        || (all_rules[i] == TasGrid::rule_pwpolynomial0) || (all_rules[i] == TasGrid::rule_wavelet) ) ) continue;
+                        rules.push_back( all_rules[i] );
+                }
+        }else{
+                rules.push_back( oned );
+        }
+        TasGrid::TypeOneDRule requested_oned = oned;
+
+        // the points for evaluate() cover [0,1]^d, which is inside the domain of every rule
+        int num_x = TASGRID_BENCHMARK_POINTS;
+        std::vector<double> x( ((size_t) num_x) * num_dimensions );
+        for( int i=0; i<num_x; i++ ){
+                for( int j=0; j<num_dimensions; j++ ){
+                        double a = (i + 1) * sqrt( 2.0 + j ); // Kronecker sequence
+                        x[((size_t) i) * num_dimensions + j] = a - floor( a );
+                }
+        }
+
+        std::ostringstream json;
+        json.precision(6);
+        json << std::scientific;
+        json << "{\n  \"tasgrid_benchmark\": { \"version\": \"" << getVersion() << "\", \"repetitions\": " << repeat
+             << ", \"evaluate_points\": " << num_x << ", \"unit\": \"seconds\" },\n";
+        json << "  \"grids\": [\n";
+        for( size_t r=0; r<rules.size(); r++ ){
+                oned = rules[r];
+                bool has_values = ( num_outputs > 0 );
+                bool can_refine = has_values && !isTensor; // refinement of full tensor grids is not supported
+                const char *names[] = { "make", "loadNeededPoints", "evaluate", "evaluateBatch", "integrate", "getWeights", "write", "read", "setRefinement" };
+                bool active[] = { true, has_values, has_values, has_values, has_values, true, true, true, can_refine };
+                const int num_ops = 9;
+                std::vector< std::vector<double> > times( num_ops );
+                std::vector<double> values, y( ((size_t) num_x) * num_outputs + 1 );
+                int num_points = 0;
+                for( int k=0; k<repeat; k++ ){
+                        double t[num_ops];
+                        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                        makeGrid();
+                        std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+                        t[0] = std::chrono::duration<double>( stop - start ).count();
+                        num_points = grid.getNumPoints();
+                        if ( has_values ){
+                                if ( values.empty() ){ // the same grid is made every time, the values are computed only once
+                                        double *p = 0;
+                                        grid.getNeededPoints( p );
+                                        values.resize( ((size_t) num_points) * num_outputs );
+                                        for( int i=0; i<num_points; i++ ){
+                                                double s = 0.0;
+                                                for( int j=0; j<num_dimensions; j++ ) s += p[((size_t) i) * num_dimensions + j] * p[((size_t) i) * num_dimensions + j];
+                                                for( int j=0; j<num_outputs; j++ ) values[((size_t) i) * num_outputs + j] = exp( -s / (j + 1) );
+                                        }
+                                        delete[] p;
+                                }
+                                start = std::chrono::steady_clock::now();
+                                grid.loadNeededPoints( &(values[0]) );
+                                stop = std::chrono::steady_clock::now();
+                                t[1] = std::chrono::duration<double>( stop - start ).count();
+
+                                start = std::chrono::steady_clock::now();
+                                for( int i=0; i<num_x; i++ ) grid.evaluate( &(x[((size_t) i) * num_dimensions]), &(y[((size_t) i) * num_outputs]) );
+                                stop = std::chrono::steady_clock::now();
+                                t[2] = std::chrono::duration<double>( stop - start ).count();
+
+                                start = std::chrono::steady_clock::now();
+                                grid.evaluateBatch( &(x[0]), num_x, &(y[0]) );
+                                stop = std::chrono::steady_clock::now();
+                                t[3] = std::chrono::duration<double>( stop - start ).count();
+
+                                start = std::chrono::steady_clock::now();
+                                grid.integrate( &(y[0]) );
+                                stop = std::chrono::steady_clock::now();
+                                t[4] = std::chrono::duration<double>( stop - start ).count();
+                        }
+                        double *w = 0;
+                        start = std::chrono::steady_clock::now();
+                        grid.getWeights( w );
+                        stop = std::chrono::steady_clock::now();
+                        t[5] = std::chrono::duration<double>( stop - start ).count();
+                        delete[] w;
+
+                        char *buffer = 0;
+                        size_t length = 0;
+                        start = std::chrono::steady_clock::now();
+                        grid.writeBuffer( buffer, length );
+                        stop = std::chrono::steady_clock::now();
+                        t[6] = std::chrono::duration<double>( stop - start ).count();
+
+                        TasGrid::TasmanianSparseGrid copy;
+                        start = std::chrono::steady_clock::now();
+                        bool pass = copy.readBuffer( buffer, length );
+                        stop = std::chrono::steady_clock::now();
+                        t[7] = std::chrono::duration<double>( stop - start ).count();
+                        delete[] buffer;
+                        if ( !pass ){
+                                cerr << "ERROR: could not read back the " << benchmarkRuleName( oned ) << " grid" << endl;
+                                oned = requested_oned;
+                                return false;
+                        }
+
+                        if ( can_refine ){
+                                start = std::chrono::steady_clock::now();
+                                grid.setRefinement( tolerance, refinement );
+                                stop = std::chrono::steady_clock::now();
+                                t[8] = std::chrono::duration<double>( stop - start ).count();
+                        }
+                        for( int i=0; i<num_ops; i++ ) if ( active[i] ) times[i].push_back( t[i] );
+                }
+
+                json << "    { \"rule\": \"" << benchmarkRuleName( oned ) << "\", \"tensor\": " << ( isTensor ? "true" : "false" )
+                     << ", \"dimensions\": " << num_dimensions << ", \"outputs\": " << num_outputs << ", \"depth\": " << depth
+                     << ", \"order\": " << order << ", \"points\": " << num_points << ",\n";
+                json << "      \"timings\": {\n";
+                int last = 0;
+                for( int i=0; i<num_ops; i++ ) if ( active[i] ) last = i;
+                for( int i=0; i<num_ops; i++ ){
+                        if ( active[i] ) benchmarkWriteStats( json, names[i], times[i], i == last );
+                }
+                json << "      }\n    }" << ( (r + 1 < rules.size()) ? "," : "" ) << "\n";
+        }
+        json << "  ]\n}\n";
+        oned = requested_oned;
+
+        if ( out_filename != 0 ){
+                std::ofstream ofs( out_filename );
+                ofs << json.str();
+        }
+        if ( print || (out_filename == 0) ){
+                cout << json.str();
+        }
+        return true;
+}
+
+#ifdef TASGRID_HAS_SOCKETS
+static bool serveRead( int fd, void *data, size_t length ){ // returns false if the connection is closed
+        char *p = (char*) data;
+        while( length > 0 ){
+                ssize_t n = recv( fd, p, length, 0 );
+                if ( n <= 0 ){
+                        if ( (n < 0) && (errno == EINTR) ) continue;
+                        return false;
+                }
+                p += n; length -= (size_t) n;
+        }
+        return true;
+}
+static bool serveWrite( int fd, const void *data, size_t length ){
+        const char *p = (const char*) data;
+        while( length > 0 ){
+                ssize_t n = send( fd, p, length, 0 );
+                if ( n <= 0 ){
+                        if ( (n < 0) && (errno == EINTR) ) continue;
+                        return false;
+                }
+                p += n; length -= (size_t) n;
+        }
+        return true;
+}
+
+// the workers take a reference to the current grid for each request, reload swaps the reference
+class GridServer{
+public:
+        GridServer( const char *filename ) : grid_filename( filename ){}
+        ~GridServer(){}
+
+        bool reload(){ // reads the grid file given on the command line, clients cannot pick another file
+                std::shared_ptr<TasGrid::TasmanianSparseGrid> new_grid( new TasGrid::TasmanianSparseGrid() );
+                if ( !new_grid->read( grid_filename.c_str() ) ) return false;
+                std::lock_guard<std::mutex> lock( grid_lock );
+                grid = new_grid;
+                return true;
+        }
+        std::shared_ptr<const TasGrid::TasmanianSparseGrid> getGrid(){
+                std::lock_guard<std::mutex> lock( grid_lock );
+                return grid;
+        }
+
+        void serveConnection( int fd ){ // answers the requests until the client closes the connection or breaks the framing
+                std::vector<double> in, out;
+                int request[4];
+                while( serveRead( fd, request, sizeof(request) ) ){
+                        int command = request[0], rows = request[1], cols = request[2];
+                        if ( (rows < 0) || (cols < 0) ) return;
+                        size_t in_size = ( command == serve_reload ) ? ((size_t) rows) : ((size_t) rows) * cols * sizeof(double);
+                        if ( in_size > TASGRID_SERVE_MAX_REQUEST ) return;
+                        in.resize( in_size / sizeof(double) + 1 );
+                        if ( !serveRead( fd, &(in[0]), in_size ) ) return;
+
+                        std::shared_ptr<const TasGrid::TasmanianSparseGrid> g = getGrid();
+                        int answer[4] = { serve_ok, 0, 0, 0 };
+                        if ( command == serve_info ){
+                                answer[1] = 1; answer[2] = 3;
+                                out.resize( 3 );
+                                out[0] = g->getNumDimensions(); out[1] = g->getNumOutputs(); out[2] = g->getNumPoints();
+                        }else if ( (command == serve_evaluate) || (command == serve_integrate) ){
+                                if ( g->getNumOutputs() == 0 ){
+                                        answer[0] = serve_no_outputs;
+                                }else if ( !g->hasLoadedValues() ){
+                                        answer[0] = serve_no_values;
+                                }else if ( command == serve_integrate ){
+                                        answer[1] = 1; answer[2] = g->getNumOutputs();
+                                        out.resize( g->getNumOutputs() );
+                                        g->integrate( &(out[0]) );
+                                }else if ( cols != g->getNumDimensions() ){
+                                        answer[0] = serve_wrong_size;
+                                }else if ( ((size_t) rows) * g->getNumOutputs() * sizeof(double) > TASGRID_SERVE_MAX_REQUEST ){
+                                        answer[0] = serve_too_large;
+                                }else{
+                                        answer[1] = rows; answer[2] = g->getNumOutputs();
+                                        out.resize( ((size_t) rows) * answer[2] + 1 );
+                                        g->evaluateBatch( &(in[0]), rows, &(out[0]) );
+                                }
+                        }else if ( command == serve_interweights ){
+                                if ( g->getNumPoints() == 0 ){
+                                        answer[0] = serve_no_values;
+                                }else if ( cols != g->getNumDimensions() ){
+                                        answer[0] = serve_wrong_size;
+                                }else if ( ((size_t) rows) * g->getNumPoints() * sizeof(double) > TASGRID_SERVE_MAX_REQUEST ){
+                                        answer[0] = serve_too_large;
+                                }else{
+                                        answer[1] = rows; answer[2] = g->getNumPoints();
+                                        out.resize( ((size_t) rows) * answer[2] + 1 );
+                                        g->fillInterpolantWeightsBatch( &(in[0]), rows, &(out[0]) );
+                                }
+                        }else if ( command == serve_reload ){
+                                std::string filename( (const char*) &(in[0]), (size_t) rows );
+                                if ( !filename.empty() && (filename != grid_filename) ){
+                                        answer[0] = serve_not_allowed;
+                                }else if ( !reload() ){
+                                        answer[0] = serve_read_failed;
+                                }
+                        }else{
+                                answer[0] = serve_unknown_command;
+                        }
+                        g.reset();
+                        if ( !serveWrite( fd, answer, sizeof(answer) ) ) return;
+                        if ( (answer[1] > 0) && (answer[2] > 0) && !serveWrite( fd, out.data(), ((size_t) answer[1]) * answer[2] * sizeof(double) ) ) return;
+                }
+        }
+        void serveConnectionSafe( int fd ){ // a request that runs out of memory only closes its own connection
+                try{
+                        serveConnection( fd );
+                }catch( std::bad_alloc& ){
+                        cerr << "ERROR: out of memory while answering a request, closing the connection" << endl;
+                }
+        }
+
+private:
+        std::string grid_filename;
+        std::shared_ptr<const TasGrid::TasmanianSparseGrid> grid;
+        std::mutex grid_lock;
+};
+#endif
+
+bool GridWrapper::serve(){
+#ifdef TASGRID_HAS_SOCKETS
+        GridServer server( grid_filename );
+        if ( !server.reload() ){
+                cerr << "ERROR: could not read from grid file " << grid_filename << endl;
+                return false;
+        }
+
+        struct sockaddr_un address;
+        memset( &address, 0, sizeof(address) );
+        address.sun_family = AF_UNIX;
+        if ( strlen( socket_filename ) >= sizeof(address.sun_path) ){
+                cerr << "ERROR: the socket filename " << socket_filename << " is too long" << endl;
+                return false;
+        }
+        strcpy( address.sun_path, socket_filename );
+        int sock = socket( AF_UNIX, SOCK_STREAM, 0 );
+        unlink( socket_filename ); // a socket left over from a previous server
+        mode_t old_mask = umask( 0177 ); // the socket is created with mode 0600, only the owner of the server can connect
+        bool bound = (sock != -1) && (bind( sock, (struct sockaddr*) &address, sizeof(address) ) == 0);
+        umask( old_mask );
+        if ( !bound || (listen( sock, 64 ) != 0) ){
+                cerr << "ERROR: could not listen on socket " << socket_filename << endl;
+                if ( sock != -1 ) close( sock );
+                return false;
+        }
+        signal( SIGPIPE, SIG_IGN ); // a client that disconnects early only ends its own connection
+
+        // each worker serves one connection at a time, further clients wait in the queue of the socket
+        int num_workers = (int) std::thread::hardware_concurrency();
+        if ( num_workers < TASGRID_SERVE_MIN_WORKERS ) num_workers = TASGRID_SERVE_MIN_WORKERS;
+        cout << "serving " << grid_filename << " on " << socket_filename << " with " << num_workers << " workers" << endl;
+        std::vector<std::thread> workers;
+        for( int i=0; i<num_workers; i++ ){
+                workers.push_back( std::thread( [&](){
+                        while( true ){
+                                int fd = accept( sock, 0, 0 );
+                                if ( fd == -1 ){
+                                        if ( (errno == EINTR) || (errno == ECONNABORTED) ) continue;
+                                        break;
+                                }
+                                server.serveConnectionSafe( fd );
+                                close( fd );
+                        }
+                } ) );
+        }
+        for( int i=0; i<num_workers; i++ ) workers[i].join();
+        close( sock );
+        unlink( socket_filename );
+        return false; // the workers only stop if the socket fails
+#else
+        cerr << "ERROR: -serve needs Unix domain sockets, which are not available on this platform" << endl;
+        return false;
+#endif
+}
+
 #endif
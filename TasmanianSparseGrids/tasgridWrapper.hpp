@@ -38,7 +38,31 @@ enum Operations{
         op_getquadrature, op_makequadrature,
         op_loadvalues, op_evaluate, op_getinterweights, op_integrate,
         op_refine, op_recycle,
-        op_info
+        op_info, op_serve, op_benchmark
+};
+
+enum StreamFormat{
+        stream_none, stream_text, stream_binary
+};
+
+// requests to the server start with four ints { command, rows, cols, 0 } followed by rows * cols doubles,
+// except for serve_reload where the payload is a file name of rows bytes, the server only reloads the grid file given on
+// the command line, so the name must be empty or the same as that file
+// every answer starts with four ints { status, rows, cols, 0 } followed by rows * cols doubles, all in native byte order
+// neither the request nor the answer may be larger than TASGRID_SERVE_MAX_REQUEST bytes
+enum ServeCommand{
+        serve_info = 0, // answers { num_dimensions, num_outputs, num_points }
+        serve_evaluate = 1, // rows points, answers rows by num_outputs values
+        serve_integrate = 2, // answers the num_outputs integrals
+        serve_interweights = 3, // rows points, answers rows by num_points interpolation weights
+        serve_reload = 4 // reads the grid file again and swaps it with the current grid, requests that are running finish with the old grid
+};
+
+enum ServeStatus{
+        serve_ok = 0, serve_unknown_command = 1, serve_wrong_size = 2, serve_read_failed = 3, serve_no_outputs = 4,
+        serve_too_large = 5, // the answer would exceed TASGRID_SERVE_MAX_REQUEST bytes or could not be allocated
+        serve_not_allowed = 6, // reload of a file other than the one given on the command line
+        serve_no_values = 7 // evaluate or integrate before the values are loaded, or interpolation weights for a grid without points
 };
 
 class GridWrapper{
@@ -50,6 +74,7 @@ public:
         void setInFilename( const char * filename );
         void setOutFilename( const char * filename );
         void setAnisotropicFilename( const char * filename );
+        void setSocketFilename( const char * filename );
 
         void setNumDimensions( int n );
         void setNumOutputs( int n );
@@ -66,6 +91,12 @@ public:
 
         void setPrint( bool p );
 
+        void setBinary( bool b ); // write the grid file in binary format
+        void setCompressed( bool c ); // write the grid file in compressed binary format
+        void setNpy( bool n ); // write the matrix files in .npy format (also used for any output file ending with .npy)
+        void setRepeat( int r ); // number of repetitions of each operation for -benchmark
+        void setStream( StreamFormat f ); // evaluate reads the points from stdin and writes the values to stdout, one chunk at a time
+
         void setAlpha( double a );
         void setBeta( double b );
 
@@ -88,10 +119,13 @@ protected:
         bool getQuadrature();
         bool loadValues(); // loads the values from a file into the grid
         bool evaluate(); // evaluates the surrogate model at the points
+        bool evaluateStream( std::istream &is, std::ostream &os ); // answers each chunk of points as soon as it is read, until the end of is
         bool getInterWeights(); // get the interpolation weights for a bunch of points
         bool integrate();
         bool refine();
         bool printInfo(); // prints info about the grid
+        bool serve(); // answers the requests on a Unix domain socket until the process is terminated
+        bool benchmark(); // times the grid operations and writes the statistics in JSON format
 
         void makeGrid();
         bool readGrid();
@@ -102,7 +136,9 @@ protected:
 
         void writeMatrix( int rows, int cols, double x[], const char *filename ) const;
         void printMatrix( int rows, int cols, double x[] ) const;
-        void readMatrix( int &rows, int &cols, double* &x, const char *filename ) const;
+        void readMatrix( int &rows, int &cols, double* &x, const char *filename ) const; // text or .npy format, detected automatically
+        void writeMatrixNpy( int rows, int cols, double x[], const char *filename ) const;
+        bool readMatrixNpy( int &rows, int &cols, double* &x, std::ifstream &ifs ) const;
 
 private:
         Operations todo;
@@ -120,11 +156,17 @@ private:
         double tolerance;
 
         bool print;
+        bool binary;
+        bool compressed;
+        bool npy;
+        StreamFormat stream;
+        int repeat;
 
         const char * grid_filename;
         const char * in_filename;
         const char * out_filename;
         const char * anisotropic_filename;
+        const char * socket_filename;
 
         TasGrid::TasmanianSparseGrid grid;
 
@@ -64,14 +64,32 @@ int main( int argc, const char ** argv ){
                 bool *tests = new bool[num_tests];
                 for( int i=0; i<num_tests; i++ ){ tests[i] = false; }
 
+                const char *baseline = 0;
+                bool record = false;
+                double time_tolerance = TASGRID_PERF_TIME_TOLERANCE, error_tolerance = TASGRID_PERF_ERROR_TOLERANCE;
                 int k = 2, t;
                 while ( k < argc ){
                         if ( (strcmp(argv[k],"info") == 0) ){ info = true; }
-                        if ( (strcmp(argv[k],"all") == 0) ){ all = true; }
-                        t = atoi( argv[k] );
-                        if ( (t>=0)&&(t<num_tests) ){ tests[t] = true; }
+                        else if ( (strcmp(argv[k],"all") == 0) ){ all = true; }
+                        else if ( (strcmp(argv[k],"perf") == 0) ){ tests[4] = true; }
+                        else if ( (strcmp(argv[k],"-record") == 0) ){ record = true; }
+                        else if ( (strcmp(argv[k],"-baseline") == 0) && (k+1 < argc) ){ baseline = argv[++k]; }
+                        else if ( (strcmp(argv[k],"-timetolerance") == 0) && (k+1 < argc) ){ time_tolerance = atof( argv[++k] ); }
+                        else if ( (strcmp(argv[k],"-errortolerance") == 0) && (k+1 < argc) ){ error_tolerance = atof( argv[++k] ); }
+                        else{
+                                t = atoi( argv[k] );
+                                if ( (t>=0)&&(t<num_tests) ){ tests[t] = true; }
+                        }
                         k++;
                 }
+                if ( record && (baseline == 0) ){
+                        cerr << "ERROR: -record requires -baseline <filename>" << endl;
+                        delete[] tests;
+                        return 1;
+                }
+                if ( baseline != 0 ){ tests[4] = true; } // the baseline is only used by the performance test
+                tester.setBaseline( baseline, record );
+                tester.setTolerances( time_tolerance, error_tolerance );
 
                 if ( info ){
                         tester.printInfo();
@@ -89,10 +107,10 @@ int main( int argc, const char ** argv ){
                         tests[0] = true;
                 }
 
-                tester.performTests( tests );
+                bool pass = tester.performTests( tests );
 
                 delete[] tests;
-                return 0;
+                return ( pass ) ? 0 : 1;
         }
 
         GridWrapper wrap;
@@ -125,6 +143,10 @@ int main( int argc, const char ** argv ){
                 wrap.setOperation( op_refine );
         }else if ( (strcmp(argv[1],"-summary") == 0) || (strcmp(argv[1],"-s") == 0) ){
                 wrap.setOperation( op_info );
+        }else if ( (strcmp(argv[1],"-serve") == 0) ){
+                wrap.setOperation( op_serve );
+        }else if ( (strcmp(argv[1],"-benchmark") == 0) ){
+                wrap.setOperation( op_benchmark );
         }else{
                 printUsage();
                 return 1;
@@ -141,6 +163,21 @@ int main( int argc, const char ** argv ){
                                 printUsage();
                                 return 0;
                         }
+                }else if ( (strcmp(argv[k],"-repeat") == 0) ){
+                        if ( k+1 < argc ){
+                                wrap.setRepeat( atoi( argv[++k] ) );
+                        }else{
+                                printUsage();
+                                return 0;
+                        }
+                }else if ( (strcmp(argv[k],"-socket") == 0) ){
+                        if ( k+1 < argc ){
+                                wrap.setSocketFilename( argv[++k] );
+                        }else{
+                                cerr << "ERROR: must provide socket file!!!" << endl << endl;
+                                printUsage();
+                                return 0;
+                        }
                 }else if ( (strcmp(argv[k],"-of") == 0)||(strcmp(argv[k],"-outputfile") == 0) ){
                         if ( k+1 < argc ){
                                 wrap.setOutFilename( argv[++k] );
@@ -301,6 +338,8 @@ int main( int argc, const char ** argv ){
                                         wrap.setOneDim( TasGrid::rule_clenshawcurtis );
                                 }else if ( (strcmp(argv[k],"chebyshev") == 0) ){
                                         wrap.setOneDim( TasGrid::rule_chebyshev );
+                                }else if ( (strcmp(argv[k],"chebyshev-nested-twopoint") == 0) ){
+                                        wrap.setOneDim( TasGrid::rule_chebyshevN2P );
                                 }else if ( (strcmp(argv[k],"gauss-chebyshev-1") == 0) ){
                                         wrap.setOneDim( TasGrid::rule_gausschebyshev1 );
                                 }else if ( (strcmp(argv[k],"gauss-chebyshev-2") == 0) ){
@@ -323,6 +362,8 @@ int main( int argc, const char ** argv ){
                                         wrap.setOneDim( TasGrid::rule_pwpolynomial0 );
                                 }else if ( (strcmp(argv[k],"local-wavelet") == 0) ){
                                         wrap.setOneDim( TasGrid::rule_wavelet );
+                                }else if ( (strcmp(argv[k],"all") == 0) ){
+                                        wrap.setOneDim( TasGrid::rule_base ); // every rule, only for -benchmark
                                 }else{
                                         cerr << "ERROR: wrong 1-D rule!!!" << endl << endl;
                                         printUsage(); return 1;
@@ -333,6 +374,21 @@ int main( int argc, const char ** argv ){
                         }
                 }else if ( (strcmp(argv[k],"-p") == 0)||(strcmp(argv[k],"-print") == 0) ){
                         wrap.setPrint( true );
+                }else if ( (strcmp(argv[k],"-bin") == 0)||(strcmp(argv[k],"-binary") == 0) ){
+                        wrap.setBinary( true );
+                }else if ( (strcmp(argv[k],"-cmp") == 0)||(strcmp(argv[k],"-compress") == 0) ){
+                        wrap.setCompressed( true );
+                }else if ( (strcmp(argv[k],"-npy") == 0) ){
+                        wrap.setNpy( true );
+                }else if ( (strcmp(argv[k],"-stream") == 0) ){
+                        if ( (k+1 < argc) && (strcmp(argv[k+1],"binary") == 0) ){
+                                wrap.setStream( stream_binary ); k++;
+                        }else if ( (k+1 < argc) && (strcmp(argv[k+1],"text") == 0) ){
+                                wrap.setStream( stream_text ); k++;
+                        }else{
+                                cerr << "ERROR: the stream format must be text or binary!!!" << endl << endl;
+                                printUsage(); return 1;
+                        }
                 };
                 k++;
         }
@@ -355,11 +411,14 @@ void printUsage( bool verbose ){
         cout << "  -version "<< endl << "             show the current version of the library and wrapper" << endl;
         //cout << "  -test <info/all/integers>"<< endl << "             conduct a series of tests" << endl;
         cout << "  -test "<< endl << "             conduct a series of functionality tests" << endl;
+        cout << "  -test perf [-baseline <filename> [-record]] [-timetolerance <double>] [-errortolerance <double>]"<< endl
+             << "             time a fixed set of cases, -record writes the baseline, otherwise the run is compared against it" << endl
+             << "             and the exit code is non-zero if a case is slower or less accurate than the tolerances allow" << endl;
         cout << "  -dimensions <int>"<< endl << "             set the number of dimensions" << endl;
         cout << "  -outputs <int>"<< endl << "             set the number of outputs" << endl;
         cout << "  -depth <int>"<< endl << "             set the depth of the grid (e.g. levels)" << endl;
         cout << "  -type <level/basis/hyperbolic/tensor>"<< endl << "             set the type of the grid (levels or basis)" << endl;
-        cout << "  -onedim <clenshaw-curtis,chebyshev,gauss-legendre,gauss-chebyshev-1,gauss-chebyshev-2,fejer-2,gauss-gegenbauer,gauss-jacobi,gauss-laguerre,gauss-hermite,local-polynomial,local-polynomial-zero,local-wavelet>"<< endl << "             set the one dimensional rule (e.g. clenshaw-curtis)" << endl;
+        cout << "  -onedim <clenshaw-curtis,chebyshev,chebyshev-nested-twopoint,gauss-legendre,gauss-chebyshev-1,gauss-chebyshev-2,fejer-2,gauss-gegenbauer,gauss-jacobi,gauss-laguerre,gauss-hermite,local-polynomial,local-polynomial-zero,local-wavelet,all>"<< endl << "             set the one dimensional rule (e.g. clenshaw-curtis), all is only for -benchmark" << endl;
         cout << "  -order <int>"<< endl << "             set the order for local polynomial basis" << endl;
         cout << "  -alpha <double>" << endl << "             the alpha parameter for Gauss-Gegenbauer/Jacobi/Laguerre/Hermite quadrature" << endl;
         cout << "  -beta <double>" << endl << "             the beta parameter for Gauss-Jacobi quadrature" << endl;
@@ -368,8 +427,15 @@ void printUsage( bool verbose ){
         cout << "  -outputfile <filename>"<< endl << "             set the name for the output file" << endl;
         cout << "  -gridfile <filename>"<< endl << "             set the name for the grid file" << endl;
         cout << "  -anisotropyfile <filename>"<< endl << "             set the anisotropic weights" << endl;
+        cout << "  -repeat <int>"<< endl << "             set the number of repetitions of each operation for -benchmark" << endl;
+        cout << "  -socket <filename>"<< endl << "             set the name of the Unix domain socket for -serve (only the owner can connect)" << endl;
         cout << "  -refinement <classic/parents/direction/fds>" << endl << "             set the type of refinement, whether it should include the parents or directions or both" << endl;
         cout << "  -print"<< endl << "             print to standard output just as if it is outputfile" << endl;
+        cout << "  -binary"<< endl << "             write the grid file in binary format (reading detects the format automatically)" << endl;
+        cout << "  -compress"<< endl << "             write the grid file in compressed binary format (smaller files for large grids)" << endl;
+        cout << "  -npy"<< endl << "             write the output file in NumPy .npy format (also used if the name ends with .npy, input .npy files are detected automatically)" << endl;
+        cout << "  -stream <text/binary>"<< endl << "             with -evaluate, read chunks of points from stdin and write the values of each chunk to stdout" << endl;
+        cout << "             text chunks are \"rows cols\" followed by the points, binary chunks are two ints followed by the doubles" << endl;
 
         cout << endl;
         cout << "  -makegrid"<< endl << "             make a grid, output the sample poitns" << endl;
@@ -384,6 +450,10 @@ void printUsage( bool verbose ){
         cout << "  -integrate"<< endl << "             reads a grid from file and outputs the integral" << endl;
         cout << "  -refine"<< endl << "             reads a grid from file and refines the grid" << endl;
         cout << "  -summary"<< endl << "             reads a grid from file and writes short description" << endl;
+        cout << "  -benchmark"<< endl << "             makes the grid (every rule with -onedim all) -repeat times and writes the timings of the grid operations in JSON format" << endl;
+        cout << "  -serve"<< endl << "             reads a grid from file and answers evaluate, integrate, interpolation weights and reload requests on the socket" << endl;
+        cout << "             reload reads the grid file again, other files cannot be loaded through the socket" << endl;
+        cout << "             (see ServeCommand in tasgridWrapper.hpp for the format of the requests)" << endl;
 
 
         cout << endl << "  Shorthand command aliases" << endl;
@@ -402,6 +472,8 @@ void printUsage( bool verbose ){
         cout << "    -af    -anisotropyfile" << endl;
         cout << "    -rt    -refinement" << endl;
         cout << "    -p     -print" << endl;
+        cout << "    -bin   -binary" << endl;
+        cout << "    -cmp   -compress" << endl;
         cout << "    -mg    -makegrid" << endl;
         cout << "    -mq    -makequadrature" << endl;
         cout << "    -rcy   -recycle" << endl;
@@ -420,6 +492,7 @@ void printUsage( bool verbose ){
                 cout << "List of available 1-D rules:" << endl;
                 cout << setw(20) << "clenshaw-curtis" << "  Clenshaw-Curtis rule, aka nested Chebychev" << endl;
                 cout << setw(20) << "chebychev" << "  Chebychev rule (not nested)" << endl;
+                cout << setw(20) << "chebyshev-nested-twopoint" << "  Chebyshev rule nested by adding two points per level, not for -type tensor" << endl;
                 cout << setw(20) << "fejer-2" << "  Fejer type 2 rule" << endl;
                 cout << setw(20) << "gauss-legendre" << "  Gauss-Legendre rule" << endl;
                 cout << setw(20) << "gauss-chebyshev-1" << "  Gauss-Chebyshev rule of type 1" << endl;
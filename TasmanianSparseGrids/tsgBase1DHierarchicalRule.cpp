@@ -40,6 +40,7 @@ int OneDHierarchicalRule::getNumPoints( int level ) const{ return -1; };
 int OneDHierarchicalRule::getBasisLevel( int level ) const{ return -1; };
 
 TypeOneDRule OneDHierarchicalRule::getType() const{ return rule_base; };
+size_t OneDHierarchicalRule::getMemoryUsage() const{ return 0; };
 const char * OneDHierarchicalRule::getDescription() const{ return "ERROR: calling base hierarchical rule"; };
 
 double OneDHierarchicalRule::getX( int point ) const{ return 0.0; };
@@ -43,6 +43,7 @@ public:
         virtual int getBasisLevel( int level ) const; // returns the basis level associated with the level, i.e. 0, 2, 4, 8, 16, 32 for CC points, or 1, 3, 5, 7, 9 for Gaussian, 0, 1, 2, 3, 4 for PW-Power
 
         virtual TypeOneDRule getType() const; // returns the type of rule
+        virtual size_t getMemoryUsage() const; // bytes allocated for the tables of nodes and weights
         virtual const char * getDescription() const;
 
         virtual double getX( int point ) const; // returns the x-value of a point
@@ -43,6 +43,7 @@ double OneDRule::getX( int point ) const{ return 0.0; };
 double OneDRule::getWeight( int level, int point ) const{ return 0.0; };
 double OneDRule::eval( int level, int point, double x ) const{ return 0.0; };
 TypeOneDRule OneDRule::getType() const{ return rule_base; };
+size_t OneDRule::getMemoryUsage() const{ return 0; };
 
 };
 
@@ -43,6 +43,7 @@ public:
         virtual void getPoints( int level, int* &pnts ) const; // returns the points associated with level
 
         virtual TypeOneDRule getType() const; // returns the type of rule
+        virtual size_t getMemoryUsage() const; // bytes allocated for the tables of nodes and weights
         virtual const char * getDescription() const;
 
         virtual double getX( int point ) const; // returns the x-value of a point
@@ -27,8 +27,102 @@
 
 #include "tsgBaseGrid.hpp"
 
+#ifdef TSG_PROFILING
+#include <chrono>
+#endif
+
 namespace TasGrid{
 
+GridProfile::GridProfile(){ clear(); }
+void GridProfile::clear(){
+#ifdef TSG_PROFILING
+        enabled = true;
+#else
+        enabled = false;
+#endif
+        for( int i=0; i<profile_num_phases; i++ ){ count[i] = 0; seconds[i] = 0.0; }
+        solver_iterations = 0;
+}
+void GridProfile::add( const GridProfile &other ){
+        for( int i=0; i<profile_num_phases; i++ ){
+                count[i] += other.count[i];
+                seconds[i] += other.seconds[i];
+        }
+        solver_iterations += other.solver_iterations;
+}
+
+const char* getProfilePhaseName( TypeProfilePhase phase ){
+        switch( phase ){
+                case profile_construction: return "construction";
+                case profile_points: return "points";
+                case profile_surplus: return "surplus";
+                case profile_matrix: return "matrix";
+                case profile_solver: return "solver";
+                case profile_evaluate: return "evaluate";
+                case profile_refinement: return "refinement";
+                default: return "unknown";
+        }
+}
+
+GridMemory::GridMemory(){ clear(); }
+void GridMemory::clear(){
+        for( int i=0; i<memory_num_components; i++ ){ bytes[i] = 0; }
+}
+void GridMemory::add( const GridMemory &other ){
+        for( int i=0; i<memory_num_components; i++ ){ bytes[i] += other.bytes[i]; }
+}
+void GridMemory::addIndexSet( const IndexSet *set, TypeMemoryComponent list, TypeMemoryComponent map, TypeMemoryComponent values ){
+        if ( set == 0 ){ return; }
+        size_t list_bytes, map_bytes, value_bytes, mapped_bytes;
+        set->getMemoryUsage( list_bytes, map_bytes, value_bytes, mapped_bytes );
+        bytes[list] += list_bytes;
+        bytes[map] += map_bytes;
+        bytes[values] += value_bytes;
+        bytes[memory_mapped] += mapped_bytes;
+}
+size_t GridMemory::getTotal() const{
+        size_t total = 0;
+        for( int i=0; i<memory_num_components; i++ ){
+                if ( i != memory_mapped ){ total += bytes[i]; }
+        }
+        return total;
+}
+
+const char* getMemoryComponentName( TypeMemoryComponent component ){
+        switch( component ){
+                case memory_index_list: return "index list";
+                case memory_index_map: return "index map";
+                case memory_values: return "values";
+                case memory_needed_points: return "needed points";
+                case memory_tensors: return "tensors";
+                case memory_tensor_weights: return "tensor weights";
+                case memory_surplus: return "surplus";
+                case memory_matrix: return "matrix";
+                case memory_rules: return "rules";
+                case memory_mapped: return "mapped";
+                case memory_refinement: return "refinement";
+                default: return "unknown";
+        }
+}
+
+#ifdef TSG_PROFILING
+static double profileClock(){
+        return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+ProfileTimer::ProfileTimer( GridProfile &p, TypeProfilePhase ph ) : profile(p), phase(ph), start(profileClock()){}
+ProfileTimer::~ProfileTimer(){
+        double elapsed = profileClock() - start;
+        #pragma omp atomic
+        profile.count[phase]++;
+        #pragma omp atomic
+        profile.seconds[phase] += elapsed;
+}
+void ProfileTimer::addIterations( GridProfile &p, int iterations ){
+        #pragma omp atomic
+        p.solver_iterations += iterations;
+}
+#endif
+
 Grid::Grid(){};
 Grid::~Grid(){};
 
@@ -40,17 +134,24 @@ int Grid::getNumOutputs() const{ return -1; };
 TypeOneDRule Grid::getOneDRule() const{ return rule_base; };
 const char *Grid::getOneDRuleDescription() const{ return "ERROR: calling the base grid class"; };
 
-void Grid::write( std::ofstream &ofs ) const{}; // write the grid to a file
-bool Grid::read( std::ifstream &ifs ){ return false; }; // reads the grid
+void Grid::write( std::ostream &ofs ) const{}; // write the grid to a file
+bool Grid::read( std::istream &ifs ){ return false; }; // reads the grid
+void Grid::writeBinary( std::ostream &ofs, bool compressed ) const{};
+bool Grid::readBinary( std::istream &ifs ){ return false; };
+bool Grid::mapBinary( const char* &data, const char *end ){ return false; };
 
 int Grid::getNumPoints() const{ return -1; };
 
 void Grid::getPoints( double* &pnts ) const{};
 void Grid::getWeights( double* &pnts ) const{};
 void Grid::getInterpolantWeights( const double x[], double* &weights ) const{};
+void Grid::fillPoints( double pnts[] ) const{};
+void Grid::fillWeights( double weights[] ) const{};
+void Grid::fillInterpolantWeights( const double x[], double weights[] ) const{};
 
 int Grid::getNumNeededPoints() const{ return -1; };
 void Grid::getNeededPoints( double* &pnts ) const{};
+void Grid::fillNeededPoints( double pnts[] ) const{};
 void Grid::loadNeededPoints( const double vals[] ){};
 void Grid::loadNeededPoints( const IndexSet *data ){}
 
@@ -63,6 +164,12 @@ void Grid::setState( const IndexSet* state ) {}; // copy the tensors and/or poin
 void Grid::getData( IndexSet* &data ){};
 void Grid::getUpdateState( IndexSet* &update, double tol, TypeRefinement criteria ) const{};
 void Grid::setUpdate( const IndexSet *update ){}; // creates a grid with the data updates
+
+void Grid::getMemoryUsage( GridMemory &memory ) const{}
+
+const GridProfile& Grid::getProfile() const{ return profile; }
+void Grid::addProfile( const GridProfile &other ){ profile.add( other ); }
+void Grid::clearProfile(){ profile.clear(); }
 }
 
 #endif
@@ -32,6 +32,51 @@
 
 namespace TasGrid{
 
+// the calls and wall time of each phase, the counters are collected only if the library is compiled with TSG_PROFILING
+struct GridProfile{
+        GridProfile();
+        void clear();
+        void add( const GridProfile &other ); // sums the counters, e.g., to carry the totals over to a refined grid
+
+        bool enabled; // true if the library is compiled with TSG_PROFILING, otherwise all counters are zero
+        long long count[profile_num_phases];
+        double seconds[profile_num_phases];
+        long long solver_iterations; // conjugate gradient iterations, direct solves count as calls with no iterations
+};
+
+const char* getProfilePhaseName( TypeProfilePhase phase ); // short name used by printStats() and the metrics, e.g., "evaluate"
+
+// bytes used by a grid, broken down by component, the arrays are counted by their allocated size
+struct GridMemory{
+        GridMemory();
+        void clear();
+        void add( const GridMemory &other );
+        void addIndexSet( const IndexSet *set, TypeMemoryComponent list, TypeMemoryComponent map, TypeMemoryComponent values ); // null sets are skipped
+        size_t getTotal() const; // all components except the mapped data
+
+        size_t bytes[memory_num_components];
+};
+
+const char* getMemoryComponentName( TypeMemoryComponent component );
+
+#ifdef TSG_PROFILING
+class ProfileTimer{ // adds one call and the time until the timer goes out of scope, safe to use from many threads
+public:
+        ProfileTimer( GridProfile &p, TypeProfilePhase ph );
+        ~ProfileTimer();
+        static void addIterations( GridProfile &p, int iterations );
+private:
+        GridProfile &profile;
+        TypeProfilePhase phase;
+        double start;
+};
+#define TSG_PROFILE( phase ) ProfileTimer tsg_profile_timer( profile, phase )
+#define TSG_PROFILE_ITERATIONS( iterations ) ProfileTimer::addIterations( profile, iterations )
+#else
+#define TSG_PROFILE( phase )
+#define TSG_PROFILE_ITERATIONS( iterations )
+#endif
+
 class Grid{
 public:
         Grid();
@@ -45,17 +90,26 @@ public:
         virtual TypeOneDRule getOneDRule() const;
         virtual const char *getOneDRuleDescription() const;
 
-        virtual void write( std::ofstream &ofs ) const; // write the grid to a file
-        virtual bool read( std::ifstream &ifs ); // reads the grid
+        virtual void write( std::ostream &ofs ) const; // write the grid to a file
+        virtual bool read( std::istream &ifs ); // reads the grid
+        virtual void writeBinary( std::ostream &ofs, bool compressed ) const; // same as write, but using raw (native) binary data
+        // compressed writes the index lists in frames of variable length integers, such data cannot be memory mapped
+        virtual bool readBinary( std::istream &ifs );
+        virtual bool mapBinary( const char* &data, const char *end ); // same as readBinary, but uses the large arrays in data in place
 
         virtual int getNumPoints() const;
 
         virtual void getPoints( double* &pnts ) const;
         virtual void getWeights( double* &weights ) const;
         virtual void getInterpolantWeights( const double x[], double* &weights ) const;
+        // the fill functions are the same as the get functions, but write into an already allocated array
+        virtual void fillPoints( double pnts[] ) const;
+        virtual void fillWeights( double weights[] ) const;
+        virtual void fillInterpolantWeights( const double x[], double weights[] ) const;
 
         virtual int getNumNeededPoints() const;
         virtual void getNeededPoints( double* &pnts ) const;
+        virtual void fillNeededPoints( double pnts[] ) const;
         virtual void loadNeededPoints( const double vals[] );
         virtual void loadNeededPoints( const IndexSet *data );
 
@@ -70,6 +124,15 @@ public:
         virtual void getUpdateState( IndexSet* &update, double tol, TypeRefinement criteria ) const; // give the new set of points or tensors
         virtual void setUpdate( const IndexSet *update ); // creates a grid with the data updates
         // setUpdate loses all loaded data
+
+        virtual void getMemoryUsage( GridMemory &memory ) const; // adds the bytes used by the grid to memory
+
+        const GridProfile& getProfile() const;
+        void addProfile( const GridProfile &other ); // keeps the totals when the grid replaces an older one
+        void clearProfile();
+
+protected:
+        mutable GridProfile profile; // updated by the const functions too, e.g., evaluate()
 };
 
 }
@@ -74,6 +74,32 @@ enum TypeRefinement{
         refine_classic, refine_parents_first, refine_direction_selective, refine_fds /* FDS = parents_first + direction_selective */
 };
 
+enum TypeProfilePhase{ // the phases timed by the grids when compiled with TSG_PROFILING, see GridProfile
+        profile_construction, // reset() of the grid, i.e., the make and recycle functions
+        profile_points, // tensors and points of the global grids (makeTensorsArray(), makePoints())
+        profile_surplus, // hierarchical surpluses (local polynomial) and coefficients (wavelet) after the values are loaded
+        profile_matrix, // assembly and factorization of the sparse interpolation matrix (wavelet)
+        profile_solver, // one call for each right hand side solved with the interpolation matrix (wavelet)
+        profile_evaluate, // evaluate() at one point
+        profile_refinement, // getUpdateState(), setState() and setUpdate()
+        profile_num_phases
+};
+
+enum TypeMemoryComponent{ // the parts of a grid reported by getMemoryUsage(), see GridMemory
+        memory_index_list, // multi-indexes of the points (IndexSet pList)
+        memory_index_map, // maps the points to the values (IndexSet vMap)
+        memory_values, // values of the model at the points (IndexSet vList)
+        memory_needed_points, // the copy of the points that still need values
+        memory_tensors, // tensor list, the points of each tensor and the references to the values (global and full tensor grids)
+        memory_tensor_weights, // global grids
+        memory_surplus, // hierarchical surpluses (local polynomial) or coefficients (wavelet)
+        memory_matrix, // interpolation matrix (CSR) and its LU factors (wavelet)
+        memory_rules, // tables of the one dimensional rules
+        memory_mapped, // data used in place from a memory mapped file or shared memory segment, not in the total
+        memory_refinement, // all components of the refined grid that waits for values after setRefinement()
+        memory_num_components
+};
+
 
 };
 
@@ -31,13 +31,13 @@
 namespace TasGrid{
 
 FullTensorGrid::FullTensorGrid() : rule1D(0), ruleType(rule_base), num_dimensions(0), num_outputs(0),  points(0), needed_points(0), tensor_index(0), report_tensor_order(0), alpha(0), beta(0),
-        ch_rule(0), cc_rule(0), gl_rule(0), gc1_rule(0), gc2_rule(0), f2_rule(0), gg_rule(0), gj_rule(0), gh_rule(0)
+        ch_rule(0), cc_rule(0), gl_rule(0), gc1_rule(0), gc2_rule(0), f2_rule(0), gg_rule(0), gj_rule(0), ggl_rule(0), gh_rule(0)
 {
 }
 
 FullTensorGrid::FullTensorGrid( int dimensions, int outputs, const int order[], TypeOneDRule oned, const double *alpha_beta ) : rule1D(0), ruleType(rule_base), num_dimensions(0), num_outputs(0),
         points(0), needed_points(0), tensor_index(0), report_tensor_order(0), alpha(0), beta(0),
-        ch_rule(0), cc_rule(0), gl_rule(0), gc1_rule(0), gc2_rule(0), f2_rule(0), gg_rule(0), gj_rule(0), gh_rule(0)
+        ch_rule(0), cc_rule(0), gl_rule(0), gc1_rule(0), gc2_rule(0), f2_rule(0), gg_rule(0), gj_rule(0), ggl_rule(0), gh_rule(0)
 {
         reset( dimensions, outputs, order, oned, alpha_beta );
 }
@@ -113,6 +113,7 @@ void FullTensorGrid::makeOnedRule( int level ){
 }
 
 void FullTensorGrid::reset( int dimensions, int outputs, const int order[], TypeOneDRule oned, const double *alpha_beta ){
+        TSG_PROFILE( profile_construction );
         clear();
         ruleType = oned;
 
@@ -164,7 +165,7 @@ int FullTensorGrid::getNumOutputs() const{ return num_outputs; }
 TypeOneDRule FullTensorGrid::getOneDRule() const{ return ruleType; }
 const char *FullTensorGrid::getOneDRuleDescription() const{ return rule1D->getDescription(); }
 
-void FullTensorGrid::write( std::ofstream &ofs ) const{ // write the grid to a file
+void FullTensorGrid::write( std::ostream &ofs ) const{ // write the grid to a file
         ofs << "num_dimensions: " << num_dimensions << endl;
         ofs << "num_outputs: " << num_outputs << endl;
         ofs << "alpha: "; twrite( 1, &alpha, ofs );
@@ -201,18 +202,18 @@ void FullTensorGrid::write( std::ofstream &ofs ) const{ // write the grid to a f
         }
 }
 
-bool FullTensorGrid::read( std::ifstream &ifs ){ // reads the grid
+bool FullTensorGrid::read( std::istream &ifs ){ // reads the grid
         clear();
         std::string T;
-        ifs >> T; if ( !(T.compare( "num_dimensions:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code FT 1" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "num_dimensions:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code FT 1" << endl; clear(); return false; }
         ifs >> num_dimensions;
-        ifs >> T; if ( !(T.compare( "num_outputs:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code FT 2" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "num_outputs:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code FT 2" << endl; clear(); return false; }
         ifs >> num_outputs;
-        ifs >> T; if ( !(T.compare( "alpha:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 3" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "alpha:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 3" << endl; clear(); return false; }
         tread( 1, &alpha, ifs );
-        ifs >> T; if ( !(T.compare( "beta:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 4" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "beta:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 4" << endl; clear(); return false; }
         tread( 1, &beta, ifs );
-        ifs >> T; if ( !(T.compare( "ruleType:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code FT 6" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "ruleType:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code FT 6" << endl; clear(); return false; }
         ifs >> T;
         if ( T.compare("lagrange-chebyshev") == 0 ){       ruleType = rule_chebyshev; }else
         if ( T.compare("lagrange-clenshaw-curtis") == 0 ){ ruleType = rule_clenshawcurtis; }else
@@ -224,20 +225,20 @@ bool FullTensorGrid::read( std::ifstream &ifs ){ // reads the grid
         if ( T.compare("lagrange-gauss-jacobi") == 0 ){  ruleType = rule_gaussjacobi; }else
         if ( T.compare("lagrange-gauss-laguerre") == 0 ){  ruleType = rule_gausslaguerre; }else
         if ( T.compare("lagrange-gauss-hermite") == 0 ){  ruleType = rule_gausshermite; }else{
-                cerr << "ERROR: Wrong File Format! code FT 7" << endl; ifs.close(); clear(); return false;
+                cerr << "ERROR: Wrong File Format! code FT 7" << endl; clear(); return false;
         }
         if ( num_dimensions > 0 ){
-                ifs >> T; if ( !(T.compare( "Order:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code FT 8" << endl; ifs.close(); clear(); return false; }
+                ifs >> T; if ( !(T.compare( "Order:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code FT 8" << endl; clear(); return false; }
                 tensor_index = new int[num_dimensions];
                 tread( num_dimensions, tensor_index, ifs );
         }
 
-        ifs >> T; if ( !(T.compare( "Points:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code FT 10" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "Points:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code FT 10" << endl; clear(); return false; }
         ifs >> T;
         if ( T.compare("yes") == 0 ){
                 points = new IndexSet( num_dimensions, 0, num_outputs ); points->read( ifs );
         }
-        ifs >> T; if ( !(T.compare( "NeededPoints:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code FT 11" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "NeededPoints:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code FT 11" << endl; clear(); return false; }
         ifs >> T;
         if ( T.compare( "yes" ) == 0 ){
                 needed_points = new IndexSet( num_dimensions, 0, num_outputs );
@@ -256,6 +257,92 @@ bool FullTensorGrid::read( std::ifstream &ifs ){ // reads the grid
                 // relink to tensors
                 tensor.referenceValues( points );
         }
+        return true;
+}
+void FullTensorGrid::writeBinary( std::ostream &ofs, bool compressed ) const{
+        int flags[6] = { num_dimensions, num_outputs, (int) ruleType, (tensor_index != 0) ? 1 : 0, (points != 0) ? 1 : 0, (needed_points != 0) ? 1 : 0 };
+        twriteBinary( 6, flags, ofs );
+        double ab[2] = { alpha, beta };
+        twriteBinary( 2, ab, ofs );
+        if ( tensor_index != 0 ) twriteBinary( num_dimensions, tensor_index, ofs );
+        if ( points != 0 ) points->writeBinary( ofs, compressed );
+        if ( needed_points != 0 ) needed_points->writeBinary( ofs, compressed );
+}
+bool FullTensorGrid::readBinary( std::istream &ifs ){
+        clear();
+        int flags[6];
+        double ab[2];
+        if ( !treadBinary( 6, flags, ifs ) || !treadBinary( 2, ab, ifs ) ){ cerr << "ERROR: Wrong File Format! code FT 12" << endl; clear(); return false; }
+        num_dimensions = flags[0];
+        num_outputs = flags[1];
+        ruleType = (TypeOneDRule) flags[2];
+        alpha = ab[0]; beta = ab[1];
+        if ( (num_dimensions > 0) && (flags[3] == 0) ){ cerr << "ERROR: Wrong File Format! code FT 13" << endl; clear(); return false; }
+        bool pass = true;
+        if ( flags[3] == 1 ){
+                tensor_index = new int[num_dimensions];
+                pass = treadBinary( num_dimensions, tensor_index, ifs );
+        }
+        if ( flags[4] == 1 ){
+                points = new IndexSet( num_dimensions, 0, num_outputs );
+                pass = pass && points->readBinary( ifs );
+        }
+        if ( flags[5] == 1 ){
+                needed_points = new IndexSet( num_dimensions, 0, num_outputs );
+                pass = pass && needed_points->readBinary( ifs );
+        }
+        if ( !pass ){ cerr << "ERROR: Wrong File Format! code FT 14" << endl; clear(); return false; }
+
+        makeOnedRule( getMaxLevel() + 1 );
+        tensor.rebuild( num_dimensions, tensor_index, rule1D );
+
+        report_tensor_order = new IndexSet( num_dimensions, 1 );
+        report_tensor_order->add( tensor_index );
+
+        if ( num_outputs > 0 ){
+                tensor.referenceValues( points );
+        }
+        return true;
+}
+bool FullTensorGrid::mapBinary( const char* &data, const char *end ){
+        clear();
+        const int *flags, *list;
+        const double *ab;
+        if ( !tmapBinary( 6, flags, data, end ) || !tmapBinary( 2, ab, data, end ) || ((flags[0] > 0) && (flags[3] == 0)) ){
+                cerr << "ERROR: Wrong File Format! code FT 12" << endl; clear(); return false;
+        }
+        num_dimensions = flags[0];
+        num_outputs = flags[1];
+        ruleType = (TypeOneDRule) flags[2];
+        alpha = ab[0]; beta = ab[1];
+        bool pass = true;
+        if ( flags[3] == 1 ){
+                pass = tmapBinary( num_dimensions, list, data, end );
+                if ( pass ){
+                        tensor_index = new int[num_dimensions];
+                        tcopy( num_dimensions, list, tensor_index );
+                }
+        }
+        if ( flags[4] == 1 ){
+                points = new IndexSet( num_dimensions );
+                pass = pass && points->mapBinary( data, end );
+        }
+        if ( flags[5] == 1 ){
+                needed_points = new IndexSet( num_dimensions );
+                pass = pass && needed_points->mapBinary( data, end );
+        }
+        if ( !pass ){ cerr << "ERROR: Wrong File Format! code FT 14" << endl; clear(); return false; }
+
+        makeOnedRule( getMaxLevel() + 1 );
+        tensor.rebuild( num_dimensions, tensor_index, rule1D );
+
+        report_tensor_order = new IndexSet( num_dimensions, 1 );
+        report_tensor_order->add( tensor_index );
+
+        if ( num_outputs > 0 ){
+                tensor.referenceValues( points );
+        }
+        return true;
 }
 
 int FullTensorGrid::getNumPoints() const{ return ( points == 0 ) ? 0 : points->getNumIndexes(); }
@@ -263,6 +350,9 @@ int FullTensorGrid::getNumPoints() const{ return ( points == 0 ) ? 0 : points->g
 void FullTensorGrid::getPoints( double* &pnts ) const{
         if ( pnts != 0 ){ delete[] pnts; }
         pnts = new double[ num_dimensions * points->getNumIndexes() ];
+        fillPoints( pnts );
+}
+void FullTensorGrid::fillPoints( double pnts[] ) const{
         for( int i=0; i<points->getNumIndexes(); i++ ){
                 const int *point = points->getIndexList(i);
                 for( int j=0; j<num_dimensions; j++ ){
@@ -277,6 +367,12 @@ void FullTensorGrid::getWeights( double* &weights ) const{
 void FullTensorGrid::getInterpolantWeights( const double x[], double* &weights ) const{
         tensor.getInterpolantWeights( x, weights );
 }
+void FullTensorGrid::fillWeights( double weights[] ) const{
+        tensor.fillWeights( weights );
+}
+void FullTensorGrid::fillInterpolantWeights( const double x[], double weights[] ) const{
+        tensor.fillInterpolantWeights( x, weights );
+}
 
 int FullTensorGrid::getNumNeededPoints() const{ return (needed_points==0) ? 0 : needed_points->getNumIndexes(); }
 
@@ -285,6 +381,10 @@ void FullTensorGrid::getNeededPoints( double* &pnts ) const{
         if ( pnts != 0 ){ delete[] pnts; } pnts = 0;
         if ( num_points == 0 ) return;
         pnts = new double[ num_dimensions * num_points ];
+        fillNeededPoints( pnts );
+}
+void FullTensorGrid::fillNeededPoints( double pnts[] ) const{
+        int num_points = getNumNeededPoints();
         for( int i=0; i<num_points; i++ ){
                 const int *point = needed_points->getIndexList(i);
                 for( int j=0; j<num_dimensions; j++ ){
@@ -317,6 +417,7 @@ void FullTensorGrid::loadNeededPoints( const IndexSet *data ){
 }
 
 void FullTensorGrid::evaluate( const double x[], double y[] ) const{
+        TSG_PROFILE( profile_evaluate );
         tensor.eval( x, y );
 }
 
@@ -354,6 +455,7 @@ const IndexSet* FullTensorGrid::getState() const{ // returns enough information
         return report_tensor_order;
 }
 void FullTensorGrid::setState( const IndexSet* state ){ // copy the tensors and/or points
+        TSG_PROFILE( profile_refinement );
         TypeOneDRule oldRuleType = ruleType;
         int outputs = num_outputs;
         clear();
@@ -404,11 +506,12 @@ void FullTensorGrid::getData( IndexSet* &data ){ // returns a list of the set po
         }
 }
 void FullTensorGrid::getUpdateState( IndexSet* &update, double tol, TypeRefinement criteria ) const{ // give the new set of points or tensors
+        TSG_PROFILE( profile_refinement );
         if ( update != 0 ){ delete update; };
         update = new IndexSet( num_dimensions, 1 );
 
         //int indx[num_dimensions];
-		std::vector<int> indx_vec;
+		std::vector<int> indx_vec(num_dimensions);
 		int *indx = &indx_vec[0];
         tcopy( num_dimensions, tensor_index, indx );
 
@@ -416,6 +519,18 @@ void FullTensorGrid::getUpdateState( IndexSet* &update, double tol, TypeRefineme
 
         update->add( indx );
 }
+void FullTensorGrid::getMemoryUsage( GridMemory &memory ) const{
+        memory.addIndexSet( points, memory_index_list, memory_index_map, memory_values );
+        memory.addIndexSet( needed_points, memory_needed_points, memory_needed_points, memory_needed_points );
+        memory.addIndexSet( report_tensor_order, memory_tensors, memory_tensors, memory_tensors );
+        if ( tensor_index != 0 ){ memory.bytes[memory_tensors] += sizeof(int) * num_dimensions; }
+        memory.bytes[memory_tensors] += tensor.getMemoryUsage();
+        const OneDRule* rules[10] = { ch_rule, cc_rule, gl_rule, gc1_rule, gc2_rule, f2_rule, gg_rule, gj_rule, ggl_rule, gh_rule };
+        for( int i=0; i<10; i++ ){
+                if ( rules[i] != 0 ){ memory.bytes[memory_rules] += rules[i]->getMemoryUsage(); }
+        }
+}
+
 void FullTensorGrid::setUpdate( const IndexSet *update ){ // creates a grid with the data updates
         setState( update );
 }
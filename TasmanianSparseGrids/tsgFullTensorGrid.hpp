@@ -61,17 +61,24 @@ public:
         TypeOneDRule getOneDRule() const;
         const char *getOneDRuleDescription() const;
 
-        void write( std::ofstream &ofs ) const; // write the grid to a file
-        bool read( std::ifstream &ifs ); // reads the grid
+        void write( std::ostream &ofs ) const; // write the grid to a file
+        bool read( std::istream &ifs ); // reads the grid
+        void writeBinary( std::ostream &ofs, bool compressed ) const;
+        bool readBinary( std::istream &ifs );
+        bool mapBinary( const char* &data, const char *end );
 
         int getNumPoints() const;
 
         void getPoints( double* &pnts ) const;
         void getWeights( double* &weights ) const;
         void getInterpolantWeights( const double x[], double* &weights ) const;
+        void fillPoints( double pnts[] ) const;
+        void fillWeights( double weights[] ) const;
+        void fillInterpolantWeights( const double x[], double weights[] ) const;
 
         int getNumNeededPoints() const;
         void getNeededPoints( double* &pnts ) const;
+        void fillNeededPoints( double pnts[] ) const;
         void loadNeededPoints( const double vals[] );
         void loadNeededPoints( const IndexSet *data );
 
@@ -86,6 +93,8 @@ public:
         void getUpdateState( IndexSet* &update, double tol, TypeRefinement criteria ) const; // give the new set of points or tensors
         void setUpdate( const IndexSet *update ); // creates a grid with the data updates
 
+        void getMemoryUsage( GridMemory &memory ) const;
+
 protected:
         void clear();
         void clear1D();
@@ -30,7 +30,7 @@
 
 namespace TasGrid{
 
-GlobalGrid::GlobalGrid() : rule1D(0), ruleType(rule_base), num_dimensions(0), num_outputs(0), tensorList(0), tensorRules(0), points(0), needed_points(0), tensor_weights(0),
+GlobalGrid::GlobalGrid() : rule1D(0), ruleType(rule_base), num_dimensions(0), num_outputs(0), tensorList(0), tensorRules(0), tensors_linked(false), points(0), needed_points(0), tensor_weights(0),
         anisotropic(0), alpha(0.0), beta(0.0),
         ch_rule(0), cc_rule(0), gl_rule(0), tp_rule(0), gc1_rule(0), gc2_rule(0), f2_rule(0), gg_rule(0), gj_rule(0), ggl_rule(0), gh_rule(0)
 {
@@ -39,7 +39,7 @@ GlobalGrid::GlobalGrid() : rule1D(0), ruleType(rule_base), num_dimensions(0), nu
 GlobalGrid::GlobalGrid( int dimensions, int outputs, int depth, TypeDepth type, TypeOneDRule oned, const int *anisotropic_weights, const double *alpha_beta ) :
         rule1D(0), ruleType(rule_base), num_dimensions(0), num_outputs(0),
         anisotropic(0), alpha(0.0), beta(0.0),
-        tensorList(0), tensorRules(0), points(0), needed_points(0), tensor_weights(0),
+        tensorList(0), tensorRules(0), tensors_linked(false), points(0), needed_points(0), tensor_weights(0),
         ch_rule(0), cc_rule(0), gl_rule(0), tp_rule(0), gc1_rule(0), gc2_rule(0), f2_rule(0), gg_rule(0), gj_rule(0), ggl_rule(0), gh_rule(0)
 {
         reset( dimensions, outputs, depth, type, oned, anisotropic_weights, alpha_beta );
@@ -72,6 +72,7 @@ void GlobalGrid::clear(){
         if ( tensorList != 0 ){ delete tensorList; }; tensorList = 0;
         if ( points != 0 ){ delete points; }; points = 0;
         if ( tensorRules != 0 ){ delete[] tensorRules; }; tensorRules = 0;
+        tensors_linked.store( false, std::memory_order_relaxed );
         if ( tensor_weights != 0 ){ delete[] tensor_weights; }; tensor_weights = 0;
 
         if ( needed_points != 0){ delete needed_points; }; needed_points = 0;
@@ -83,6 +84,7 @@ double GlobalGrid::getAlpha() const{ return alpha; }
 double GlobalGrid::getBeta() const{ return beta; }
 
 void GlobalGrid::reset( int dimensions, int outputs, int depth, TypeDepth type, TypeOneDRule oned, const int *anisotropic_weights, const double *alpha_beta ){
+        TSG_PROFILE( profile_construction );
         clear();
         ruleType = oned;
 
@@ -127,7 +129,7 @@ TypeOneDRule GlobalGrid::getOneDRule() const{ return ruleType; }
 const char *GlobalGrid::getOneDRuleDescription() const{ return rule1D->getDescription(); }
 const int *GlobalGrid::getAnisotropic() const{ return anisotropic; }
 
-void GlobalGrid::write( std::ofstream &ofs ) const{ // write the grid to a file
+void GlobalGrid::write( std::ostream &ofs ) const{ // write the grid to a file
         ofs << "num_dimensions: " << num_dimensions << endl;
         ofs << "num_outputs: " << num_outputs << endl;
         ofs << "alpha: "; twrite( 1, &alpha, ofs );
@@ -183,19 +185,19 @@ void GlobalGrid::write( std::ofstream &ofs ) const{ // write the grid to a file
                 needed_points->write( ofs );
         }
 }
-bool GlobalGrid::read( std::ifstream &ifs ){ // reads the grid
+bool GlobalGrid::read( std::istream &ifs ){ // reads the grid
         clear();
         std::string T;
         ifs >> T;
-        if ( !(T.compare( "num_dimensions:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 1" << endl; ifs.close(); clear(); return false; }
+        if ( !(T.compare( "num_dimensions:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 1" << endl; clear(); return false; }
         ifs >> num_dimensions;
-        ifs >> T; if ( !(T.compare( "num_outputs:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 2" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "num_outputs:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 2" << endl; clear(); return false; }
         ifs >> num_outputs;
-        ifs >> T; if ( !(T.compare( "alpha:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 3" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "alpha:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 3" << endl; clear(); return false; }
         tread( 1, &alpha, ifs );
-        ifs >> T; if ( !(T.compare( "beta:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 4" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "beta:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 4" << endl; clear(); return false; }
         tread( 1, &beta, ifs );
-        ifs >> T; if ( !(T.compare( "ruleType:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 6" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "ruleType:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 6" << endl; clear(); return false; }
         ifs >> T;
         if ( T.compare("lagrange-chebyshev") == 0 ){       ruleType = rule_chebyshev; }else
         if ( T.compare("lagrange-clenshaw-curtis") == 0 ){ ruleType = rule_clenshawcurtis; }else
@@ -208,31 +210,31 @@ bool GlobalGrid::read( std::ifstream &ifs ){ // reads the grid
         if ( T.compare("lagrange-gauss-jacobi") == 0 ){  ruleType = rule_gaussjacobi; }else
         if ( T.compare("lagrange-gauss-laguerre") == 0 ){  ruleType = rule_gausslaguerre; }else
         if ( T.compare("lagrange-gauss-hermite") == 0 ){  ruleType = rule_gausshermite; }else{
-                cerr << "ERROR: Wrong File Format! code GG 7" << endl; ifs.close(); clear(); return false;
+                cerr << "ERROR: Wrong File Format! code GG 7" << endl; clear(); return false;
         }
-        ifs >> T; if ( !(T.compare( "Anisotropic:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 8" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "Anisotropic:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 8" << endl; clear(); return false; }
         ifs >> T;
         if ( T.compare("yes") == 0 ){
                 anisotropic = new int[num_dimensions+1];
                 tread( num_dimensions+1, anisotropic, ifs );
                 //tensorList = new IndexSet( num_dimensions, 0, num_outputs ); tensorList->read( ifs );
         }
-        ifs >> T; if ( !(T.compare( "Tensors:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 9" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "Tensors:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 9" << endl; clear(); return false; }
         ifs >> T;
         if ( T.compare("yes") == 0 ){
                 tensorList = new IndexSet( num_dimensions, 0, num_outputs ); tensorList->read( ifs );
         }
-        ifs >> T; if ( !(T.compare( "TensorWeights:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 10" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "TensorWeights:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 10" << endl; clear(); return false; }
         ifs >> T;
         if ( T.compare("yes") == 0 ){
                 tensor_weights = new int[tensorList->getNumIndexes()]; tread( tensorList->getNumIndexes(), tensor_weights, ifs );
         }
-        ifs >> T; if ( !(T.compare( "Points:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 11" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "Points:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 11" << endl; clear(); return false; }
         ifs >> T;
         if ( T.compare("yes") == 0 ){
                 points = new IndexSet( num_dimensions, 0, num_outputs ); points->read( ifs );
         }
-        ifs >> T; if ( !(T.compare( "NeededPoints:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 12" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "NeededPoints:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code GG 12" << endl; clear(); return false; }
         ifs >> T;
         if ( T.compare( "yes" ) == 0 ){
                 needed_points = new IndexSet( num_dimensions, 0, num_outputs );
@@ -241,17 +243,134 @@ bool GlobalGrid::read( std::ifstream &ifs ){ // reads the grid
                 needed_points = 0;
         }
 
+        makeDerivedData();
+
+        return true;
+}
+void GlobalGrid::writeBinary( std::ostream &ofs, bool compressed ) const{
+        int flags[8] = { num_dimensions, num_outputs, (int) ruleType, (anisotropic != 0) ? 1 : 0, (tensorList != 0) ? 1 : 0,
+                         (tensor_weights != 0) ? 1 : 0, (points != 0) ? 1 : 0, (needed_points != 0) ? 1 : 0 };
+        twriteBinary( 8, flags, ofs );
+        double ab[2] = { alpha, beta };
+        twriteBinary( 2, ab, ofs );
+        if ( anisotropic != 0 ) twriteBinary( num_dimensions+1, anisotropic, ofs );
+        if ( tensorList != 0 ) tensorList->writeBinary( ofs, compressed );
+        if ( tensor_weights != 0 ) twriteBinary( tensorList->getNumIndexes(), tensor_weights, ofs );
+        if ( points != 0 ) points->writeBinary( ofs, compressed );
+        if ( needed_points != 0 ) needed_points->writeBinary( ofs, compressed );
+}
+bool GlobalGrid::readBinary( std::istream &ifs ){
+        clear();
+        int flags[8];
+        double ab[2];
+        if ( !treadBinary( 8, flags, ifs ) ){ cerr << "ERROR: Wrong File Format! code GG 13" << endl; clear(); return false; }
+        num_dimensions = flags[0];
+        num_outputs = flags[1];
+        ruleType = (TypeOneDRule) flags[2];
+        if ( !treadBinary( 2, ab, ifs ) ){ cerr << "ERROR: Wrong File Format! code GG 14" << endl; clear(); return false; }
+        alpha = ab[0]; beta = ab[1];
+        if ( (flags[5] == 1) && (flags[4] == 0) ){ cerr << "ERROR: Wrong File Format! code GG 15" << endl; clear(); return false; }
+        bool pass = true;
+        if ( flags[3] == 1 ){
+                anisotropic = new int[num_dimensions+1];
+                pass = pass && treadBinary( num_dimensions+1, anisotropic, ifs );
+        }
+        if ( flags[4] == 1 ){
+                tensorList = new IndexSet( num_dimensions, 0, num_outputs );
+                pass = pass && tensorList->readBinary( ifs );
+        }
+        if ( pass && (flags[5] == 1) ){
+                tensor_weights = new int[tensorList->getNumIndexes()];
+                pass = treadBinary( tensorList->getNumIndexes(), tensor_weights, ifs );
+        }
+        if ( flags[6] == 1 ){
+                points = new IndexSet( num_dimensions, 0, num_outputs );
+                pass = pass && points->readBinary( ifs );
+        }
+        if ( flags[7] == 1 ){
+                needed_points = new IndexSet( num_dimensions, 0, num_outputs );
+                pass = pass && needed_points->readBinary( ifs );
+        }
+        if ( !pass ){ cerr << "ERROR: Wrong File Format! code GG 16" << endl; clear(); return false; }
+
+        makeDerivedData();
+
+        return true;
+}
+
+bool GlobalGrid::mapBinary( const char* &data, const char *end ){
+        clear();
+        const int *flags, *list;
+        const double *ab;
+        if ( !tmapBinary( 8, flags, data, end ) || !tmapBinary( 2, ab, data, end ) || ((flags[5] == 1) && (flags[4] == 0)) ){
+                cerr << "ERROR: Wrong File Format! code GG 13" << endl; clear(); return false;
+        }
+        num_dimensions = flags[0];
+        num_outputs = flags[1];
+        ruleType = (TypeOneDRule) flags[2];
+        alpha = ab[0]; beta = ab[1];
+        bool pass = true;
+        if ( flags[3] == 1 ){ // anisotropic weights and tensor weights are small, copy them
+                pass = tmapBinary( num_dimensions+1, list, data, end );
+                if ( pass ){
+                        anisotropic = new int[num_dimensions+1];
+                        tcopy( num_dimensions+1, list, anisotropic );
+                }
+        }
+        if ( flags[4] == 1 ){
+                tensorList = new IndexSet( num_dimensions );
+                pass = pass && tensorList->mapBinary( data, end );
+        }
+        if ( pass && (flags[5] == 1) ){
+                pass = tmapBinary( tensorList->getNumIndexes(), list, data, end );
+                if ( pass ){
+                        tensor_weights = new int[tensorList->getNumIndexes()];
+                        tcopy( tensorList->getNumIndexes(), list, tensor_weights );
+                }
+        }
+        if ( flags[6] == 1 ){
+                points = new IndexSet( num_dimensions );
+                pass = pass && points->mapBinary( data, end );
+        }
+        if ( flags[7] == 1 ){
+                needed_points = new IndexSet( num_dimensions );
+                pass = pass && needed_points->mapBinary( data, end );
+        }
+        if ( !pass ){ cerr << "ERROR: Wrong File Format! code GG 16" << endl; clear(); return false; }
+
+        makeDerivedData();
+
+        return true;
+}
+
+void GlobalGrid::makeDerivedData(){
         makeOnedRule( computeMaxLevel() + 1 );
-        makeTensorsArray();
-        if ( num_outputs > 0 ){
-                for( int t=0; t<tensorList->getNumIndexes(); t++ ){
+        if ( tensorRules != 0 ){ delete[] tensorRules; }; tensorRules = 0; // the tensors are expensive, delay until needed
+        tensors_linked.store( false, std::memory_order_relaxed );
+}
+void GlobalGrid::linkTensors() const{
+        // evaluate() and the weights call this from many threads, only the first calls after a read() need the lock
+        if ( tensors_linked.load( std::memory_order_acquire ) ) return;
+        #pragma omp critical (tsg_global_link_tensors)
+        {
+        if ( !tensors_linked.load( std::memory_order_relaxed ) ){
+                TSG_PROFILE( profile_points );
+                int num_tensors = tensorList->getNumIndexes();
+                TensorRule *rules = new TensorRule[ num_tensors ];
+                // only the tensors with non-zero weight are ever used after a read()
+                #pragma omp parallel for schedule(dynamic)
+                for( int t=0; t<num_tensors; t++ ){
                         if ( tensor_weights[t] != 0 ){
-                                tensorRules[t].referenceValues( points );
+                                rules[t].rebuild( num_dimensions, tensorList->getIndexList(t), rule1D );
+                                if ( num_outputs > 0 ){
+                                        rules[t].referenceValues( points );
+                                }
                         }
                 }
+                tensorRules = rules;
+                tensors_linked.store( true, std::memory_order_release );
+        }
         }
-
-        return true;
 }
 
 
@@ -260,6 +379,9 @@ int GlobalGrid::getNumPoints() const{ return ( points == 0 ) ? 0 : points->getNu
 void GlobalGrid::getPoints( double* &pnts ) const{
         if ( pnts != 0 ){ delete[] pnts; }
         pnts = new double[ num_dimensions * points->getNumIndexes() ];
+        fillPoints( pnts );
+}
+void GlobalGrid::fillPoints( double pnts[] ) const{
         for( int i=0; i<points->getNumIndexes(); i++ ){
                 const int *point = points->getIndexList(i);
                 for( int j=0; j<num_dimensions; j++ ){
@@ -268,9 +390,13 @@ void GlobalGrid::getPoints( double* &pnts ) const{
         }
 }
 void GlobalGrid::getWeights( double* &weights ) const{
-        int num_points = points->getNumIndexes();
         if ( weights != 0 ){ delete[] weights; };
-        weights = new double[num_points];
+        weights = new double[points->getNumIndexes()];
+        fillWeights( weights );
+}
+void GlobalGrid::fillWeights( double weights[] ) const{
+        linkTensors();
+        int num_points = points->getNumIndexes();
         tzero( num_points, weights );
 
         // for each tensor, add the weights
@@ -287,9 +413,13 @@ void GlobalGrid::getWeights( double* &weights ) const{
         }
 }
 void GlobalGrid::getInterpolantWeights( const double x[], double* &weights ) const{
-        int num_points = points->getNumIndexes();
         if ( weights != 0 ){ delete[] weights; };
-        weights = new double[num_points];
+        weights = new double[points->getNumIndexes()];
+        fillInterpolantWeights( x, weights );
+}
+void GlobalGrid::fillInterpolantWeights( const double x[], double weights[] ) const{
+        linkTensors();
+        int num_points = points->getNumIndexes();
         tzero( num_points, weights );
 
         // for each tensor, add the weights
@@ -313,6 +443,10 @@ void GlobalGrid::getNeededPoints( double* &pnts ) const{
         if ( pnts != 0 ){ delete[] pnts; } pnts = 0;
         if ( num_points == 0 ) return;
         pnts = new double[ num_dimensions * num_points ];
+        fillNeededPoints( pnts );
+}
+void GlobalGrid::fillNeededPoints( double pnts[] ) const{
+        int num_points = getNumNeededPoints();
         for( int i=0; i<num_points; i++ ){
                 const int *point = needed_points->getIndexList(i);
                 for( int j=0; j<num_dimensions; j++ ){
@@ -345,8 +479,10 @@ void GlobalGrid::loadNeededPoints( const IndexSet *data ){
 }
 
 void GlobalGrid::evaluate( const double x[], double y[] ) const{
+        TSG_PROFILE( profile_evaluate );
         tzero(num_outputs, y);
         if ( points->getNumIndexes() > points->getNumValues() ){ // if number of points is more
+                linkTensors();
                 double *tensor_y = new double[num_outputs];
                 for( int t=0; t<tensorList->getNumIndexes(); t++ ){
                         if ( tensor_weights[t] != 0 ){
@@ -405,6 +541,7 @@ void GlobalGrid::integrate( double y[] ) const{
 // refinement functions
 const IndexSet* GlobalGrid::getState() const{ return tensorList; };
 void GlobalGrid::setState( const IndexSet* state ){
+        TSG_PROFILE( profile_refinement );
         TypeOneDRule oldRuleType = ruleType;
         int outputs = num_outputs;
         clear();
@@ -442,6 +579,7 @@ void GlobalGrid::getData( IndexSet* &data ){
 }
 
 void GlobalGrid::getUpdateState( IndexSet* &update, double tol, TypeRefinement criteria )const{
+        TSG_PROFILE( profile_refinement );
         if ( update != 0 ){ delete update; };
         update = new IndexSet( num_dimensions );
 
@@ -461,7 +599,26 @@ void GlobalGrid::getUpdateState( IndexSet* &update, double tol, TypeRefinement c
                 }
         }
 };
+void GlobalGrid::getMemoryUsage( GridMemory &memory ) const{
+        memory.addIndexSet( points, memory_index_list, memory_index_map, memory_values );
+        memory.addIndexSet( needed_points, memory_needed_points, memory_needed_points, memory_needed_points );
+        memory.addIndexSet( tensorList, memory_tensors, memory_tensors, memory_tensors );
+        if ( tensorList != 0 ){
+                int num_tensors = tensorList->getNumIndexes();
+                if ( tensorRules != 0 ){
+                        memory.bytes[memory_tensors] += sizeof(TensorRule) * num_tensors;
+                        for( int t=0; t<num_tensors; t++ ){ memory.bytes[memory_tensors] += tensorRules[t].getMemoryUsage(); }
+                }
+                if ( tensor_weights != 0 ){ memory.bytes[memory_tensor_weights] += sizeof(int) * num_tensors; }
+        }
+        const OneDRule* rules[11] = { ch_rule, cc_rule, gl_rule, tp_rule, gc1_rule, gc2_rule, f2_rule, gg_rule, gj_rule, ggl_rule, gh_rule };
+        for( int i=0; i<11; i++ ){
+                if ( rules[i] != 0 ){ memory.bytes[memory_rules] += rules[i]->getMemoryUsage(); }
+        }
+}
+
 void GlobalGrid::setUpdate( const IndexSet *update ){
+        TSG_PROFILE( profile_refinement );
         tensorList->add( update );
 
         makeOnedRule( getMaxLevel(tensorList) );
@@ -599,11 +756,13 @@ void GlobalGrid::makeTensorList( int depth, TypeDepth type ){
 }
 
 void GlobalGrid::makeTensorsArray(){
+        TSG_PROFILE( profile_points );
         if ( tensorRules != 0 ){ delete[] tensorRules; };
         tensorRules = new TensorRule[ tensorList->getNumIndexes() ];
         for( int i=0; i<tensorList->getNumIndexes(); i++ ){
                 tensorRules[i].rebuild( num_dimensions, tensorList->getIndexList(i), rule1D );
         }
+        tensors_linked.store( true, std::memory_order_release );
 }
 
 void GlobalGrid::makeBalanceWeights(){
@@ -627,6 +786,7 @@ void GlobalGrid::makeBalanceWeights(){
 }
 
 void GlobalGrid::makePoints(){
+        TSG_PROFILE( profile_points );
         if ( points != 0 ){ delete points; }
         points = new IndexSet( num_dimensions, 0, num_outputs );
         for( int t=0; t<tensorList->getNumIndexes(); t++ ){
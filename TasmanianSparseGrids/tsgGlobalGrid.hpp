@@ -45,6 +45,8 @@
 
 #include "tsgTensorRule.hpp"
 
+#include <atomic>
+
 namespace TasGrid{
 
 class GlobalGrid : public Grid{
@@ -65,17 +67,24 @@ public:
         const char *getOneDRuleDescription() const;
         const int *getAnisotropic() const;
 
-        void write( std::ofstream &ofs ) const; // write the grid to a file
-        bool read( std::ifstream &ifs ); // reads the grid
+        void write( std::ostream &ofs ) const; // write the grid to a file
+        bool read( std::istream &ifs ); // reads the grid
+        void writeBinary( std::ostream &ofs, bool compressed ) const;
+        bool readBinary( std::istream &ifs );
+        bool mapBinary( const char* &data, const char *end );
 
         int getNumPoints() const;
 
         void getPoints( double* &pnts ) const;
         void getWeights( double* &weights ) const;
         void getInterpolantWeights( const double x[], double* &weights ) const;
+        void fillPoints( double pnts[] ) const;
+        void fillWeights( double weights[] ) const;
+        void fillInterpolantWeights( const double x[], double weights[] ) const;
 
         int getNumNeededPoints() const;
         void getNeededPoints( double* &pnts ) const;
+        void fillNeededPoints( double pnts[] ) const;
         void loadNeededPoints( const double vals[] );
         void loadNeededPoints( const IndexSet *data );
 
@@ -90,6 +99,8 @@ public:
         void getUpdateState( IndexSet* &update, double tol, TypeRefinement criteria ) const; // give the new set of points or tensors
         void setUpdate( const IndexSet *update ); // creates a grid with the data updates
 
+        void getMemoryUsage( GridMemory &memory ) const;
+
 protected:
         void clear();
         void clear1D();
@@ -106,6 +117,8 @@ protected:
         void makeTensorsArray();
         void makeBalanceWeights();
         void makePoints();
+        void makeDerivedData(); // after reading a file, rebuild the 1D rule, the tensors are made on first use
+        void linkTensors() const; // makes the tensors and links the values, if not made already
 
         int getLevelScale() const;
 
@@ -130,7 +143,8 @@ private:
         int *tensor_weights;
 
         IndexSet *tensorList;
-        TensorRule *tensorRules;
+        mutable TensorRule *tensorRules; // may be null after read(), see linkTensors()
+        mutable std::atomic<bool> tensors_linked; // set after tensorRules is complete, lets linkTensors() skip the lock
         IndexSet *points;
 
         IndexSet *needed_points;
@@ -74,6 +74,48 @@ namespace TasGrid{
 // this is done to avoid division by a very small number
 #define RELATIVE_ABSOLUTE_TRESHOLD 1.E-8
 
+// the wavelet grid uses a direct (sparse LU) solver for the interpolation matrix as long as
+// the factors have at most WAVELET_LU_MAX_FILL times the non-zeros of the matrix and
+// the factorization takes at most WAVELET_LU_MAX_WORK times nnz multiply-add operations,
+// otherwise it falls back to the iterative (conjugate gradient) solver
+// linear wavelets usually need less than 20 * nnz operations, cubic ones a few hundred or more
+#define WAVELET_LU_MAX_FILL 4.0
+#define WAVELET_LU_MAX_WORK 64.0
+// the factorization is not even attempted for wavelets of higher order than this, the cubic wavelets overlap across
+// all levels and their factors are nearly dense (e.g., 5.6 times the non-zeros of the matrix at 2D depth 5)
+#define WAVELET_LU_MAX_ORDER 1
+
+// when assembling the interpolation matrix, the wavelet grid tabulates all one dimensional
+// wavelets at all one dimensional nodes, as long as the table has at most this many entries
+// (8388608 doubles = 64MB), deeper grids evaluate the wavelets on the fly
+#define WAVELET_MAX_TABLE_SIZE 8388608
+
+// compressed binary files store the index lists in frames of at most this many entries,
+// reading or writing a list never buffers more than one frame (at most 5 bytes per entry)
+// this is part of the file format, files with larger frames are rejected
+#define BINARY_FRAME_ENTRIES 65536
+
+// the grids count the calls and measure the wall time of each phase (see TypeProfilePhase) only if the library is
+// compiled with TSG_PROFILING defined (make PROFILE=1), otherwise the counters stay zero and cost nothing
+// the phases nest, e.g., the construction of a global grid includes the time to make the tensors and points
+//#define TSG_PROFILING
+
+// tasgrid -serve answers each connection on one worker thread and uses at least this many workers,
+// requests with more than TASGRID_SERVE_MAX_REQUEST bytes of payload close the connection
+#define TASGRID_SERVE_MIN_WORKERS 4
+#define TASGRID_SERVE_MAX_REQUEST 2147483648UL
+
+// tasgrid -benchmark times evaluate() at this many points, both one at a time and as one batch
+#define TASGRID_BENCHMARK_POINTS 1000
+
+// tasgrid -test perf, each case is timed this many times and the fastest run is kept
+#define TASGRID_PERF_REPEAT 5
+// default relative slowdown and relative error growth before a case fails against the baseline
+#define TASGRID_PERF_TIME_TOLERANCE 0.25
+#define TASGRID_PERF_ERROR_TOLERANCE 0.1
+// slowdowns smaller than this (in seconds) are timer noise and never fail
+#define TASGRID_PERF_MIN_SECONDS 2.E-2
+
 
 }
 
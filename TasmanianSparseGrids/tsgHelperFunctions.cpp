@@ -26,6 +26,7 @@
 #define __TASMANIAN_SPARSE_GRID_HELPER_CPP
 
 #include "tsgHelperFunctions.hpp"
+#include <vector>
 
 namespace TasGrid{
 
@@ -39,11 +40,11 @@ void tcopy( int size, const double source[], double destination[]  ){
         for( int i=0; i<size; i++ ){ destination[i] = source[i]; }
 }
 
-void twrite( int size, const int list[], std::ofstream &ofs ){
+void twrite( int size, const int list[], std::ostream &ofs ){
         for( int i=0; i<size; i++ ){ ofs << list[i] << " "; }
         ofs << endl;
 }
-void twrite( int size, const double list[], std::ofstream &ofs ){
+void twrite( int size, const double list[], std::ostream &ofs ){
         ofs << std::scientific; ofs.precision( 17 );
         for( int i=0; i<size; i++ ){ ofs << list[i] << " "; }
         ofs << endl;
@@ -55,13 +56,131 @@ int tsum( int size, const int index[] ){
         return sum;
 }
 
-void tread( int size, int list[], std::ifstream &ifs ){
+void tread( int size, int list[], std::istream &ifs ){
         for( int i=0; i<size; i++ ){ ifs >> list[i]; }
 }
-void tread( int size, double list[], std::ifstream &ifs ){
+void tread( int size, double list[], std::istream &ifs ){
         for( int i=0; i<size; i++ ){ ifs >> list[i]; }
 }
 
+void twriteBinary( int size, const int list[], std::ostream &ofs ){
+        if ( size <= 0 ) return;
+        ofs.write( (const char*) list, size * sizeof(int) );
+        if ( (size * sizeof(int)) % 8 != 0 ){
+                const char pad[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+                ofs.write( pad, 8 - (size * sizeof(int)) % 8 );
+        }
+}
+void twriteBinary( int size, const double list[], std::ostream &ofs ){
+        if ( size <= 0 ) return;
+        ofs.write( (const char*) list, size * sizeof(double) );
+}
+
+bool treadBinary( int size, int list[], std::istream &ifs ){
+        if ( size < 0 ) return false;
+        if ( size == 0 ) return true;
+        ifs.read( (char*) list, size * sizeof(int) );
+        if ( (size * sizeof(int)) % 8 != 0 ){
+                char pad[8]; // read instead of ignore(), which looks one character ahead
+                ifs.read( pad, 8 - (size * sizeof(int)) % 8 );
+        }
+        return ifs.good();
+}
+bool treadBinary( int size, double list[], std::istream &ifs ){
+        if ( size < 0 ) return false;
+        if ( size == 0 ) return true;
+        ifs.read( (char*) list, size * sizeof(double) );
+        return ifs.good();
+}
+
+void twriteFrames( int size, int stride, const int list[], std::ostream &ofs ){
+        std::vector<unsigned char> buffer_vec( 5 * BINARY_FRAME_ENTRIES + 8 );
+        unsigned char *buffer = &buffer_vec[0];
+        for( int start=0; start<size; start+=BINARY_FRAME_ENTRIES ){
+                int entries = ( size - start < BINARY_FRAME_ENTRIES ) ? size - start : BINARY_FRAME_ENTRIES;
+                int bytes = 0;
+                for( int i=start; i<start+entries; i++ ){
+                        // unsigned arithmetic, so that the difference wraps around instead of overflowing
+                        unsigned int delta = (unsigned int) list[i] - (( i < stride ) ? 0u : (unsigned int) list[i-stride]);
+                        unsigned int u = ( delta << 1 ) ^ ( 0u - (delta >> 31) ); // zig-zag, small negative numbers use few bytes
+                        while( u >= 0x80 ){
+                                buffer[bytes++] = (unsigned char) ( u | 0x80 );
+                                u >>= 7;
+                        }
+                        buffer[bytes++] = (unsigned char) u;
+                }
+                int header[2] = { entries, bytes };
+                twriteBinary( 2, header, ofs );
+                while( bytes % 8 != 0 ){ buffer[bytes++] = 0; }
+                ofs.write( (const char*) buffer, bytes );
+        }
+}
+bool treadFrames( int size, int stride, int list[], std::istream &ifs ){
+        if ( size < 0 ) return false;
+        std::vector<unsigned char> buffer_vec( 5 * BINARY_FRAME_ENTRIES + 8 );
+        unsigned char *buffer = &buffer_vec[0];
+        int start = 0;
+        while( start < size ){
+                int header[2];
+                if ( !treadBinary( 2, header, ifs ) ) return false;
+                int entries = header[0], bytes = header[1];
+                if ( (entries <= 0) || (entries > BINARY_FRAME_ENTRIES) || (entries > size - start) || (bytes < entries) || (bytes > 5 * entries) ) return false;
+                ifs.read( (char*) buffer, ( bytes % 8 == 0 ) ? bytes : bytes + 8 - bytes % 8 );
+                if ( !ifs.good() ) return false;
+                int k = 0;
+                for( int i=start; i<start+entries; i++ ){
+                        unsigned int u = 0;
+                        int shift = 0;
+                        do{
+                                if ( (k >= bytes) || (shift > 28) ) return false;
+                                u |= ((unsigned int) (buffer[k] & 0x7F)) << shift;
+                                shift += 7;
+                        }while( buffer[k++] & 0x80 );
+                        unsigned int delta = ( u >> 1 ) ^ ( 0u - (u & 1u) );
+                        list[i] = (int) ( (( i < stride ) ? 0u : (unsigned int) list[i-stride]) + delta );
+                }
+                if ( k != bytes ) return false;
+                start += entries;
+        }
+        return true;
+}
+
+bool tmapBinary( int size, const int* &list, const char* &data, const char *end ){
+        if ( size < 0 ) return false;
+        size_t bytes = size * sizeof(int);
+        bytes += ( bytes % 8 == 0 ) ? 0 : 8 - bytes % 8;
+        if ( (size_t) (end - data) < bytes ) return false;
+        list = (const int*) data;
+        data += bytes;
+        return true;
+}
+bool tmapBinary( int size, const double* &list, const char* &data, const char *end ){
+        if ( size < 0 ) return false;
+        size_t bytes = size * sizeof(double);
+        if ( (size_t) (end - data) < bytes ) return false;
+        list = (const double*) data;
+        data += bytes;
+        return true;
+}
+
+unsigned int tchecksum( unsigned int sum, const char buffer[], size_t length ){
+        const unsigned char *data = (const unsigned char*) buffer;
+        unsigned int a = sum & 0xffff, b = (sum >> 16) & 0xffff;
+        while( length > 0 ){
+                // 5552 is the largest block that cannot overflow b before the modulus is taken
+                size_t block = ( length < 5552 ) ? length : 5552;
+                length -= block;
+                for( size_t i=0; i<block; i++ ){
+                        a += data[i];
+                        b += a;
+                }
+                data += block;
+                a %= 65521;
+                b %= 65521;
+        }
+        return (b << 16) | a;
+}
+
 TypeIndexRelation compareIndexes( int num_entries, const int a[], const int b[] ){
         for( int i=0; i<num_entries; i++ ){
                 if ( a[i] < b[i] ) return type_abeforeb;
@@ -55,11 +55,34 @@ void tcopy( int size, const double source[], double destination[]  );
 int tsum( int size, const int index[] );
 // this sums all the indexes
 
-void twrite( int size, const int list[], std::ofstream &ofs );
-void twrite( int size, const double list[], std::ofstream &ofs );
-
-void tread( int size, int list[], std::ifstream &ifs );
-void tread( int size, double list[], std::ifstream &ifs );
+void twrite( int size, const int list[], std::ostream &ofs );
+void twrite( int size, const double list[], std::ostream &ofs );
+
+void tread( int size, int list[], std::istream &ifs );
+void tread( int size, double list[], std::istream &ifs );
+
+void twriteBinary( int size, const int list[], std::ostream &ofs );
+void twriteBinary( int size, const double list[], std::ostream &ofs );
+// raw output (native byte order) used by the binary file format, int lists are padded to a multiple of 8 bytes
+// so that every list in the file starts on an 8-byte boundary
+
+bool treadBinary( int size, int list[], std::istream &ifs );
+bool treadBinary( int size, double list[], std::istream &ifs );
+// returns false if the stream does not hold size more entries
+
+void twriteFrames( int size, int stride, const int list[], std::ostream &ofs );
+bool treadFrames( int size, int stride, int list[], std::istream &ifs );
+// compressed version of twriteBinary/treadBinary for int lists, every entry is stored as the difference from the entry
+// stride places before it (e.g. the previous multi-index), zig-zag encoded into a variable number of bytes,
+// the list is split in frames of BINARY_FRAME_ENTRIES each with header { entries, bytes } and padded to 8 bytes
+
+bool tmapBinary( int size, const int* &list, const char* &data, const char *end );
+bool tmapBinary( int size, const double* &list, const char* &data, const char *end );
+// same as treadBinary but for data already in memory (e.g. a memory mapped file), list is pointed to the next size entries
+// (no copy is made) and data is advanced past them, returns false if there are not enough bytes before end
+
+unsigned int tchecksum( unsigned int sum, const char buffer[], size_t length );
+// Adler-32 checksum of the buffer, start with sum = 1 and feed consecutive chunks of the data
 
 TypeIndexRelation compareIndexes( int num_entries, const int a[], const int b[] );
 
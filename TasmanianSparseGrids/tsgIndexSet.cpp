@@ -33,7 +33,7 @@ using std::endl;
 namespace TasGrid{
 
 IndexSet::IndexSet( const int dimensions, const int slots, const int values )
-        : num_dimensions(dimensions), num_slots(slots), num_values(values), num_points(0), pList(0), vMap(0), vList(0){
+        : num_dimensions(dimensions), num_slots(slots), num_values(values), num_points(0), pList(0), vMap(0), vList(0), mapped(false){
         reset();
 };
 
@@ -41,12 +41,14 @@ IndexSet::~IndexSet(){
         num_dimensions = 0;
         num_slots = 0;
         num_values = 0;
+        if ( mapped ){ pList = 0; vList = 0; mapped = false; };
         if ( pList != 0 ){ delete[] pList; pList = 0; };
         if ( vMap != 0 ){ delete[] vMap; vMap = 0; };
         if ( vList != 0 ){ delete[] vList; vList = 0; };
 };
 
 void IndexSet::reset(){
+        if ( mapped ){ pList = 0; vList = 0; mapped = false; };
         if ( pList != 0 ){ delete[] pList; pList = 0; };
         if ( vMap != 0 ){ delete[] vMap; vMap = 0; };
         if ( vList != 0 ){ delete[] vList; vList = 0; };
@@ -62,7 +64,40 @@ void IndexSet::reset(){
         num_points = 0;
 }
 
+void IndexSet::unmap(){
+        if ( !mapped ) return;
+        const int *mapped_pList = pList;
+        const double *mapped_vList = vList;
+        pList = new int[num_dimensions*num_slots];
+        tcopy( num_dimensions*num_points, mapped_pList, pList );
+        if ( num_values > 0 ){
+                vList = new double[num_values*num_slots];
+                tcopy( num_values*num_points, mapped_vList, vList );
+        }
+        mapped = false;
+}
+
+void IndexSet::getMemoryUsage( size_t &list_bytes, size_t &map_bytes, size_t &value_bytes, size_t &mapped_bytes ) const{
+        size_t slots = (size_t) num_slots; // the capacity, add() grows the lists in blocks
+        list_bytes = 0;
+        map_bytes = ( vMap != 0 ) ? sizeof(int) * slots : 0;
+        value_bytes = 0;
+        mapped_bytes = 0;
+        if ( mapped ){
+                mapped_bytes = sizeof(int) * ((size_t) num_points) * num_dimensions + sizeof(double) * ((size_t) num_points) * num_values;
+        }else{
+                if ( pList != 0 ){ list_bytes = sizeof(int) * slots * num_dimensions; }
+                if ( vList != 0 ){ value_bytes = sizeof(double) * slots * num_values; }
+        }
+}
+size_t IndexSet::getMemoryUsage() const{
+        size_t list_bytes, map_bytes, value_bytes, mapped_bytes;
+        getMemoryUsage( list_bytes, map_bytes, value_bytes, mapped_bytes );
+        return list_bytes + map_bytes + value_bytes;
+}
+
 void IndexSet::resetValues( int new_values ){
+        unmap();
         if ( vMap != 0 ){ delete[] vMap; vMap = 0; };
         if ( vList != 0 ){ delete[] vList; vList = 0; };
         num_values = new_values;
@@ -120,7 +155,7 @@ int IndexSet::getSlot( const int index[] ) const{
 };
 
 
-void IndexSet::write( std::ofstream &ofs ) const{
+void IndexSet::write( std::ostream &ofs ) const{
         ofs << num_dimensions << " " << num_slots << " " << num_values << " " << num_points << std::endl;
         twrite( num_points*num_dimensions, pList, ofs );
         if ( num_values > 0 ){
@@ -130,7 +165,7 @@ void IndexSet::write( std::ofstream &ofs ) const{
         }
 }
 
-void IndexSet::read( std::ifstream &ifs ){
+void IndexSet::read( std::istream &ifs ){
         ifs >> num_dimensions >> num_slots >> num_values;
         reset();
         ifs >> num_points;
@@ -139,9 +174,68 @@ void IndexSet::read( std::ifstream &ifs ){
                 tread( num_values*num_points, vList, ifs );
         }
 };
+void IndexSet::writeBinary( std::ostream &ofs, bool compressed ) const{
+        int sizes[4] = { num_dimensions, num_values, num_points, (compressed) ? 1 : 0 };
+        twriteBinary( 4, sizes, ofs );
+        if ( compressed ){
+                twriteFrames( num_points*num_dimensions, num_dimensions, pList, ofs );
+        }else{
+                twriteBinary( num_points*num_dimensions, pList, ofs );
+        }
+        if ( num_values > 0 ){
+                for( int i=0; i<num_points; i++ ){
+                        twriteBinary( num_values, &(vList[ vMap[i] * num_values ]), ofs );
+                }
+        }
+}
+bool IndexSet::readBinary( std::istream &ifs ){
+        int sizes[4];
+        if ( !treadBinary( 4, sizes, ifs ) ) return false;
+        if ( (sizes[0] < 0) || (sizes[1] < 0) || (sizes[2] < 0) || (sizes[3] < 0) || (sizes[3] > 1) ) return false;
+        num_dimensions = sizes[0];
+        num_values = sizes[1];
+        num_slots = sizes[2];
+        reset();
+        if ( sizes[3] == 1 ){
+                if ( !treadFrames( num_dimensions*num_slots, num_dimensions, pList, ifs ) ) return false;
+        }else{
+                if ( !treadBinary( num_dimensions*num_slots, pList, ifs ) ) return false;
+        }
+        if ( (num_values > 0) && !treadBinary( num_values*num_slots, vList, ifs ) ) return false;
+        num_points = num_slots;
+        return true;
+}
+bool IndexSet::mapBinary( const char* &data, const char *end ){
+        const int *sizes;
+        if ( !tmapBinary( 4, sizes, data, end ) ) return false;
+        if ( (sizes[0] < 0) || (sizes[1] < 0) || (sizes[2] < 0) || (sizes[3] != 0) ) return false; // compressed lists cannot be used in place
+        const int *mapped_pList;
+        const double *mapped_vList = 0;
+        if ( !tmapBinary( sizes[0]*sizes[2], mapped_pList, data, end ) ) return false;
+        if ( (sizes[1] > 0) && !tmapBinary( sizes[1]*sizes[2], mapped_vList, data, end ) ) return false;
+
+        if ( mapped ){ pList = 0; vList = 0; };
+        if ( pList != 0 ){ delete[] pList; };
+        if ( vMap != 0 ){ delete[] vMap; vMap = 0; };
+        if ( vList != 0 ){ delete[] vList; };
+
+        num_dimensions = sizes[0];
+        num_values = sizes[1];
+        num_slots = sizes[2];
+        num_points = num_slots;
+        pList = (int*) mapped_pList;
+        vList = (double*) mapped_vList;
+        if ( num_values > 0 ){ // only the values are mapped, the map is always private
+                vMap = new int[num_slots];
+                for( int i=0; i<num_slots; i++ ){ vMap[i] = i; }
+        }
+        mapped = true;
+        return true;
+}
 
 void IndexSet::add( const int index[], const double *value ){ // this my be optimized
         if ( getSlot( index ) != -1 ) return;
+        unmap();
         if ( num_points + 1 > num_slots ){
                 //allocate more storage for the grid
                 int *old_pList = pList; pList = 0;
@@ -152,7 +246,7 @@ void IndexSet::add( const int index[], const double *value ){ // this my be opti
                 reset();
                 tcopy( num_dimensions*old_num_points, old_pList, pList );
                 if ( num_values > 0 ){
-                        tcopy( num_points, old_vMap, vMap );
+                        tcopy( old_num_points, old_vMap, vMap );
                         tcopy( num_values*old_num_points, old_vList, vList );
                 }
                 num_points = old_num_points;
@@ -179,6 +273,7 @@ void IndexSet::add( const int index[], const double *value ){ // this my be opti
 }
 
 void IndexSet::add( const IndexSet *set ){
+        unmap();
         int *old_pList = pList; pList = 0;
         int *old_vMap = vMap; vMap = 0;
         double *old_vList = vList; vList = 0;
@@ -218,6 +313,7 @@ void IndexSet::add( const IndexSet *set ){
 
 
 void IndexSet::setValue( int i, const double val[] ){
+        unmap();
         tcopy( num_values, val, &(vList[vMap[i]*num_values]) );
 }
 
@@ -41,8 +41,12 @@ public:
 
         void copy( const IndexSet *set ); // copy set into the current set
 
-        void write( std::ofstream &ofs ) const;
-        void read( std::ifstream &ifs );
+        void write( std::ostream &ofs ) const;
+        void read( std::istream &ifs );
+        void writeBinary( std::ostream &ofs, bool compressed = false ) const; // compressed stores the index list with twriteFrames()
+        bool readBinary( std::istream &ifs ); // detects whether the index list is compressed
+        bool mapBinary( const char* &data, const char *end ); // uses the index list and values in place, no copy is made
+        // a mapped set makes a private copy of the lists the first time it is modified
 
         int getNumIndexes() const;
         int getNumDimensions() const;
@@ -59,12 +63,18 @@ public:
         const int* getIndexList( int j = 0) const; // WARNING: no error checking here, if j >= num_points this will crash
         const double* getValueList( int j ) const; // WARNING: no error checking here, if (j >= num_points or num_values == 0) this will crash
 
+        // bytes allocated for the index list, the value map and the values,
+        // the part of the lists used in place from a mapped file is returned in mapped_bytes instead
+        void getMemoryUsage( size_t &list_bytes, size_t &map_bytes, size_t &value_bytes, size_t &mapped_bytes ) const;
+        size_t getMemoryUsage() const; // total allocated bytes, without the mapped lists
+
 
         // DEBUG
         //void writeList() const; // writes the list to cout
 
 protected:
         void reset();
+        void unmap(); // copy the mapped lists into memory owned by the set
 
 private:
         int num_dimensions;
@@ -74,6 +84,7 @@ private:
         int *pList;
         int *vMap; // maps the indexes in pList to the values in vList so that vList doesn't have to be shuffeled all the time
         double *vList;
+        bool mapped; // pList and vList point to read-only memory owned by someone else (e.g. a memory mapped file)
 };
 
 };
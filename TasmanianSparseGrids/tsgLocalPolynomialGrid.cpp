@@ -30,11 +30,11 @@
 
 namespace TasGrid{
 
-LocalPolynomialGrid::LocalPolynomialGrid() : num_dimensions(0), num_outputs(0), points(0), needed_points(0), surplus(0), rule1D(0), rule(rule_pwpolynomial){
+LocalPolynomialGrid::LocalPolynomialGrid() : num_dimensions(0), num_outputs(0), points(0), needed_points(0), surplus(0), surplus_mapped(false), rule1D(0), rule(rule_pwpolynomial){
         rule1D = &pwp;
 };
 
-LocalPolynomialGrid::LocalPolynomialGrid( int dimensions, int outputs, int depth, int order, TypeOneDRule boundary ) : num_dimensions(0), num_outputs(0), points(0), needed_points(0), surplus(0),
+LocalPolynomialGrid::LocalPolynomialGrid( int dimensions, int outputs, int depth, int order, TypeOneDRule boundary ) : num_dimensions(0), num_outputs(0), points(0), needed_points(0), surplus(0), surplus_mapped(false),
                 rule1D(0), rule(rule_pwpolynomial){
         reset( dimensions, outputs, depth, order, boundary );
 };
@@ -44,6 +44,7 @@ LocalPolynomialGrid::~LocalPolynomialGrid(){
 }
 
 void LocalPolynomialGrid::reset( int dimensions, int outputs, int depth, int order, TypeOneDRule boundary ){
+        TSG_PROFILE( profile_construction );
         clear();
 
         if ( boundary == rule_pwpolynomial0 ){
@@ -108,7 +109,7 @@ int LocalPolynomialGrid::getNumOutputs() const{ return num_outputs; };
 TypeOneDRule LocalPolynomialGrid::getOneDRule() const{ return rule; };
 const char *LocalPolynomialGrid::getOneDRuleDescription() const{ return rule1D->getDescription(); };
 
-void LocalPolynomialGrid::write( std::ofstream &ofs ) const{ // write the grid to a file
+void LocalPolynomialGrid::write( std::ostream &ofs ) const{ // write the grid to a file
         ofs << "num_dimensions: " << num_dimensions << endl;
         ofs << "num_outputs: " << num_outputs << endl;
         ofs << "order: " << rule1D->getMaxOrder() << endl;
@@ -141,34 +142,35 @@ void LocalPolynomialGrid::write( std::ofstream &ofs ) const{ // write the grid t
         }
 }
 
-bool LocalPolynomialGrid::read( std::ifstream &ifs ){ // reads the grid
+bool LocalPolynomialGrid::read( std::istream &ifs ){ // reads the grid
         clear();
         std::string T;
-        ifs >> T; if ( !(T.compare( "num_dimensions:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 1" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "num_dimensions:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 1" << endl; clear(); return false; }
         ifs >> num_dimensions;
-        ifs >> T; if ( !(T.compare( "num_outputs:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 2" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "num_outputs:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 2" << endl; clear(); return false; }
         ifs >> num_outputs;
-        ifs >> T; if ( !(T.compare( "order:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 3" << endl; ifs.close(); clear(); return false; }
-        int order; ifs >> order; rule1D->setMaxOrder(order);
-        ifs >> T; if ( !(T.compare( "boundary:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 4" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "order:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 3" << endl; clear(); return false; }
+        int order; ifs >> order;
+        ifs >> T; if ( !(T.compare( "boundary:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 4" << endl; clear(); return false; }
         ifs >> T;
         if ( T.compare("zero") == 0 ){
                 rule = rule_pwpolynomial0;
                 rule1D = &pwp0;
         }
-        ifs >> T; if ( !(T.compare( "Points:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 5" << endl; ifs.close(); clear(); return false; }
+        rule1D->setMaxOrder(order);
+        ifs >> T; if ( !(T.compare( "Points:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 5" << endl; clear(); return false; }
         ifs >> T;
         if ( T.compare("yes") == 0 ){
                 points = new IndexSet(1);
                 points->read( ifs );
         }
-        ifs >> T; if ( !(T.compare( "Needed_Points:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 6" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "Needed_Points:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 6" << endl; clear(); return false; }
         ifs >> T;
         if ( T.compare("yes") == 0 ){
                 needed_points = new IndexSet(1);
                 needed_points->read( ifs );
         }
-        ifs >> T; if ( !(T.compare( "Surplusses:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 7" << endl; ifs.close(); clear(); return false; }
+        ifs >> T; if ( !(T.compare( "Surplusses:" ) == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 7" << endl; clear(); return false; }
         ifs >> T;
         if ( T.compare("yes") == 0 ){
                 surplus = new double[points->getNumIndexes() * num_outputs];
@@ -176,12 +178,82 @@ bool LocalPolynomialGrid::read( std::ifstream &ifs ){ // reads the grid
         }
         return true;
 }
+void LocalPolynomialGrid::writeBinary( std::ostream &ofs, bool compressed ) const{
+        int flags[6] = { num_dimensions, num_outputs, rule1D->getMaxOrder(), (rule == rule_pwpolynomial) ? 0 : 1, (points != 0) ? 1 : 0, (needed_points != 0) ? 1 : 0 };
+        twriteBinary( 6, flags, ofs );
+        int has_surplus = (surplus != 0) ? 1 : 0;
+        twriteBinary( 1, &has_surplus, ofs );
+        if ( points != 0 ) points->writeBinary( ofs, compressed );
+        if ( needed_points != 0 ) needed_points->writeBinary( ofs, compressed );
+        if ( surplus != 0 ) twriteBinary( points->getNumIndexes() * num_outputs, surplus, ofs );
+}
+bool LocalPolynomialGrid::readBinary( std::istream &ifs ){
+        clear();
+        int flags[6], has_surplus;
+        if ( !treadBinary( 6, flags, ifs ) || !treadBinary( 1, &has_surplus, ifs ) ){ cerr << "ERROR: Wrong File Format! code LPG 8" << endl; clear(); return false; }
+        num_dimensions = flags[0];
+        num_outputs = flags[1];
+        if ( flags[3] == 1 ){
+                rule = rule_pwpolynomial0;
+                rule1D = &pwp0;
+        }
+        rule1D->setMaxOrder( flags[2] );
+        if ( (has_surplus == 1) && (flags[4] == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 9" << endl; clear(); return false; }
+        bool pass = true;
+        if ( flags[4] == 1 ){
+                points = new IndexSet(1);
+                pass = points->readBinary( ifs );
+        }
+        if ( flags[5] == 1 ){
+                needed_points = new IndexSet(1);
+                pass = pass && needed_points->readBinary( ifs );
+        }
+        if ( pass && (has_surplus == 1) ){
+                surplus = new double[points->getNumIndexes() * num_outputs];
+                pass = treadBinary( points->getNumIndexes() * num_outputs, surplus, ifs );
+        }
+        if ( !pass ){ cerr << "ERROR: Wrong File Format! code LPG 10" << endl; clear(); return false; }
+        return true;
+}
+bool LocalPolynomialGrid::mapBinary( const char* &data, const char *end ){
+        clear();
+        const int *flags, *has_surplus;
+        if ( !tmapBinary( 6, flags, data, end ) || !tmapBinary( 1, has_surplus, data, end ) ){ cerr << "ERROR: Wrong File Format! code LPG 8" << endl; clear(); return false; }
+        num_dimensions = flags[0];
+        num_outputs = flags[1];
+        if ( flags[3] == 1 ){
+                rule = rule_pwpolynomial0;
+                rule1D = &pwp0;
+        }
+        rule1D->setMaxOrder( flags[2] );
+        if ( (has_surplus[0] == 1) && (flags[4] == 0) ){ cerr << "ERROR: Wrong File Format! code LPG 9" << endl; clear(); return false; }
+        bool pass = true;
+        if ( flags[4] == 1 ){
+                points = new IndexSet(1);
+                pass = points->mapBinary( data, end );
+        }
+        if ( flags[5] == 1 ){
+                needed_points = new IndexSet(1);
+                pass = pass && needed_points->mapBinary( data, end );
+        }
+        if ( pass && (has_surplus[0] == 1) ){
+                const double *mapped_surplus;
+                pass = tmapBinary( points->getNumIndexes() * num_outputs, mapped_surplus, data, end );
+                surplus = (double*) mapped_surplus;
+                surplus_mapped = true;
+        }
+        if ( !pass ){ cerr << "ERROR: Wrong File Format! code LPG 10" << endl; clear(); return false; }
+        return true;
+}
 
 int LocalPolynomialGrid::getNumPoints() const{ return ( points == 0 ) ? 0 : points->getNumIndexes(); }
 
 void LocalPolynomialGrid::getPoints( double* &pnts ) const{
         if ( pnts != 0 ){ delete[] pnts; }
         pnts = new double[ num_dimensions * points->getNumIndexes() ];
+        fillPoints( pnts );
+};
+void LocalPolynomialGrid::fillPoints( double pnts[] ) const{
         for( int i=0; i<points->getNumIndexes(); i++ ){
                 const int *point = points->getIndexList(i);
                 for( int j=0; j<num_dimensions; j++ ){
@@ -190,9 +262,12 @@ void LocalPolynomialGrid::getPoints( double* &pnts ) const{
         }
 };
 void LocalPolynomialGrid::getWeights( double* &weights ) const{
-        int num_points = points->getNumIndexes();
         if ( weights != 0 ){ delete[] weights; }
-        weights = new double[num_points];
+        weights = new double[points->getNumIndexes()];
+        fillWeights( weights );
+};
+void LocalPolynomialGrid::fillWeights( double weights[] ) const{
+        int num_points = points->getNumIndexes();
         #pragma omp parallel for
         for( int i=0; i<num_points; i++ ){
                 weights[i] = evalIntegral( points->getIndexList(i) );
@@ -200,9 +275,12 @@ void LocalPolynomialGrid::getWeights( double* &weights ) const{
         applySurplusMapTransposed( weights );
 };
 void LocalPolynomialGrid::getInterpolantWeights( const double x[], double* &weights ) const{
-        int num_points = points->getNumIndexes();
         if ( weights != 0 ){ delete[] weights; }
-        weights = new double[num_points];
+        weights = new double[points->getNumIndexes()];
+        fillInterpolantWeights( x, weights );
+};
+void LocalPolynomialGrid::fillInterpolantWeights( const double x[], double weights[] ) const{
+        int num_points = points->getNumIndexes();
         #pragma omp parallel for
         for( int i=0; i<num_points; i++ ){
                 weights[i] = evalBasis( points->getIndexList(i), x );
@@ -214,6 +292,9 @@ int LocalPolynomialGrid::getNumNeededPoints() const{ return (needed_points == 0)
 void LocalPolynomialGrid::getNeededPoints( double* &pnts ) const{
         if ( pnts != 0 ){ delete[] pnts; }
         pnts = new double[ num_dimensions * needed_points->getNumIndexes() ];
+        fillNeededPoints( pnts );
+};
+void LocalPolynomialGrid::fillNeededPoints( double pnts[] ) const{
         for( int i=0; i<needed_points->getNumIndexes(); i++ ){
                 const int *point = needed_points->getIndexList(i);
                 for( int j=0; j<num_dimensions; j++ ){
@@ -249,6 +330,7 @@ void LocalPolynomialGrid::loadNeededPoints( const IndexSet *data ){
 };
 
 void LocalPolynomialGrid::evaluate( const double x[], double y[] ) const{
+        TSG_PROFILE( profile_evaluate );
         int num_points = points->getNumIndexes();
         double *basis_values = new double[num_points];
         #pragma omp parallel for
@@ -286,6 +368,7 @@ void LocalPolynomialGrid::integrate( double y[] ) const{
 // refinement functions
 const IndexSet* LocalPolynomialGrid::getState() const{ return points; };
 void LocalPolynomialGrid::setState( const IndexSet* state ){
+        TSG_PROFILE( profile_refinement );
         clear();
 
         num_dimensions = state->getNumDimensions();
@@ -319,6 +402,7 @@ void LocalPolynomialGrid::getData( IndexSet* &data ){
 }
 
 void LocalPolynomialGrid::getUpdateState( IndexSet* &update, double tol, TypeRefinement criteria ) const{ // the magic of deciding what should and should not be added
+        TSG_PROFILE( profile_refinement );
         // implement classical refinement first
         if ( update != 0 ){ delete update; };
         update = new IndexSet( num_dimensions, 0, num_outputs );
@@ -344,8 +428,18 @@ void LocalPolynomialGrid::getUpdateState( IndexSet* &update, double tol, TypeRef
         delete[] map;
 };
 
+void LocalPolynomialGrid::getMemoryUsage( GridMemory &memory ) const{
+        memory.addIndexSet( points, memory_index_list, memory_index_map, memory_values );
+        memory.addIndexSet( needed_points, memory_needed_points, memory_needed_points, memory_needed_points );
+        if ( surplus != 0 ){
+                memory.bytes[ (surplus_mapped) ? memory_mapped : memory_surplus ] += sizeof(double) * ((size_t) points->getNumIndexes()) * num_outputs;
+        }
+        memory.bytes[memory_rules] += pwp.getMemoryUsage() + pwp0.getMemoryUsage();
+}
+
 void LocalPolynomialGrid::setUpdate( const IndexSet *update ){
-        if ( surplus != 0 ){ delete[] surplus; surplus = 0; }
+        TSG_PROFILE( profile_refinement );
+        if ( (surplus != 0) && !surplus_mapped ){ delete[] surplus; } surplus = 0;
         if ( needed_points != 0 ){ delete needed_points; needed_points = 0; }
 
         points->add( update );
@@ -360,7 +454,7 @@ void LocalPolynomialGrid::clear(){
         rule1D = &pwp;
         rule = rule_pwpolynomial;
         if ( points != 0 ){ delete points; } points = 0;
-        if ( surplus != 0 ){ delete[] surplus; } surplus = 0;
+        if ( (surplus != 0) && !surplus_mapped ){ delete[] surplus; } surplus = 0; surplus_mapped = false;
         if ( needed_points != 0 ){ delete needed_points; } needed_points = 0;
         num_dimensions = 0; num_outputs = 0;
 }
@@ -385,7 +479,7 @@ bool LocalPolynomialGrid::addParent( const int point[], int direction, IndexSet
         int parenta, parentb;
         rule1D->getParents( point[direction], parenta, parentb );
         //int dad[num_dimensions];
-		std::vector<int> dad_vec;
+		std::vector<int> dad_vec(num_dimensions);
 		int *dad = &dad_vec[0];
         tcopy( num_dimensions, point, dad );
         bool bAdded = false;
@@ -415,9 +509,11 @@ double cnoise_uniform01(){
 };
 
 void LocalPolynomialGrid::recomputeSurpluses(){
+        TSG_PROFILE( profile_surplus );
         int num_points = points->getNumIndexes();
-        if ( surplus != 0 ){ delete[] surplus; }
+        if ( (surplus != 0) && !surplus_mapped ){ delete[] surplus; }
         surplus = new double[num_points * num_outputs];
+        surplus_mapped = false;
 
         for( int i=0; i<num_points; i++ ){
                 tcopy( num_outputs, points->getValueList( i ), &(surplus[i*num_outputs]) );
@@ -53,17 +53,24 @@ public:
         TypeOneDRule getOneDRule() const;
         const char *getOneDRuleDescription() const;
 
-        void write( std::ofstream &ofs ) const; // write the grid to a file
-        bool read( std::ifstream &ifs ); // reads the grid
+        void write( std::ostream &ofs ) const; // write the grid to a file
+        bool read( std::istream &ifs ); // reads the grid
+        void writeBinary( std::ostream &ofs, bool compressed ) const;
+        bool readBinary( std::istream &ifs );
+        bool mapBinary( const char* &data, const char *end );
 
         int getNumPoints() const;
 
         void getPoints( double* &pnts ) const;
         void getWeights( double* &weights ) const;
         void getInterpolantWeights( const double x[], double* &weights ) const;
+        void fillPoints( double pnts[] ) const;
+        void fillWeights( double weights[] ) const;
+        void fillInterpolantWeights( const double x[], double weights[] ) const;
 
         int getNumNeededPoints() const;
         void getNeededPoints( double* &pnts ) const;
+        void fillNeededPoints( double pnts[] ) const;
         void loadNeededPoints( const double vals[] );
         void loadNeededPoints( const IndexSet *data );
 
@@ -77,6 +84,8 @@ public:
         void getUpdateState( IndexSet* &update, double tol, TypeRefinement criteria ) const; // give the new set of points or tensors
         void setUpdate( const IndexSet *update ); // creates a grid with the data updates
 
+        void getMemoryUsage( GridMemory &memory ) const;
+
 protected:
         void clear();
 
@@ -113,6 +122,7 @@ private:
         int num_dimensions, num_outputs;
 
         double *surplus;
+        bool surplus_mapped; // the surplus belongs to a memory mapped file, do not delete it
 
         IndexSet *points;
         IndexSet *needed_points;
@@ -76,6 +76,11 @@ TypeOneDRule RuleChebyshevN2P::getType() const{
         return rule_chebyshevN2P;
 }
 
+size_t RuleChebyshevN2P::getMemoryUsage() const{
+        int allocated_nodes = ( max_level > 0 ) ? getNumPoints( max_level-1 ) : 0;
+        return sizeof(int) * ( max_level + 1 ) + sizeof(double) * ( levels[max_level] + allocated_nodes );
+}
+
 int RuleChebyshevN2P::getNumPoints( int level ) const{
         return 2*level+1;
 }
@@ -55,6 +55,7 @@ public:
         double eval( int level, int point, double x ) const;
 
         TypeOneDRule getType() const;
+        size_t getMemoryUsage() const;
 
 protected:
         void getOneLevelPoints( int num_points, double* &x ) const; // returns the points and weights
@@ -118,6 +118,12 @@ TypeOneDRule RuleClenshawCurtis::getType() const{
         return rule_clenshawcurtis;
 }
 
+size_t RuleClenshawCurtis::getMemoryUsage() const{
+        if ( levels == 0 ){ return 0; }
+        int allocated_nodes = ( max_level > 0 ) ? getNumPoints( max_level-1 ) : 0;
+        return sizeof(int) * ( max_level + 1 ) + sizeof(double) * ( num_weights + allocated_nodes );
+}
+
 int RuleClenshawCurtis::getNumPoints( int level ) const{
         int power = 1; power = power << level;
         return (level == 0 ) ? 1 : ( power + 1 );
@@ -56,6 +56,7 @@ public:
         double eval( int level, int point, double x ) const;
 
         TypeOneDRule getType() const;
+        size_t getMemoryUsage() const;
 
 protected:
         //int countNumPoints( int level ) const;
@@ -88,6 +88,13 @@ TypeOneDRule RuleGaussChebyshev2::getType() const{
         return rule_gausschebyshev2;
 }
 
+size_t RuleGaussChebyshev2::getMemoryUsage() const{
+        int total_points = levels[max_level];
+        int num_nodes = 0; // the nodes are not repeated, level_points refers to them
+        for( int i=0; i<total_points; i++ ){ if ( level_points[i] >= num_nodes ) num_nodes = level_points[i] + 1; }
+        return sizeof(int) * ( max_level + 1 + total_points ) + sizeof(double) * ( total_points + num_nodes );
+}
+
 int RuleGaussChebyshev2::getNumPoints( int level ) const{
         return level+1;
 }
@@ -53,6 +53,7 @@ public:
         double eval( int level, int point, double x ) const;
 
         TypeOneDRule getType() const;
+        size_t getMemoryUsage() const;
 
 protected:
         void buildOneLevel( int level, double* &w, double* &x );
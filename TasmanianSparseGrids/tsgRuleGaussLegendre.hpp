@@ -53,6 +53,7 @@ public:
         double eval( int level, int point, double x ) const;
 
         TypeOneDRule getType() const;
+        size_t getMemoryUsage() const;
 
         void buildOneLevel( int level, double* &w, double* &x ); // this is cheating to let RulePWLocal use the Gauss-Legendre rules of only one fixed level
 
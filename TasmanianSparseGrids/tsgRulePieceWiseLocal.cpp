@@ -57,6 +57,10 @@ TypeOneDRule RulePieceWiseLocal::getType() const{
         return rule_pwpolynomial;
 }
 
+size_t RulePieceWiseLocal::getMemoryUsage() const{
+        return 2 * sizeof(double) * gl_n;
+}
+
 const char * RulePieceWiseLocal::getDescription() const{
         switch (order){
                 case -1: return "Piece-Wise Polynomials of Highest Degeree";
@@ -56,6 +56,10 @@ TypeOneDRule RulePieceWiseLocalZero::getType() const{
         return rule_pwpolynomial0;
 }
 
+size_t RulePieceWiseLocalZero::getMemoryUsage() const{
+        return 2 * sizeof(double) * gl_n;
+}
+
 const char * RulePieceWiseLocalZero::getDescription() const{
         switch (order){
                 case 1: return "Piece-Wise Linear Local basis, zero boundary";
@@ -62,6 +62,7 @@ public:
         double eval( int level, int point, double x ) const; // returns the value of point at location x (there is assumed 1-1 corresponcence between points and functions)
 
         TypeOneDRule getType() const; // returns the type of rule
+        size_t getMemoryUsage() const; // bytes of the Gauss-Legendre points and weights used for the integrals
 
         int getLevel( int point ) const; // returns the hierarchical level of a point
         void getChildren( int point, int &first, int &second ) const;
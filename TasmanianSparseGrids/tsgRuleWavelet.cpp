@@ -39,18 +39,13 @@ RuleWavelet::RuleWavelet(int ord, int iter_depth){
 
 void RuleWavelet::updateOrder(int ord){
 	/*
-	 * Changes the order of the rule to the specified order. If order other than 1 is
-	 * specified, then the approximation to the wavelets will be recalculated.
+	 * Changes the order of the rule to the specified order. If order 3 is specified,
+	 * then the rule picks up the approximation to the wavelets computed by the cascade.
 	 */
 	if(order == ord) return;
 
-	// If previous order was cubic, clean up data.
-	if(order == 3 && data != 0){
-		for(int i = 0; i < 4; i++){
-			delete[] data[i];
-		}
-		delete[] data;
-	}
+	// The cubic tables are shared, see getCubicTables().
+	data = 0;
 
 
 	if (! (ord == 1 || ord == 3)){
@@ -62,129 +57,218 @@ void RuleWavelet::updateOrder(int ord){
 	}
 
 	if(order == 3){
+		data = getCubicTables(iteration_depth);
+	}
+}
 
-		int num_data_points = (1 << iteration_depth) + 1;
+const double* const* RuleWavelet::getCubicTables(int iteration_depth){
+	/*
+	 * The cascade approximations depend only on iteration_depth, thus they are computed
+	 * once per process and shared (read-only) by all cubic rules. The tables live until
+	 * the end of the process.
+	 */
+	static std::map<int, double**> cache;
+	static std::mutex cache_lock;
 
-		data = new double*[5]; // (xs, level1 (scaling), level2, level3, level4)
-		double *xs = new double[num_data_points];
-		data[0] = xs;
+	std::lock_guard<std::mutex> lock(cache_lock);
+	std::map<int, double**>::iterator it = cache.find(iteration_depth);
+	if(it != cache.end()) return it->second;
 
-                #pragma omp parallel for
-		for(int i = 0; i < num_data_points; i++){
-			xs[i] = -1. + 2*(double (i)) / (double (num_data_points - 1));
-		}
+	double **tables = computeCubicTables(iteration_depth);
+	cache[iteration_depth] = tables;
+	return tables;
+}
 
-		// Coefficients derived by solving linear system involving scaling function
-		// integrals and moments.
-
-		double _coeff[8+16+24] =
-		{0.95958116146167449, 0.27778015867946454, -0.042754937296610125, -0.014317145809288835, // Second level
-				-0.34358723961941895, 0.36254192315551625, 0.20438681551383264, 0.012027193241660438,
-				// third level
-				0.90985488901447964, 0.29866296454372104, -0.077377811931657145, 0.017034083534297827,
-				-0.28361250628699103, 0.33723841173046543, 0.24560604387620491, -0.023811935316236606,
-				0.015786802304611155, 0.23056985382971185, 0.31221657974498912, -0.03868102549989539,
-				0.194797093133632, -0.099050236091189195, 0.51520570019738199, -0.073403162960780324,
-				// fourth level
-				0.90985443399962629, 0.29866318097339162, -0.077377917373678995, 0.017034105626588848,
-				-0.28361254472311259, 0.33723844527609648, 0.24560602528531161, -0.023811931411878345,
-				0.015786801751471, 0.23056986060092344, 0.31221657434994671, -0.038681024059425327,
-				0.14697942814289319, -0.047340431972365773, 0.51871874565793186, -0.093244980946745618,
-				-0.019628614067688826, 0.25611706552019509, 0.30090457777800012, -0.036629694186987166,
-				-1./32., 9./32., 9./32., -1./32
-		};
-
-		double *coeffs[3] = {_coeff, _coeff + 8, _coeff+24};
-
-		double *workspace = new double[4 * num_data_points];
-
-
-		// Initialize scaling functions
-		data[1] = new double[3*num_data_points];
-		tzero(3*num_data_points, data[1]);
-		double  *phi1 = data[1],
-				*phi2 = data[1] + num_data_points,
-				*phi3 = data[1] + 2*num_data_points,
-				*phi4;
-
-		// Point (sparse grid numbering):
-		// 1     3     0     4     2
-		// X --- X --- X --- X --- X
-		// 0     1     2     3     4
-		// Point (level 2 coarse indexing)
-
-		// This ordering makes phi1 -> point 0, phi2 -> point 1, phi3 -> point 3
-		// Points 2 & 4 can be found by reflection of phi2, phi3, respectively.
-		phi1[ACCESS_COARSE(2, 2, iteration_depth)] = 1;
-		phi2[ACCESS_COARSE(0, 2, iteration_depth)] = 1;
-		phi3[ACCESS_COARSE(1, 2, iteration_depth)] = 1;
-		cubic_cascade(phi1, 2, iteration_depth);
-		cubic_cascade(phi2, 2, iteration_depth);
-		cubic_cascade(phi3, 2, iteration_depth);
-
-
-		// Scaling functions at current level.
-		phi1 = workspace,
-		phi2 = workspace + num_data_points,
-		phi3 = workspace + (2 * num_data_points),
-		phi4 = workspace + (3 * num_data_points);
-		for(int level = 2; level <= 4; level++){
-			tzero(4 * num_data_points, workspace);
-			int num_saved = 2 * (level-1); // 2 'unique' functions at level 2, 4 at 3, 6 at 4.
-			data[level] = new double[num_saved * num_data_points];
-			tzero(num_saved * num_data_points, data[level]);
-
-			// Initialize first four scaling functions
-			phi1[ACCESS_COARSE(0, level, iteration_depth)] = 1;
-			phi2[ACCESS_COARSE(1, level, iteration_depth)] = 1;
-			phi3[ACCESS_COARSE(2, level, iteration_depth)] = 1;
-			phi4[ACCESS_COARSE(3, level, iteration_depth)] = 1;
-			cubic_cascade(phi1, level, iteration_depth);
-			cubic_cascade(phi2, level, iteration_depth);
-			cubic_cascade(phi3, level, iteration_depth);
-			cubic_cascade(phi4, level, iteration_depth);
-
-
-
-			for(int index = 0; index < num_saved; index++){
-				// Initialize unlifted wavelet
-				double *wavelet = &data[level][index*(num_data_points)];
-				wavelet[ACCESS_FINE(index, level, iteration_depth)] = 1;
-				cubic_cascade(wavelet, level, iteration_depth);
-				double  c1 = coeffs[level-2][4*index],
-						c2 = coeffs[level-2][4*index+1],
-						c3 = coeffs[level-2][4*index+2],
-						c4 = coeffs[level-2][4*index+3];
-
-				if(level > 2 && index >= 2){
-					// Change pointers around to avoid copying data
-					double *tmp = phi1;
-					phi1 = phi2;
-					phi2 = phi3;
-					phi3 = phi4;
-					phi4 = tmp;
-					// Initialize new scaling function
-					tzero(num_data_points, phi4);
-					phi4[ACCESS_COARSE(index+2, level, iteration_depth)] = 1;
-					cubic_cascade(phi4, level, iteration_depth);
+double** RuleWavelet::computeCubicTables(int iteration_depth){
+	/*
+	 * Runs the cascade algorithm for the scaling functions and the lifted wavelets and
+	 * converts the samples into piece-wise polynomial tables.
+	 */
+	int num_data_points = (1 << iteration_depth) + 1;
 
-				}
+	double **data = new double*[5]; // (xs, level1 (scaling), level2, level3, level4)
+	double *xs = new double[num_data_points];
+	data[0] = xs;
 
-                                #pragma omp parallel for
-				for(int i = 0; i < num_data_points; i++){
-					// Lift the wavelet
-					wavelet[i] -= c1 * phi1[i] + c2 * phi2[i] + c3 * phi3[i] + c4 * phi4[i];
-				}
+                #pragma omp parallel for
+	for(int i = 0; i < num_data_points; i++){
+		xs[i] = -1. + 2*(double (i)) / (double (num_data_points - 1));
+	}
+
+	// Coefficients derived by solving linear system involving scaling function
+	// integrals and moments.
+
+	double _coeff[8+16+24] =
+	{0.95958116146167449, 0.27778015867946454, -0.042754937296610125, -0.014317145809288835, // Second level
+			-0.34358723961941895, 0.36254192315551625, 0.20438681551383264, 0.012027193241660438,
+			// third level
+			0.90985488901447964, 0.29866296454372104, -0.077377811931657145, 0.017034083534297827,
+			-0.28361250628699103, 0.33723841173046543, 0.24560604387620491, -0.023811935316236606,
+			0.015786802304611155, 0.23056985382971185, 0.31221657974498912, -0.03868102549989539,
+			0.194797093133632, -0.099050236091189195, 0.51520570019738199, -0.073403162960780324,
+			// fourth level
+			0.90985443399962629, 0.29866318097339162, -0.077377917373678995, 0.017034105626588848,
+			-0.28361254472311259, 0.33723844527609648, 0.24560602528531161, -0.023811931411878345,
+			0.015786801751471, 0.23056986060092344, 0.31221657434994671, -0.038681024059425327,
+			0.14697942814289319, -0.047340431972365773, 0.51871874565793186, -0.093244980946745618,
+			-0.019628614067688826, 0.25611706552019509, 0.30090457777800012, -0.036629694186987166,
+			-1./32., 9./32., 9./32., -1./32
+	};
+
+	double *coeffs[3] = {_coeff, _coeff + 8, _coeff+24};
+
+	double *workspace = new double[4 * num_data_points];
+
+
+	// Initialize scaling functions
+	data[1] = new double[3*num_data_points];
+	tzero(3*num_data_points, data[1]);
+	double  *phi1 = data[1],
+			*phi2 = data[1] + num_data_points,
+			*phi3 = data[1] + 2*num_data_points,
+			*phi4;
+
+	// Point (sparse grid numbering):
+	// 1     3     0     4     2
+	// X --- X --- X --- X --- X
+	// 0     1     2     3     4
+	// Point (level 2 coarse indexing)
+
+	// This ordering makes phi1 -> point 0, phi2 -> point 1, phi3 -> point 3
+	// Points 2 & 4 can be found by reflection of phi2, phi3, respectively.
+	phi1[ACCESS_COARSE(2, 2, iteration_depth)] = 1;
+	phi2[ACCESS_COARSE(0, 2, iteration_depth)] = 1;
+	phi3[ACCESS_COARSE(1, 2, iteration_depth)] = 1;
+	cubic_cascade(phi1, 2, iteration_depth);
+	cubic_cascade(phi2, 2, iteration_depth);
+	cubic_cascade(phi3, 2, iteration_depth);
+
+
+	// Scaling functions at current level.
+	phi1 = workspace,
+	phi2 = workspace + num_data_points,
+	phi3 = workspace + (2 * num_data_points),
+	phi4 = workspace + (3 * num_data_points);
+	for(int level = 2; level <= 4; level++){
+		tzero(4 * num_data_points, workspace);
+		int num_saved = 2 * (level-1); // 2 'unique' functions at level 2, 4 at 3, 6 at 4.
+		data[level] = new double[num_saved * num_data_points];
+		tzero(num_saved * num_data_points, data[level]);
+
+		// Initialize first four scaling functions
+		phi1[ACCESS_COARSE(0, level, iteration_depth)] = 1;
+		phi2[ACCESS_COARSE(1, level, iteration_depth)] = 1;
+		phi3[ACCESS_COARSE(2, level, iteration_depth)] = 1;
+		phi4[ACCESS_COARSE(3, level, iteration_depth)] = 1;
+		cubic_cascade(phi1, level, iteration_depth);
+		cubic_cascade(phi2, level, iteration_depth);
+		cubic_cascade(phi3, level, iteration_depth);
+		cubic_cascade(phi4, level, iteration_depth);
+
+
+
+		for(int index = 0; index < num_saved; index++){
+			// Initialize unlifted wavelet
+			double *wavelet = &data[level][index*(num_data_points)];
+			wavelet[ACCESS_FINE(index, level, iteration_depth)] = 1;
+			cubic_cascade(wavelet, level, iteration_depth);
+			double  c1 = coeffs[level-2][4*index],
+					c2 = coeffs[level-2][4*index+1],
+					c3 = coeffs[level-2][4*index+2],
+					c4 = coeffs[level-2][4*index+3];
+
+			if(level > 2 && index >= 2){
+				// Change pointers around to avoid copying data
+				double *tmp = phi1;
+				phi1 = phi2;
+				phi2 = phi3;
+				phi3 = phi4;
+				phi4 = tmp;
+				// Initialize new scaling function
+				tzero(num_data_points, phi4);
+				phi4[ACCESS_COARSE(index+2, level, iteration_depth)] = 1;
+				cubic_cascade(phi4, level, iteration_depth);
 
+			}
 
+                                #pragma omp parallel for
+			for(int i = 0; i < num_data_points; i++){
+				// Lift the wavelet
+				wavelet[i] -= c1 * phi1[i] + c2 * phi2[i] + c3 * phi3[i] + c4 * phi4[i];
 			}
 
 
 		}
 
-		delete[] workspace;
 
 	}
+
+	delete[] workspace;
+
+	buildPolynomialTables(data, iteration_depth);
+	return data;
+}
+
+void RuleWavelet::buildPolynomialTables(double **data, int iteration_depth){
+	/*
+	 * Each function is approximated by the cubic going through the four samples closest
+	 * to the interval (the stencil is shifted at the ends of [-1, 1]). The cubic is
+	 * stored in terms of the local coordinate t in [0, 1] of the interval, hence
+	 * evaluation needs only the interval index and a Horner step.
+	 */
+	int num_intervals = (1 << iteration_depth);
+	int num_data_points = num_intervals + 1;
+	int num_functions[5] = {0, 3, 2, 4, 6};
+
+	// stencil_coeff[k][j] is the coefficient of t^j in the Lagrange polynomial associated
+	// with the k-th node of the stencil, one set for each of the three stencil positions
+	double stencil_coeff[3][4][4];
+	for(int s = 0; s < 3; s++){
+		for(int k = 0; k < 4; k++){
+			// nodes relative to the left end of the interval: -1,0,1,2 (s=0), 0,1,2,3 (s=1), -2,-1,0,1 (s=2)
+			double tk = (s == 0) ? k - 1 : ((s == 1) ? k : k - 2);
+			double poly[4] = {1., 0., 0., 0.};
+			double denom = 1.;
+			int deg = 0;
+			for(int m = 0; m < 4; m++){
+				if(m == k) continue;
+				double tm = (s == 0) ? m - 1 : ((s == 1) ? m : m - 2);
+				// poly *= (t - tm)
+				for(int j = deg+1; j > 0; j--){
+					poly[j] = poly[j-1] - tm * poly[j];
+				}
+				poly[0] *= -tm;
+				deg++;
+				denom *= (tk - tm);
+			}
+			for(int j = 0; j < 4; j++){
+				stencil_coeff[s][k][j] = poly[j] / denom;
+			}
+		}
+	}
+
+	for(int level = 1; level <= 4; level++){
+		double *table = new double[4 * num_intervals * num_functions[level]];
+		for(int f = 0; f < num_functions[level]; f++){
+			const double *y = &data[level][f * num_data_points];
+			double *c = &table[4 * num_intervals * f];
+			for(int i = 0; i < num_intervals; i++){
+				int s = (i == 0) ? 1 : ((i == num_intervals - 1) ? 2 : 0);
+				int start = (s == 0) ? i - 1 : ((s == 1) ? i : i - 2);
+				for(int j = 0; j < 4; j++){
+					c[4*i + j] = 0.;
+					for(int k = 0; k < 4; k++){
+						c[4*i + j] += stencil_coeff[s][k][j] * y[start + k];
+					}
+				}
+			}
+		}
+		delete[] data[level];
+		data[level] = table;
+	}
+	// the sample locations are implied by the uniform grid
+	delete[] data[0];
+	data[0] = 0;
 }
 
 void RuleWavelet::cubic_cascade(double *y, int starting_level, int iteration_depth){
@@ -227,14 +311,7 @@ void RuleWavelet::cubic_cascade(double *y, int starting_level, int iteration_dep
 	}
 }
 
-RuleWavelet::~RuleWavelet(){
-	if(order == 3){
-		for(int i = 0; i < 5; i++){
-			delete[] data[i];
-		}
-		delete[] data;
-	}
-};
+RuleWavelet::~RuleWavelet(){};
 
 TypeOneDRule RuleWavelet::getType() const{
 	return rule_wavelet;
@@ -338,9 +415,13 @@ int RuleWavelet::intlog2( int i ){
 	/*
 	 * Calculates the smallest power of two, k, such that 2^k <= i.
 	 */
+#ifdef __GNUC__
+	return (i > 0) ? (int) (8 * sizeof(int)) - 1 - __builtin_clz( (unsigned int) i ) : 0;
+#else
 	int result = 0;
 	while (i >>= 1){ result++; }
 	return result;
+#endif
 }
 
 double RuleWavelet::getX(int point) const {
@@ -417,24 +498,52 @@ double RuleWavelet::eval(int point, double x) const{
 	return 0.;
 }
 
+void RuleWavelet::eval(int point, const double x[], int num_x, double y[]) const{
+	/*
+	 * Evaluates a wavelet designated by point at num_x coordinates. For cubic wavelets,
+	 * the table and the affine map are resolved once for all x.
+	 */
+	if(order == 3){
+		double a, b;
+		const double *table = getCubicTable(point, a, b);
+		for(int i = 0; i < num_x; i++){
+			y[i] = (x[i] > 1. || x[i] < -1.) ? 0. : evalTable(table, a * x[i] + b);
+		}
+	}else{
+		for(int i = 0; i < num_x; i++){
+			y[i] = eval(point, x[i]);
+		}
+	}
+}
+
 double RuleWavelet::eval_cubic(int point, double x) const{
 	/*
 	 * Evaluates a third order wavelet at a given point x.
 	 */
-	int num_data_points = (1 << iteration_depth) + 1;
+	double a, b;
+	const double *table = getCubicTable(point, a, b);
+	return evalTable(table, a * x + b);
+}
+
+const double* RuleWavelet::getCubicTable(int point, double &a, double &b) const{
+	/*
+	 * Returns the polynomial table associated with point, the value of the function at x
+	 * is the value of the table at u = a * x + b.
+	 */
+	int table_size = 4 * (1 << iteration_depth);
+	a = 1.; b = 0.;
 	if (point < 5){ // Scaling functions
 		if (point == 2){ // Reflect across y-axis
 			point = 1;
-			x = -x;
+			a = -1.;
 		}else if(point == 4){
 			point = 3;
-			x = -x;
+			a = -1.;
 		}
 		// Point 0 -> data[1][0]
-		// Point 1 -> data[1][1 * num_data_points]
-		// Point 3 -> data[1][2 * num_data_points]
-		double *phi = &data[1][((point+1)/2) * num_data_points];
-		return interpolate(phi, x);
+		// Point 1 -> data[1][1 * table_size]
+		// Point 3 -> data[1][2 * table_size]
+		return &data[1][((point+1)/2) * table_size];
 	}
 	int l = intlog2(point - 1);
 
@@ -442,36 +551,54 @@ double RuleWavelet::eval_cubic(int point, double x) const{
 		if (point > 6){
 			// i.e. 7 or 8
 			// These wavelets are reflections across the y-axis of 6 & 5, respectively
-			x = -x;
+			a = -1.;
 			point = 13 - point;
 		}
 		point -= 5;
-		return interpolate(&data[2][point*num_data_points],x);
+		return &data[2][point*table_size];
 	}else if(l == 3){
 		if (point > 12){
 			// i.e. 13, 14, 15, 16
 			// These wavelets are reflections of 12, 11, 10, 9, respectively
-			x = -x;
+			a = -1.;
 			point = 25 - point;
 		}
 		point -= 9;
-		return interpolate(&data[3][point*num_data_points],x);
+		return &data[3][point*table_size];
 	}
 	// Standard lifted wavelets.
 	int subindex = (point - 1) % (1 << l);
-	double scale = pow(2,l-4);
+	double scale = ldexp(1., l-4);
 	// Left Boundary
 	if (subindex < 5){
-		return interpolate(&data[4][subindex*num_data_points],scale * (x + 1.) - 1.);
+		a = scale; b = scale - 1.;
+		return &data[4][subindex*table_size];
 	}
 	// Right Boundary
 	if ((1 << l) - 1 - subindex < 5){
-		return interpolate(&data[4][((1 << l) - subindex - 1)*num_data_points],scale * (1. - x) - 1.);
+		a = -scale; b = scale - 1.;
+		return &data[4][((1 << l) - subindex - 1)*table_size];
 	}
 	// Center
 	double shift = 0.125 * (double (subindex - 5));
-	return interpolate(&data[4][5*num_data_points], scale * (x + 1.) -1. - shift);
+	a = scale; b = scale - 1. - shift;
+	return &data[4][5*table_size];
+}
 
+double RuleWavelet::evalTable(const double *table, double u) const{
+	/*
+	 * Evaluates the piece-wise cubic stored in table at u in [-1, 1], zero outside.
+	 */
+	if (u > 1. || u < -1.){
+		return 0.;
+	}
+	int num_intervals = (1 << iteration_depth);
+	double s = 0.5 * (u + 1.) * num_intervals;
+	int i = (int) s;
+	if(i >= num_intervals) i = num_intervals - 1;
+	double t = s - i;
+	const double *c = &table[4*i];
+	return ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
 }
 
 double RuleWavelet::eval_linear(int point, double x) const{
@@ -481,7 +608,7 @@ double RuleWavelet::eval_linear(int point, double x) const{
 		// Standard Lifted Wavelets
 		int l = intlog2(point - 1);
 		int subindex = (point - 1) % (1 << l);
-		double scale = pow(2,l-2);
+		double scale = ldexp(1., l-2);
 
 		// Left Boundary
 		if ( subindex == 0 ){
@@ -537,78 +664,4 @@ double RuleWavelet::linear_central_wavelet(double x) const {
 	return 0.;
 }
 
-int RuleWavelet::find_index(double x) const{
-	/*
-	 * Finds an interval such that x_i <= x < x_i+1 using bisection search and returns i.
-	 */
-	if (x > 1. || x < -1.){
-		return -1;
-	}
-	// Bisection search
-	int idx = 0;
-	int num_points = (1 << iteration_depth) + 1;
-	double *xs = data[0];
-	int low = 0;
-	int high = num_points-1;
-	int test;
-	while(high - low > 1){
-		test = (high + low)/2;
-		if (x < xs[test]){
-			high = test;
-		}
-		else{
-			low = test;
-		}
-	}
-
-	return low;
-}
-
-
-double RuleWavelet::interpolate(const double *y, double x, int interpolation_order) const{
-	/*
-	 * For a given x value and dataset y, calculates the value of the interpolating
-	 * polynomial of given order going through the nearby points.
-	 */
-	int idx = find_index(x),
-		num_points = (1 << iteration_depth) + 1;
-
-	if (idx == -1){
-		// Outside of table
-		return 0.;
-	}
-
-	// Neville's Algorithm
-	double *ps = new double[interpolation_order + 1],
-		   *xs = new double[interpolation_order + 1],
-		   *xx = data[0];
-
-	if (idx < interpolation_order/2){
-		idx = interpolation_order/2;
-	}else if(num_points - idx - 1 < (interpolation_order+1)/2 ){
-		idx = num_points - 1 - (interpolation_order+1)/2;
-	}
-
-	int start = idx - interpolation_order / 2;
-	for(int i = 0; i < interpolation_order + 1; i++){
-		ps[i] = y[start + i];
-		xs[i] = xx[start + i];
-	}
-
-	for(int i = 0; i <= interpolation_order; i++){
-		for(int j = 0; j < interpolation_order - i; j++){
-			ps[j] = ((x - xs[j+i+1]) * ps[j] + (xs[j] - x) * ps[j+1]) /(xs[j] - xs[j+i+1]);
-		}
-	}
-
-	double v = ps[0];
-
-	delete[] ps;
-	delete[] xs;
-
-	return v;
-
-
-}
-
 } /* namespace TasGrid */
@@ -32,6 +32,8 @@
 
 #include "math.h"
 #include <sstream>
+#include <map>
+#include <mutex>
 
 
 
@@ -58,6 +60,7 @@ public:
 
 	double getWeight( int point ) const; // get the quadrature weight associated with the point
 	double eval(int point, double x ) const; // returns the value of point at location x (there is assumed 1-1 corresponcence between points and functions)
+	void eval(int point, const double x[], int num_x, double y[] ) const; // same as above for num_x values of x, y[i] = eval(point, x[i])
 
 	TypeOneDRule getType() const; // returns the type of rule
 
@@ -76,10 +79,19 @@ protected:
 	int iteration_depth;
 	static void cubic_cascade(double *y, int starting_level, int iteration_depth);
 
-	int find_index(double x) const;
-	double interpolate(const double *y, double x, int interpolation_order = 3) const;
-
-	double **data;
+	// returns the tables for the cubic rule, computed on the first call and shared afterwards
+	static const double* const* getCubicTables(int iteration_depth);
+	static double** computeCubicTables(int iteration_depth);
+	// converts the cascade samples in data[1] ... data[4] into piece-wise cubic polynomials
+	static void buildPolynomialTables(double **data, int iteration_depth);
+	// finds the table of a cubic wavelet and the affine map u = a * x + b into its support
+	const double* getCubicTable(int point, double &a, double &b) const;
+	double evalTable(const double *table, double u) const;
+
+	// data[1] ... data[4] hold the cubic scaling functions and wavelets, each one is stored as
+	// 4 Horner coefficients per interval of the uniform grid with 2^iteration_depth intervals
+	// the tables are shared by all rules with the same iteration_depth and must not be modified
+	const double* const* data;
 };
 
 } /* namespace TasGrid */
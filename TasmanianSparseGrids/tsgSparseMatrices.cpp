@@ -70,7 +70,7 @@ double norm(const double *x, const int length, const double type){
 		// Inf-norm
 		// Nasty work-around for no reduction max/min clause in openmp for c++.
 		double lp;
-		#pragma omp paralel private(lp)
+		#pragma omp parallel private(lp)
 		{
 			lp = 0.;
 			#pragma omp for
@@ -99,6 +99,144 @@ double norm(const double *x, const int length, const double type){
 	return norm;
 }
 
+double cg_update(double alpha, double* __restrict x, const double* __restrict p,
+		double* __restrict r, const double* __restrict q, int length){
+	/*
+	 * Fused CG step, computes x <- x + alpha*p and r <- r - alpha*q
+	 * and returns the new r^T r, all in a single sweep over the vectors.
+	 */
+	double rr = 0.;
+
+	#pragma omp parallel for schedule(static) reduction(+:rr)
+	for(int i = 0; i < length; i++){
+		x[i] += alpha * p[i];
+		double ri = r[i] - alpha * q[i];
+		r[i] = ri;
+		rr += ri * ri;
+	}
+
+	return rr;
+}
+
+static int balanced_split(const int *ptr, int outer, int nnz, int part, int num_parts){
+	/*
+	 * Returns the first row (or column) of the part-th out of num_parts chunks, where the
+	 * chunks have (roughly) the same number of non-zeros rather than the same number of rows.
+	 */
+	if(part == 0) return 0;
+	if(part == num_parts) return outer;
+	int target = (int) (((long long) nnz * part) / num_parts);
+	return (int) (std::lower_bound(ptr, ptr + outer, target) - ptr);
+}
+
+void compressed_gather(int outer, const int *ptr, const int *ind, const double *val,
+		const double* __restrict x, double* __restrict y){
+	/*
+	 * Computes y[i] += sum_j val[j] * x[ind[j]] for j in ptr[i] ... ptr[i+1]-1, i.e.,
+	 * CSR times vector or CSC^T times vector. Each thread takes a contiguous block of
+	 * rows with about nnz / num_threads entries, the inner loop has no dependencies.
+	 */
+	int nnz = ptr[outer];
+	#pragma omp parallel
+	{
+		int num_threads = 1, thread_id = 0;
+		#ifdef _OPENMP
+		num_threads = omp_get_num_threads();
+		thread_id = omp_get_thread_num();
+		#endif
+		int row_start = balanced_split(ptr, outer, nnz, thread_id, num_threads);
+		int row_end = balanced_split(ptr, outer, nnz, thread_id+1, num_threads);
+		for(int i = row_start; i < row_end; i++){
+			double sum = 0.;
+			for(int j = ptr[i]; j < ptr[i+1]; j++){
+				sum += val[j] * x[ind[j]];
+			}
+			y[i] += sum;
+		}
+	}
+}
+
+void compressed_scatter(int outer, int inner, const int *ptr, const int *ind, const double *val,
+		const double* __restrict x, double* __restrict y){
+	/*
+	 * Computes y[ind[j]] += val[j] * x[i] for j in ptr[i] ... ptr[i+1]-1, i.e.,
+	 * CSC times vector or CSR^T times vector. Rather than protecting y with atomics,
+	 * each thread scatters its nnz-balanced block into a private copy of y and the
+	 * copies are summed at the end.
+	 */
+	int nnz = ptr[outer];
+	int num_threads = 1;
+	#ifdef _OPENMP
+	num_threads = omp_get_max_threads();
+	#endif
+	if(num_threads == 1){
+		for(int i = 0; i < outer; i++){
+			for(int j = ptr[i]; j < ptr[i+1]; j++){
+				y[ind[j]] += val[j] * x[i];
+			}
+		}
+		return;
+	}
+
+	double *partial = new double[num_threads * inner];
+	int used_threads = num_threads;
+	#pragma omp parallel num_threads(num_threads)
+	{
+		int thread_id = 0;
+		#ifdef _OPENMP
+		thread_id = omp_get_thread_num();
+		#pragma omp single
+		used_threads = omp_get_num_threads();
+		#endif
+		double *py = &(partial[thread_id * inner]);
+		tzero(inner, py);
+		int col_start = balanced_split(ptr, outer, nnz, thread_id, used_threads);
+		int col_end = balanced_split(ptr, outer, nnz, thread_id+1, used_threads);
+		for(int i = col_start; i < col_end; i++){
+			double xi = x[i];
+			for(int j = ptr[i]; j < ptr[i+1]; j++){
+				py[ind[j]] += val[j] * xi;
+			}
+		}
+		#pragma omp barrier
+		#pragma omp for schedule(static)
+		for(int k = 0; k < inner; k++){
+			double sum = 0.;
+			for(int t = 0; t < used_threads; t++){
+				sum += partial[t * inner + k];
+			}
+			y[k] += sum;
+		}
+	}
+	delete[] partial;
+}
+
+void compressed_transpose(int outer, int inner, int nnz, const int *ptr, const int *ind,
+		const double *val, int *t_ptr, int *t_ind, double *t_val){
+	/*
+	 * Re-compresses the matrix along the other dimension (counting sort on ind), e.g.,
+	 * converts CSR of A into CSR of A^T. t_ptr must have inner+1 entries, t_ind and
+	 * t_val must have nnz entries. Indexes within each compressed slice remain sorted.
+	 */
+	tzero(inner+1, t_ptr);
+	for(int j = 0; j < nnz; j++){
+		t_ptr[ind[j]+1]++;
+	}
+	for(int k = 0; k < inner; k++){
+		t_ptr[k+1] += t_ptr[k];
+	}
+	int *offset = new int[inner];
+	tcopy(inner, t_ptr, offset);
+	for(int i = 0; i < outer; i++){
+		for(int j = ptr[i]; j < ptr[i+1]; j++){
+			int k = offset[ind[j]]++;
+			t_ind[k] = i;
+			t_val[k] = val[j];
+		}
+	}
+	delete[] offset;
+}
+
 /* BEGIN TsgSparseCOO */
 
 TsgSparseCOO::TsgSparseCOO() : m(0), n(0), sorted(unsorted), nnz(0){}
@@ -291,6 +429,10 @@ TsgSparseCSR::~TsgSparseCSR(){
 	clear();
 }
 
+size_t TsgSparseCSR::getMemoryUsage() const{
+	return sizeof(int) * (m + 1 + (size_t) nnz) + sizeof(double) * (size_t) nnz;
+}
+
 void TsgSparseCSR::clear(){
 	if(delete_on_destruction){
 		delete[] val;
@@ -303,7 +445,7 @@ void TsgSparseCSR::clear(){
 	m = 0; n = 0; nnz = 0; delete_on_destruction = false;
 }
 
-void TsgSparseCSR::write(std::ofstream &ofs) const{
+void TsgSparseCSR::write(std::ostream &ofs) const{
 	ofs << "m: " << m << endl;
 	ofs << "n: " << n << endl;
 	ofs << "nnz: " << nnz << endl;
@@ -325,13 +467,62 @@ void TsgSparseCSR::write(std::ofstream &ofs) const{
 	}
 }
 
-bool TsgSparseCSR::read(std::ifstream &ifs){
+void TsgSparseCSR::writeBinary(std::ostream &ofs, bool compressed) const{
+	int initialized = (val != 0 && col_ind != 0 && row_ptr != 0) ? 1 : 0;
+	int header[6] = { (int) csr, m, n, nnz, initialized, (compressed) ? 1 : 0 };
+	twriteBinary(6, header, ofs);
+	if(initialized == 1){
+		twriteBinary(nnz, val, ofs);
+		if(compressed){
+			twriteFrames(nnz, 1, col_ind, ofs);
+			twriteFrames(m+1, 1, row_ptr, ofs);
+		}else{
+			twriteBinary(nnz, col_ind, ofs);
+			twriteBinary(m+1, row_ptr, ofs);
+		}
+	}
+}
+bool TsgSparseCSR::readBinary(std::istream &ifs){
+	clear();
+	int header[6];
+	if(!treadBinary(6, header, ifs) || (header[0] != (int) csr)){
+		cout << "ERROR: Wrong File Format! code CSR 8" << endl;
+		return false;
+	}
+	return readBinaryArrays(header, ifs);
+}
+bool TsgSparseCSR::readBinaryArrays(const int header[], std::istream &ifs){
+	clear();
+	if((header[5] < 0) || (header[5] > 1)){
+		cout << "ERROR: Wrong File Format! code CSR 8" << endl;
+		return false;
+	}
+	m = header[1]; n = header[2]; nnz = header[3];
+	if(header[4] == 1){
+		val = new double[nnz];
+		col_ind = new int[nnz];
+		row_ptr = new int[m+1];
+		delete_on_destruction = true;
+		bool pass = treadBinary(nnz, val, ifs);
+		if(header[5] == 1){
+			pass = pass && treadFrames(nnz, 1, col_ind, ifs) && treadFrames(m+1, 1, row_ptr, ifs);
+		}else{
+			pass = pass && treadBinary(nnz, col_ind, ifs) && treadBinary(m+1, row_ptr, ifs);
+		}
+		if(!pass){
+			cout << "ERROR: Wrong File Format! code CSR 9" << endl;
+			clear();
+			return false;
+		}
+	}
+	return true;
+}
+bool TsgSparseCSR::read(std::istream &ifs){
 	clear();
 	std::string T;
 
 	ifs >> T; if ( !(T.compare( "m:" ) == 0) ){
 		cout << "ERROR: Wrong File Format! code CSR 1" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -339,7 +530,6 @@ bool TsgSparseCSR::read(std::ifstream &ifs){
 
 	ifs >> T; if ( !(T.compare( "n:" ) == 0) ){
 		cout << "ERROR: Wrong File Format! code CSR 2" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -347,7 +537,6 @@ bool TsgSparseCSR::read(std::ifstream &ifs){
 
 	ifs >> T; if ( !(T.compare( "nnz:" ) == 0) ){
 		cout << "ERROR: Wrong File Format! code CSR 3" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -355,7 +544,6 @@ bool TsgSparseCSR::read(std::ifstream &ifs){
 
 	ifs >> T; if ( !(T.compare( "initialized:" ) == 0) ){
 		cout << "ERROR: Wrong File Format! code CSR 4" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -364,7 +552,6 @@ bool TsgSparseCSR::read(std::ifstream &ifs){
 
 		ifs >> T; if ( !(T.compare( "val:" ) == 0) ){
 			cout << "ERROR: Wrong File Format! code CSR 5" << endl;
-			ifs.close();
 			clear();
 			return false;
 		}
@@ -374,7 +561,6 @@ bool TsgSparseCSR::read(std::ifstream &ifs){
 		ifs >> T; if ( !(T.compare( "col_ind:" ) == 0) ){
 			cout << "ERROR: Wrong File Format! code CSR 6" << endl;
 			delete[] val;
-			ifs.close();
 			clear();
 			return false;
 		}
@@ -385,7 +571,6 @@ bool TsgSparseCSR::read(std::ifstream &ifs){
 			cout << "ERROR: Wrong File Format! code CSR 7" << endl;
 			delete[] val;
 			delete[] col_ind;
-			ifs.close();
 			clear();
 			return false;
 		}
@@ -412,24 +597,9 @@ void TsgSparseCSR::matvec(const double* __restrict x, double* __restrict y,
 	 */
 	if(transpose){
 		/* A in CSR format = A^T in CSC format */
-		TsgSparseMatrix *mat = this->transpose();
-		mat->matvec(x,y);
-		delete mat;
+		compressed_scatter(m, n, row_ptr, col_ind, val, x, y);
 	}else{
-		/*
-		 * Parallelize the loop over each row. Use guided scheduling since each row will
-		 * take a different amount of time to complete.
-		 */
-
-		#pragma omp parallel for schedule(guided)
-		for(int i = 0; i < m; i++){
-
-			int num_elem = row_ptr[i+1] - row_ptr[i];
-			int row_start = row_ptr[i];
-			for(int j = 0; j < num_elem; j++){
-				y[i] += val[row_start+j] * x[col_ind[row_start + j]];
-			}
-		}
+		compressed_gather(m, row_ptr, col_ind, val, x, y);
 	}
 }
 
@@ -437,6 +607,19 @@ TsgSparseMatrix* TsgSparseCSR::transpose(bool copy /* = false */) const{
 	return new TsgSparseCSC(col_ind, row_ptr, val, n, m, nnz, copy);
 }
 
+TsgSparseMatrix* TsgSparseCSR::buildTranspose() const{
+	TsgSparseCSR *mat = new TsgSparseCSR();
+	mat->m = n;
+	mat->n = m;
+	mat->nnz = nnz;
+	mat->row_ptr = new int[n+1];
+	mat->col_ind = new int[nnz];
+	mat->val = new double[nnz];
+	mat->delete_on_destruction = true;
+	compressed_transpose(m, n, nnz, row_ptr, col_ind, val, mat->row_ptr, mat->col_ind, mat->val);
+	return mat;
+}
+
 
 /* END TsgSparseCSR */
 
@@ -512,6 +695,10 @@ TsgSparseCSC::~TsgSparseCSC(){
 	clear();
 }
 
+size_t TsgSparseCSC::getMemoryUsage() const{
+	return sizeof(int) * (n + 1 + (size_t) nnz) + sizeof(double) * (size_t) nnz;
+}
+
 void TsgSparseCSC::clear(){
 	if(delete_on_destruction){
 		delete[] val;
@@ -524,7 +711,7 @@ void TsgSparseCSC::clear(){
 	m = 0; n = 0; nnz = 0; delete_on_destruction = false;
 }
 
-void TsgSparseCSC::write(std::ofstream &ofs) const{
+void TsgSparseCSC::write(std::ostream &ofs) const{
 	ofs << "m: " << m << endl;
 	ofs << "n: " << n << endl;
 	ofs << "nnz: " << nnz << endl;
@@ -546,13 +733,62 @@ void TsgSparseCSC::write(std::ofstream &ofs) const{
 	}
 }
 
-bool TsgSparseCSC::read(std::ifstream &ifs){
+void TsgSparseCSC::writeBinary(std::ostream &ofs, bool compressed) const{
+	int initialized = (val != 0 && row_ind != 0 && col_ptr != 0) ? 1 : 0;
+	int header[6] = { (int) csc, m, n, nnz, initialized, (compressed) ? 1 : 0 };
+	twriteBinary(6, header, ofs);
+	if(initialized == 1){
+		twriteBinary(nnz, val, ofs);
+		if(compressed){
+			twriteFrames(nnz, 1, row_ind, ofs);
+			twriteFrames(n+1, 1, col_ptr, ofs);
+		}else{
+			twriteBinary(nnz, row_ind, ofs);
+			twriteBinary(n+1, col_ptr, ofs);
+		}
+	}
+}
+bool TsgSparseCSC::readBinary(std::istream &ifs){
+	clear();
+	int header[6];
+	if(!treadBinary(6, header, ifs) || (header[0] != (int) csc)){
+		cout << "ERROR: Wrong File Format! code CSC 8" << endl;
+		return false;
+	}
+	return readBinaryArrays(header, ifs);
+}
+bool TsgSparseCSC::readBinaryArrays(const int header[], std::istream &ifs){
+	clear();
+	if((header[5] < 0) || (header[5] > 1)){
+		cout << "ERROR: Wrong File Format! code CSC 8" << endl;
+		return false;
+	}
+	m = header[1]; n = header[2]; nnz = header[3];
+	if(header[4] == 1){
+		val = new double[nnz];
+		row_ind = new int[nnz];
+		col_ptr = new int[n+1];
+		delete_on_destruction = true;
+		bool pass = treadBinary(nnz, val, ifs);
+		if(header[5] == 1){
+			pass = pass && treadFrames(nnz, 1, row_ind, ifs) && treadFrames(n+1, 1, col_ptr, ifs);
+		}else{
+			pass = pass && treadBinary(nnz, row_ind, ifs) && treadBinary(n+1, col_ptr, ifs);
+		}
+		if(!pass){
+			cout << "ERROR: Wrong File Format! code CSC 9" << endl;
+			clear();
+			return false;
+		}
+	}
+	return true;
+}
+bool TsgSparseCSC::read(std::istream &ifs){
 	clear();
 	std::string T;
 
 	ifs >> T; if ( !(T.compare( "m:" ) == 0) ){
 		cout << "ERROR: Wrong File Format! code CSC 1" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -560,7 +796,6 @@ bool TsgSparseCSC::read(std::ifstream &ifs){
 
 	ifs >> T; if ( !(T.compare( "n:" ) == 0) ){
 		cout << "ERROR: Wrong File Format! code CSC 2" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -568,7 +803,6 @@ bool TsgSparseCSC::read(std::ifstream &ifs){
 
 	ifs >> T; if ( !(T.compare( "nnz:" ) == 0) ){
 		cout << "ERROR: Wrong File Format! code CSC 3" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -576,7 +810,6 @@ bool TsgSparseCSC::read(std::ifstream &ifs){
 
 	ifs >> T; if ( !(T.compare( "initialized:" ) == 0) ){
 		cout << "ERROR: Wrong File Format! code CSC 4" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -585,7 +818,6 @@ bool TsgSparseCSC::read(std::ifstream &ifs){
 
 		ifs >> T; if ( !(T.compare( "val:" ) == 0) ){
 			cout << "ERROR: Wrong File Format! code CSC 5" << endl;
-			ifs.close();
 			clear();
 			return false;
 		}
@@ -595,7 +827,6 @@ bool TsgSparseCSC::read(std::ifstream &ifs){
 		ifs >> T; if ( !(T.compare( "row_ind:" ) == 0) ){
 			cout << "ERROR: Wrong File Format! code CSC 6" << endl;
 			delete[] val;
-			ifs.close();
 			clear();
 			return false;
 		}
@@ -606,7 +837,6 @@ bool TsgSparseCSC::read(std::ifstream &ifs){
 			cout << "ERROR: Wrong File Format! code CSC 7" << endl;
 			delete[] val;
 			delete[] row_ind;
-			ifs.close();
 			clear();
 			return false;
 		}
@@ -633,32 +863,9 @@ void TsgSparseCSC::matvec(const double* __restrict x, double* __restrict y,
 	 */
 	if(transpose){
 		/* A in CSC format = A^T in CSR format */
-		TsgSparseMatrix *mat = this->transpose();
-		mat->matvec(x,y);
-		delete mat;
+		compressed_gather(n, col_ptr, row_ind, val, x, y);
 	}else{
-		/*
-		 * Parallelize the loop over each col. Use guided scheduling since each col will
-		 * take a different amount of time to complete. Second parameter specifies the
-		 * minimum chunk size. Note: This is likely slower than the equivalent CSR
-		 * multiply since y[i] updates must be protected.
-		 */
-		#pragma omp parallel for schedule(guided)
-		for(int j = 0; j < n; j++){
-			int num_elem = col_ptr[j+1] - col_ptr[j];
-			int col_start = col_ptr[j];
-			for(int i = 0; i < num_elem; i++){
-				/*
-				 * Below atomic directive protects the memory accesses in y. The behavior
-				 * is implementation (compiler) specific. At worst, it is a critical block
-				 * around the operation. However, the atomic directive often enjoys better
-				 * performance by being less restrictive in locking and can use hardware
-				 * instructions for atomic operations if available.
-				 */
-				#pragma omp atomic
-				y[row_ind[col_start+i]] += val[col_start + i] * x[j];
-			}
-		}
+		compressed_scatter(n, m, col_ptr, row_ind, val, x, y);
 	}
 }
 
@@ -666,20 +873,211 @@ TsgSparseMatrix* TsgSparseCSC::transpose(bool copy /*= false */) const{
 	return new TsgSparseCSR(row_ind, col_ptr, val, n, m, nnz, copy);
 }
 
+TsgSparseMatrix* TsgSparseCSC::buildTranspose() const{
+	TsgSparseCSC *mat = new TsgSparseCSC();
+	mat->m = n;
+	mat->n = m;
+	mat->nnz = nnz;
+	mat->col_ptr = new int[m+1];
+	mat->row_ind = new int[nnz];
+	mat->val = new double[nnz];
+	mat->delete_on_destruction = true;
+	compressed_transpose(n, m, nnz, col_ptr, row_ind, val, mat->col_ptr, mat->row_ind, mat->val);
+	return mat;
+}
+
 /* END TsgSparseCSC */
 
+/* BEGIN TsgSparseLU */
+
+TsgSparseLU::TsgSparseLU() : n(0){}
+
+TsgSparseLU::~TsgSparseLU(){
+	clear();
+}
+
+void TsgSparseLU::clear(){
+	n = 0;
+	perm.clear();
+	l_ptr.clear(); l_ind.clear(); l_val.clear();
+	u_ptr.clear(); u_ind.clear(); u_val.clear();
+}
+
+bool TsgSparseLU::isFactorized() const{ return (n > 0); }
+int TsgSparseLU::getNumNonzero() const{ return (int) (l_val.size() + u_val.size()); }
+size_t TsgSparseLU::getMemoryUsage() const{
+	return sizeof(int) * (perm.capacity() + l_ptr.capacity() + l_ind.capacity() + u_ptr.capacity() + u_ind.capacity())
+		+ sizeof(double) * (l_val.capacity() + u_val.capacity());
+}
+
+bool TsgSparseLU::factorize(const TsgSparseCSR &A, const int *order, double max_fill, double max_work){
+	/*
+	 * Row-by-row (IKJ) Gaussian elimination in the ordering given by order.
+	 * Row i of P*A*P^T is scattered into a dense work vector, then eliminated against
+	 * the already computed rows of U in increasing column order. Columns that appear
+	 * due to fill are pushed on a min-heap so the elimination order remains correct.
+	 */
+	clear();
+	if((A.m != A.n) || (A.m == 0)) return false;
+	int size = A.m;
+	size_t max_nnz = (size_t) (max_fill * A.nnz);
+	double work_left = max_work * A.nnz;
+
+	perm.resize(size);
+	std::vector<int> iperm(size);
+	for(int i = 0; i < size; i++){
+		perm[i] = order[i];
+		iperm[order[i]] = i;
+	}
+
+	std::vector<double> work(size, 0.);
+	std::vector<bool> marked(size, false);
+	std::vector<int> heap, upper;
+
+	l_ptr.resize(size+1); u_ptr.resize(size+1);
+	l_ptr[0] = 0; u_ptr[0] = 0;
+
+	for(int i = 0; i < size; i++){
+		heap.clear(); upper.clear();
+		int row = perm[i];
+		double row_scale = 0.;
+		for(int j = A.row_ptr[row]; j < A.row_ptr[row+1]; j++){
+			int c = iperm[A.col_ind[j]];
+			work[c] = A.val[j];
+			marked[c] = true;
+			if(c < i){
+				heap.push_back(c);
+			}else{
+				upper.push_back(c);
+			}
+			if(fabs(A.val[j]) > row_scale) row_scale = fabs(A.val[j]);
+		}
+		std::make_heap(heap.begin(), heap.end(), std::greater<int>());
+
+		while(!heap.empty()){
+			std::pop_heap(heap.begin(), heap.end(), std::greater<int>());
+			int k = heap.back();
+			heap.pop_back();
+
+			double factor = work[k] / u_val[u_ptr[k]];
+			work[k] = 0.;
+			marked[k] = false;
+			if(factor == 0.) continue;
+			l_ind.push_back(k);
+			l_val.push_back(factor);
+
+			work_left -= (double) (u_ptr[k+1] - u_ptr[k] - 1);
+			for(int j = u_ptr[k]+1; j < u_ptr[k+1]; j++){
+				int c = u_ind[j];
+				if(!marked[c]){
+					marked[c] = true;
+					if(c < i){
+						heap.push_back(c);
+						std::push_heap(heap.begin(), heap.end(), std::greater<int>());
+					}else{
+						upper.push_back(c);
+					}
+				}
+				work[c] -= factor * u_val[j];
+			}
+		}
+
+		std::sort(upper.begin(), upper.end());
+		if(upper.empty() || (upper[0] != i) || (fabs(work[i]) <= NUM_TOL * row_scale)){
+			// structurally or numerically zero pivot
+			clear();
+			return false;
+		}
+		for(size_t j = 0; j < upper.size(); j++){
+			int c = upper[j];
+			u_ind.push_back(c);
+			u_val.push_back(work[c]);
+			work[c] = 0.;
+			marked[c] = false;
+		}
+
+		l_ptr[i+1] = (int) l_ind.size();
+		u_ptr[i+1] = (int) u_ind.size();
+		if((l_ind.size() + u_ind.size() > max_nnz) || (work_left < 0.)){
+			// too much fill or work, the iterative solver will be faster
+			clear();
+			return false;
+		}
+	}
+
+	n = size;
+	return true;
+}
+
+void TsgSparseLU::solve(const double* __restrict b, double* __restrict x) const{
+	/*
+	 * Forward substitution with L followed by backward substitution with U.
+	 * The permutation is applied on the fly, x and b must not overlap.
+	 */
+	double *y = new double[n];
+	for(int i = 0; i < n; i++){
+		double sum = b[perm[i]];
+		for(int j = l_ptr[i]; j < l_ptr[i+1]; j++){
+			sum -= l_val[j] * y[l_ind[j]];
+		}
+		y[i] = sum;
+	}
+	for(int i = n-1; i >= 0; i--){
+		double sum = y[i];
+		for(int j = u_ptr[i]+1; j < u_ptr[i+1]; j++){
+			sum -= u_val[j] * y[u_ind[j]];
+		}
+		y[i] = sum / u_val[u_ptr[i]];
+		x[perm[i]] = y[i];
+	}
+	delete[] y;
+}
+
+void TsgSparseLU::solveTransposed(const double* __restrict b, double* __restrict x) const{
+	/*
+	 * Solves U^T * z = P*b and then L^T * y = z, both factors are traversed by rows
+	 * and the updates are scattered forward (respectively backward).
+	 */
+	double *y = new double[n];
+	for(int i = 0; i < n; i++){
+		y[i] = b[perm[i]];
+	}
+	for(int i = 0; i < n; i++){
+		y[i] /= u_val[u_ptr[i]];
+		double yi = y[i];
+		for(int j = u_ptr[i]+1; j < u_ptr[i+1]; j++){
+			y[u_ind[j]] -= u_val[j] * yi;
+		}
+	}
+	for(int i = n-1; i >= 0; i--){
+		double yi = y[i];
+		for(int j = l_ptr[i]; j < l_ptr[i+1]; j++){
+			y[l_ind[j]] -= l_val[j] * yi;
+		}
+		x[perm[i]] = yi;
+	}
+	delete[] y;
+}
+
+/* END TsgSparseLU */
+
 /* BEGIN TsgSparseMatrix */
 
 TsgCgStatus TsgSparseMatrix::cg(const double* __restrict b, double* __restrict x,
-		const int max_iter, const double tol) const{
+		const int max_iter, const double tol, int *iterations) const{
 	/*
 	 * Attempts to solve A * x = b using the conjugate gradient method.
 	 * Iterates up to max_iter times or until norm(b - Ax)/norm(b) < tol. Initial guess
 	 * for x should be stored in x when passed in. Note that A must be a symmetric,
 	 * positive definite matrix in order to guarantee convergence.
+	 *
+	 * The solver is bandwidth bound, hence the updates of x and the residual and the
+	 * new residual norm are computed in one sweep (cg_update) and r^T r is carried
+	 * over between iterations instead of being recomputed.
 	 */
 
 	int size = m;
+	if(iterations != 0) *iterations = 0;
 
 	double norm_b = norm(b, size, 2.);
 	if(norm_b == 0.){
@@ -688,15 +1086,14 @@ TsgCgStatus TsgSparseMatrix::cg(const double* __restrict b, double* __restrict x
 		return converged;
 	}
 
-	// Reduced 4 individual news to a single new
-	double *workspace = new double[4*size];
-	tzero(4*size, workspace);
+	// Reduced 3 individual news to a single new
+	double *workspace = new double[3*size];
+	tzero(3*size, workspace);
 
 	// Relevant portions of the workspace
 	double *residual = workspace;
 	double *conjugate = (workspace + size);
-	double *residual_old = (workspace + 2 * size);
-	double *tmp_array = (workspace + 3 * size);
+	double *tmp_array = (workspace + 2 * size);
 
 	// Initialize residual with Ax to calculate r = b - Ax.
 	matvec(x, residual);
@@ -705,27 +1102,26 @@ TsgCgStatus TsgSparseMatrix::cg(const double* __restrict b, double* __restrict x
 
 	tcopy(size, residual, conjugate);
 
+	double rr = inner_product(residual, residual, size);
+	double tol2 = tol * tol * norm_b * norm_b;
 
 	for(int i = 0; i < max_iter; i++){
 		tzero(size, tmp_array);
-		tcopy(size, residual, residual_old);
 		// tmp_array = A*conjugate
 		matvec(conjugate, tmp_array);
 
-		double alpha = inner_product(residual, residual, size) /
-				inner_product(conjugate, tmp_array, size);
+		double alpha = rr / inner_product(conjugate, tmp_array, size);
 
-		// x_k+1 = x_k + alpha * conjugate_k
-		axpby(1., x, alpha, conjugate, size);
-		// res_k+1 = res_k - alpha * A*conjugate_k
-		axpby(1., residual, -alpha, tmp_array, size);
-		if( norm(residual, size, 2.) / norm_b < tol){
+		// x_k+1 = x_k + alpha * conjugate_k, res_k+1 = res_k - alpha * A*conjugate_k
+		double rr_new = cg_update(alpha, x, conjugate, residual, tmp_array, size);
+		if(rr_new < tol2){
+			if(iterations != 0) *iterations = i + 1;
 			delete[] workspace;
 			return converged;
 		}
 
-		double beta = inner_product(residual, residual, size) /
-						inner_product(residual_old, residual_old, size);
+		double beta = rr_new / rr;
+		rr = rr_new;
 
 		// conjugate_k+1 = residual_k+1 + beta*conjugate_k
 		axpby(beta, conjugate, 1., residual, size);
@@ -734,43 +1130,47 @@ TsgCgStatus TsgSparseMatrix::cg(const double* __restrict b, double* __restrict x
 
 	delete[] workspace;
 
+	if(iterations != 0) *iterations = max_iter;
 	return max_iter_reached;
 
 
 }
 
 TsgCgStatus TsgSparseMatrix::cga(const double* __restrict b, double* __restrict x,
-		const int max_iter, const double tol) const{
+		const int max_iter, const double tol, int *iterations) const{
 	/*
 	 * Attempts to solve (A^T * A) * x = A^T * b using the conjugate gradient method.
 	 * Iterates up to max_iter times or until norm(b - Ax)/norm(b) < tol. Initial guess
 	 * for x should be stored in x when passed in. This version will work for arbitrary
 	 * square A with full rank. However, this approximately squares the
 	 * condition number and so should be used with caution.
+	 *
+	 * A^T is built explicitly once, so both products in each iteration use the same
+	 * (gather) kernel, the vector updates are fused as in cg().
 	 */
 #define APPLY_AT_A(AT,X,Y,TMP,SIZE) tzero(SIZE, TMP);\
 								 matvec(X,TMP);\
 								 AT->matvec(TMP, Y);
 	int size = m;
+	if(iterations != 0) *iterations = 0;
 	double norm_b = norm(b, size, 2.);
 	if(norm_b == 0.){
 		/* RHS is all zeros, so x = all zeros is a valid solution */
 		tzero(size, x);
 		return converged;
 	}
-	TsgSparseMatrix* A_trans = transpose();
+	TsgSparseMatrix* A_trans = buildTranspose();
 
-	// Reduced 6 individual news to a single new
-	double *workspace = new double[6*size];
-	tzero(6*size, workspace);
+	// Reduced 5 individual news to a single new
+	double *workspace = new double[5*size];
+	tzero(5*size, workspace);
 
 	// Relevant portions of the workspace
 	double *residual = workspace;
 	double *conjugate = workspace + size;
-	double *residual_old = workspace + 2 * size;
-	double *scaled_conjugate = workspace + 3 * size;
-	double *B = (workspace + 4 * size);
-	double *tmp_array = workspace + 5 * size;
+	double *scaled_conjugate = workspace + 2 * size;
+	double *B = (workspace + 3 * size);
+	double *tmp_array = workspace + 4 * size;
 
 	// B = A^T * b
 	A_trans->matvec(b, B);
@@ -783,28 +1183,27 @@ TsgCgStatus TsgSparseMatrix::cga(const double* __restrict b, double* __restrict
 
 	tcopy(size, residual, conjugate);
 
+	double rr = inner_product(residual, residual, size);
+	double tol2 = tol * tol * norm_b * norm_b;
 
 	for(int i = 0; i < max_iter; i++){
 		tzero(size, scaled_conjugate);
-		tcopy(size, residual, residual_old);
-		// tmp_array = A*conjugate
+		// scaled_conjugate = (A^T*A)*conjugate
 		APPLY_AT_A(A_trans, conjugate, scaled_conjugate, tmp_array, size);
 
-		double alpha = inner_product(residual, residual, size) /
-				inner_product(conjugate, scaled_conjugate, size);
+		double alpha = rr / inner_product(conjugate, scaled_conjugate, size);
 
-		// x_k+1 = x_k + alpha * conjugate_k
-		axpby(1., x, alpha, conjugate, size);
-		// res_k+1 = res_k - alpha * (A^T*A)*conjugate_k
-		axpby(1., residual, -alpha, scaled_conjugate, size);
-		if(norm(residual, size, 2.) / norm_b < tol){
+		// x_k+1 = x_k + alpha * conjugate_k, res_k+1 = res_k - alpha * (A^T*A)*conjugate_k
+		double rr_new = cg_update(alpha, x, conjugate, residual, scaled_conjugate, size);
+		if(rr_new < tol2){
+			if(iterations != 0) *iterations = i + 1;
 			delete[] workspace;
 			delete A_trans;
 			return converged;
 		}
 
-		double beta = inner_product(residual, residual, size) /
-						inner_product(residual_old, residual_old, size);
+		double beta = rr_new / rr;
+		rr = rr_new;
 
 		// conjugate_k+1 = residual_k+1 + beta*conjugate_k
 		axpby(beta, conjugate, 1., residual, size);
@@ -813,40 +1212,37 @@ TsgCgStatus TsgSparseMatrix::cga(const double* __restrict b, double* __restrict
 
 	delete[] workspace;
 	delete A_trans;
+	if(iterations != 0) *iterations = max_iter;
 	return max_iter_reached;
 #undef APPLY_AT_A
 
 }
 
-TsgSparseMatrix* TsgSparseMatrix::read_generic( std::ifstream &ifs ){
+TsgSparseMatrix* TsgSparseMatrix::read_generic( std::istream &ifs ){
 
 	std::string T;
 	TsgSparseType type;
 	int m, n, nnz;
 	ifs >> T; if ( !(T.compare( "m:" ) == 0) ){
 		cout << "ERROR: Wrong File Format! code SP 1" << endl;
-		ifs.close();
 		return 0;
 	}
 	ifs >> m;
 
 	ifs >> T; if ( !(T.compare( "n:" ) == 0) ){
 		cout << "ERROR: Wrong File Format! code SP 2" << endl;
-		ifs.close();
 		return 0;
 	}
 	ifs >> n;
 
 	ifs >> T; if ( !(T.compare( "nnz:" ) == 0) ){
 		cout << "ERROR: Wrong File Format! code SP 3" << endl;
-		ifs.close();
 		return 0;
 	}
 	ifs >> nnz;
 
 	ifs >> T; if ( !(T.compare( "initialized:" ) == 0) ){
 		cout << "ERROR: Wrong File Format! code SP 4" << endl;
-		ifs.close();
 		return 0;
 	}
 	ifs >> T;
@@ -854,7 +1250,6 @@ TsgSparseMatrix* TsgSparseMatrix::read_generic( std::ifstream &ifs ){
 
 		ifs >> T; if ( !(T.compare( "val:" ) == 0) ){
 			cout << "ERROR: Wrong File Format! code SP 5" << endl;
-			ifs.close();
 			return 0;
 		}
 		double *val = new double[nnz];
@@ -867,7 +1262,6 @@ TsgSparseMatrix* TsgSparseMatrix::read_generic( std::ifstream &ifs ){
 		}else{
 			cout << "ERROR: Wrong File Format! code SP 6" << endl;
 			delete[] val;
-			ifs.close();
 			return 0;
 		}
 		int *ind = new int[nnz];
@@ -884,7 +1278,6 @@ TsgSparseMatrix* TsgSparseMatrix::read_generic( std::ifstream &ifs ){
 			cout << "ERROR: Wrong File Format! code SP 7" << endl;
 			delete[] val;
 			delete[] ind;
-			ifs.close();
 			return 0;
 		}
 		int sz = (type == csc) ? n+1 : m+1;
@@ -899,6 +1292,56 @@ TsgSparseMatrix* TsgSparseMatrix::read_generic( std::ifstream &ifs ){
 
 
 	}
+	return 0;
+}
+TsgSparseMatrix* TsgSparseMatrix::read_generic_binary( std::istream &ifs ){
+	/*
+	 * The first entry written by writeBinary() is the storage type, read the header and let
+	 * the corresponding class read the rest (no seeking, so this works on pipes too).
+	 */
+	int header[6];
+	if(!treadBinary(6, header, ifs)){
+		cout << "ERROR: Wrong File Format! code SP 8" << endl;
+		return 0;
+	}
+	TsgSparseMatrix *A;
+	if(header[0] == (int) csr){
+		A = new TsgSparseCSR();
+	}else if(header[0] == (int) csc){
+		A = new TsgSparseCSC();
+	}else{
+		cout << "ERROR: Wrong File Format! code SP 9" << endl;
+		return 0;
+	}
+	if(!A->readBinaryArrays(header, ifs)){
+		delete A;
+		return 0;
+	}
+	return A;
+}
+TsgSparseMatrix* TsgSparseMatrix::map_generic_binary( const char* &data, const char *end ){
+	/*
+	 * Creates a CSR or CSC matrix that uses the arrays written by writeBinary() in place,
+	 * the matrix does not delete them on destruction.
+	 */
+	const int *header;
+	if(!tmapBinary(6, header, data, end) || ((header[0] != (int) csr) && (header[0] != (int) csc)) || (header[5] != 0)){
+		cout << "ERROR: Wrong File Format! code SP 10" << endl;
+		return 0;
+	}
+	int m = header[1], n = header[2], nnz = (header[4] == 1) ? header[3] : 0;
+	const double *val = 0;
+	const int *ind = 0, *ptr = 0;
+	int sz = (header[0] == (int) csc) ? n+1 : m+1;
+	if((header[4] == 1) && !(tmapBinary(nnz, val, data, end) && tmapBinary(nnz, ind, data, end) && tmapBinary(sz, ptr, data, end))){
+		cout << "ERROR: Wrong File Format! code SP 11" << endl;
+		return 0;
+	}
+	if(header[0] == (int) csc){
+		return new TsgSparseCSC((int*) ind, (int*) ptr, (double*) val, m, n, nnz);
+	}else{
+		return new TsgSparseCSR((int*) ind, (int*) ptr, (double*) val, m, n, nnz);
+	}
 }
 
 /* END TsgSparseMatrix */
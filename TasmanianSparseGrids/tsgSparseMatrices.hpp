@@ -28,9 +28,20 @@
 #include "tsgHelperFunctions.hpp"
 #include <list>
 #include <vector>
+#include <algorithm>
+#include <functional>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using TasGrid::twrite;
 using TasGrid::tread;
+using TasGrid::twriteBinary;
+using TasGrid::treadBinary;
+using TasGrid::twriteFrames;
+using TasGrid::treadFrames;
+using TasGrid::tmapBinary;
 using TasGrid::tzero;
 using TasGrid::tcopy;
 
@@ -106,18 +117,34 @@ public:
 	virtual void matvec(const double* __restrict x, double* __restrict y, bool transpose = false) const = 0;
 	virtual ~TsgSparseMatrix(){};
 	virtual TsgSparseMatrix* transpose(bool copy = false) const = 0;
-	virtual void write( std::ofstream &ofs ) const = 0;
-	virtual bool read( std::ifstream &ifs ) = 0;
+	// Builds an explicit copy of A^T in the same storage format as A, so that
+	// multiplying by A^T is as cheap as multiplying by A (used by cga).
+	virtual TsgSparseMatrix* buildTranspose() const = 0;
+	virtual void write( std::ostream &ofs ) const = 0;
+	virtual bool read( std::istream &ifs ) = 0;
+	// compressed stores the index arrays with twriteFrames(), readBinary() detects it
+	virtual void writeBinary( std::ostream &ofs, bool compressed = false ) const = 0;
+	virtual bool readBinary( std::istream &ifs ) = 0;
 	int getNumRows(){return m;};
 	int getNumCols(){return n;};
 	int getNumNonzero(){return nnz;};
-	static TsgSparseMatrix* read_generic( std::ifstream &ifs );
+	virtual size_t getMemoryUsage() const = 0; // bytes of the index and value arrays, owned or used in place
+	virtual bool ownsArrays() const = 0; // false if the arrays belong to someone else, e.g., a memory mapped file
+	static TsgSparseMatrix* read_generic( std::istream &ifs );
+	// reads a matrix written by writeBinary(), the storage format is recorded in the file
+	static TsgSparseMatrix* read_generic_binary( std::istream &ifs );
+	// same as read_generic_binary, but the arrays are used in place (e.g. from a memory mapped file)
+	static TsgSparseMatrix* map_generic_binary( const char* &data, const char *end );
+	// if iterations is not null, it is set to the number of iterations performed
 	TsgCgStatus cg(const double* __restrict b, double* __restrict x,
-			const int max_iter, const double tol = 1e-6) const;
+			const int max_iter, const double tol = 1e-6, int *iterations = 0) const;
 	TsgCgStatus cga(const double* __restrict b, double* __restrict x,
-				const int max_iter, const double tol = 1e-6) const;
+				const int max_iter, const double tol = 1e-6, int *iterations = 0) const;
 
 protected:
+	// reads the arrays that follow the 6 int header written by writeBinary()
+	virtual bool readBinaryArrays( const int header[], std::istream &ifs ) = 0;
+
 	int m;
 	int n;
 	int nnz;
@@ -130,17 +157,22 @@ public:
 	TsgSparseCSC();
 	TsgSparseCSC(TsgSparseCOO &M);
 	TsgSparseMatrix* transpose(bool copy = false) const;
+	TsgSparseMatrix* buildTranspose() const;
 	~TsgSparseCSC();
-	void write(std::ofstream &ofs) const;
-	bool read(std::ifstream &ifs);
+	void write(std::ostream &ofs) const;
+	bool read(std::istream &ifs);
+	void writeBinary(std::ostream &ofs, bool compressed = false) const;
+	bool readBinary(std::istream &ifs);
 	friend class TsgSparseCSR;
 	void matvec(const double* __restrict x, double* __restrict y, bool transpose = false) const;
 	void clear();
+	size_t getMemoryUsage() const;
+	bool ownsArrays() const{ return delete_on_destruction; };
 	TsgSparseCSC(int *row_ind, int *col_ptr, double *val,
 			int m, int n, int nnz, bool copy = false);
 
 protected:
-
+	bool readBinaryArrays(const int header[], std::istream &ifs);
 
 	int *row_ind;
 	int *col_ptr;
@@ -156,17 +188,24 @@ public:
 	TsgSparseCSR(TsgSparseCOO &M);
 	~TsgSparseCSR();
 	TsgSparseMatrix* transpose(bool copy = false) const;
-	void write(std::ofstream &ofs) const;
-	bool read(std::ifstream &ifs);
+	TsgSparseMatrix* buildTranspose() const;
+	void write(std::ostream &ofs) const;
+	bool read(std::istream &ifs);
+	void writeBinary(std::ostream &ofs, bool compressed = false) const;
+	bool readBinary(std::istream &ifs);
 	friend class TsgSparseCSC;
+	friend class TsgSparseLU;
 	void matvec(const double* __restrict x, double* __restrict y, bool transpose = false) const;
 	void clear();
+	size_t getMemoryUsage() const;
+	bool ownsArrays() const{ return delete_on_destruction; };
 
 	TsgSparseCSR(int *col_ind, int *row_ptr, double *val,
 			int m, int n, int nnz, bool copy = false);
 
 
 protected:
+	bool readBinaryArrays(const int header[], std::istream &ifs);
 
 	int *col_ind;
 	int *row_ptr;
@@ -174,12 +213,53 @@ protected:
 	bool delete_on_destruction;
 };
 
+// Sparse LU factorization P*A*P^T = L*U of a square CSR matrix, where P is a user supplied
+// symmetric ordering. Meant for systems that are close to (block) lower-triangular in the
+// given ordering, e.g., hierarchical interpolation matrices with points sorted by level,
+// in which case L carries the bulk of the matrix and U only a few local corrections.
+// No pivoting is performed, factorize() gives up and returns false if a pivot is
+// (relatively) zero, if the fill exceeds max_fill * nnz(A), or if the elimination takes
+// more than max_work * nnz(A) multiply-add operations.
+class TsgSparseLU{
+public:
+	TsgSparseLU();
+	~TsgSparseLU();
+
+	bool factorize(const TsgSparseCSR &A, const int *order, double max_fill, double max_work);
+	void solve(const double* __restrict b, double* __restrict x) const; // A * x = b
+	void solveTransposed(const double* __restrict b, double* __restrict x) const; // A^T * x = b
+
+	bool isFactorized() const;
+	int getNumNonzero() const;
+	size_t getMemoryUsage() const; // bytes of the permutation and the factors
+	void clear();
+
+protected:
+	int n;
+	std::vector<int> perm; // perm[i] is the row/column of A placed at position i
+
+	// both factors are stored in CSR format in the permuted ordering,
+	// L is unit lower triangular (diagonal not stored), the diagonal of U is stored first in each row
+	std::vector<int> l_ptr, l_ind, u_ptr, u_ind;
+	std::vector<double> l_val, u_val;
+};
 
 // Helper linear algebra routines
 double inner_product(const double *x, const double *y, int length );
 void axpby(double alpha, double* __restrict x,
 		double beta, const double* __restrict y, int length);
 double norm(const double *x, const int length, const double type);
+double cg_update(double alpha, double* __restrict x, const double* __restrict p,
+		double* __restrict r, const double* __restrict q, int length);
+
+// Kernels shared by CSR and CSC, "outer" is the compressed dimension (rows for CSR).
+// Both accumulate into y, i.e., y += A * x.
+void compressed_gather(int outer, const int *ptr, const int *ind, const double *val,
+		const double* __restrict x, double* __restrict y);
+void compressed_scatter(int outer, int inner, const int *ptr, const int *ind, const double *val,
+		const double* __restrict x, double* __restrict y);
+void compressed_transpose(int outer, int inner, int nnz, const int *ptr, const int *ind,
+		const double *val, int *t_ptr, int *t_ind, double *t_val);
 
 } /* namespace TasSparse */
 #endif /* TSGSPARSEMATRICES_HPP_ */
@@ -68,15 +68,22 @@ void TensorRule::reset(){
 void TensorRule::rebuild( int dimensions, const int *lindex, OneDRule *inducedRule ){
         num_dimensions = dimensions;
         if ( num_dimensions > 0 ){
-                if ( index != 0 ){ delete index; }; index = new int[num_dimensions];
+                if ( index != 0 ){ delete[] index; }; index = new int[num_dimensions];
                 tcopy( num_dimensions, lindex, index );
                 base = inducedRule;
                 database = 0;
-                if ( points != 0 ){ delete points; };
+                if ( points != 0 ){ delete points; points = 0; };
                 reset();
         }
 }
 
+size_t TensorRule::getMemoryUsage() const{
+        if ( points == 0 ){ return 0; } // not built, e.g., a tensor with zero weight after read()
+        size_t bytes = sizeof(int) * num_dimensions + points->getMemoryUsage();
+        if ( refs != 0 ){ bytes += sizeof(int) * points->getNumIndexes(); }
+        return bytes;
+}
+
 int TensorRule::getNumPoints() const{
         return points->getNumIndexes();
 }
@@ -90,9 +97,11 @@ const int* TensorRule::getPoint( int i ) const{
 }
 
 void TensorRule::getWeights( double* &weights ) const{
+        if ( weights != 0 ){ delete[] weights; }; weights = new double[points->getNumIndexes()];
+        fillWeights( weights );
+}
+void TensorRule::fillWeights( double weights[] ) const{
         int num_points = points->getNumIndexes();
-        if ( weights != 0 ){ delete[] weights; }; weights = new double[num_points];
-
         for( int i=0; i<num_points; i++ ){
                 weights[i] = 1.0;
                 const int *point = points->getIndexList( i );
@@ -103,9 +112,11 @@ void TensorRule::getWeights( double* &weights ) const{
 }
 
 void TensorRule::getInterpolantWeights( const double x[], double* &weights ) const{
+        if ( weights != 0 ){ delete[] weights; }; weights = new double[points->getNumIndexes()];
+        fillInterpolantWeights( x, weights );
+}
+void TensorRule::fillInterpolantWeights( const double x[], double weights[] ) const{
         int num_points = points->getNumIndexes();
-        if ( weights != 0 ){ delete[] weights; }; weights = new double[num_points];
-
         #pragma omp parallel for
         for( int i=0; i<num_points; i++ ){
                 weights[i] = 1.0;
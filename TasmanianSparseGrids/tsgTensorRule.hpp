@@ -43,11 +43,15 @@ public:
         const int* getPoint( int i ) const;
         void getWeights( double* &weights ) const;
         void getInterpolantWeights( const double x[], double* &weights ) const;
+        void fillWeights( double weights[] ) const; // same as getWeights(), but weights is already allocated
+        void fillInterpolantWeights( const double x[], double weights[] ) const;
         
         void referenceValues( const IndexSet *data ); // stores the pointer to the local database
         
         void eval( const double x[], double y[] ) const; // evals the interpolant at x and returns the result in r (call afer load/reference data)
 
+        size_t getMemoryUsage() const; // bytes of the tensor index, the copy of the points and the references to the database
+
 protected:
         void reset();
 
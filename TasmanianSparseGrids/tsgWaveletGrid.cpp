@@ -29,11 +29,11 @@ namespace TasGrid {
 
 WaveletGrid::WaveletGrid() : num_dimensions(0), num_outputs(0), points(0),
 		needed_points(0), solver_tol(1e-12), order(0),
-		interpolation_matrix(0), coefficients(0){}
+		interpolation_matrix(0), interpolation_lu(0), lu_attempted(false), coefficients(0), coefficients_mapped(false){}
 
 WaveletGrid::WaveletGrid( int dimensions, int outputs, int depth, int order) : num_dimensions(0),
 		num_outputs(0), points(0), needed_points(0), solver_tol(1e-12),
-		order(0), interpolation_matrix(0), coefficients(0){
+		order(0), interpolation_matrix(0), interpolation_lu(0), lu_attempted(false), coefficients(0), coefficients_mapped(false){
 //	if(order != 1){ cout << "ERROR: Only Linear (Order = 1) Wavelets supported at this time. Defaulting to linear" << endl; }
 	reset(dimensions, outputs, depth, order);
 }
@@ -43,6 +43,7 @@ WaveletGrid::~WaveletGrid() {
 }
 
 void WaveletGrid::reset( int dimensions, int outputs, int depth, int ord){
+	TSG_PROFILE( profile_construction );
 	clear();
 	num_dimensions = dimensions;  num_outputs = outputs;
 	order = ord;
@@ -50,7 +51,7 @@ void WaveletGrid::reset( int dimensions, int outputs, int depth, int ord){
 
 	points = new IndexSet( num_dimensions, 1, num_outputs );
 	//int root[num_dimensions];
-	std::vector<int> root_vec;
+	std::vector<int> root_vec(num_dimensions);
 	int* root = &root_vec[0];
 	
 	int num_level_zero = rule1D.getNumPoints(0);
@@ -112,7 +113,7 @@ void WaveletGrid::updateOrder(int new_order){
 
 }
 
-void WaveletGrid::write( std::ofstream &ofs ) const{ // write the grid to a file
+void WaveletGrid::write( std::ostream &ofs ) const{ // write the grid to a file
 	ofs << "num_dimensions: " << num_dimensions << endl;
 	ofs << "num_outputs: " << num_outputs << endl;
 	ofs << "order: " << order << endl;
@@ -147,12 +148,11 @@ void WaveletGrid::write( std::ofstream &ofs ) const{ // write the grid to a file
 	}
 }
 
-bool WaveletGrid::read( std::ifstream &ifs ){ // reads the grid
+bool WaveletGrid::read( std::istream &ifs ){ // reads the grid
 	clear();
 	std::string T;
 	ifs >> T; if ( !(T.compare( "num_dimensions:" ) == 0) ){
 		cerr << "ERROR: Wrong File Format! code WG 1" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -160,7 +160,6 @@ bool WaveletGrid::read( std::ifstream &ifs ){ // reads the grid
 
 	ifs >> T; if ( !(T.compare( "num_outputs:" ) == 0) ){
 		cerr << "ERROR: Wrong File Format! code WG 2" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -168,7 +167,6 @@ bool WaveletGrid::read( std::ifstream &ifs ){ // reads the grid
 
 	ifs >> T; if ( !(T.compare( "order:" ) == 0) ){
 		cerr << "ERROR: Wrong File Format! code WG 3" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -177,7 +175,6 @@ bool WaveletGrid::read( std::ifstream &ifs ){ // reads the grid
 
 	ifs >> T; if ( !(T.compare( "Points:" ) == 0) ){
 		cerr << "ERROR: Wrong File Format! code WG 4" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -189,7 +186,6 @@ bool WaveletGrid::read( std::ifstream &ifs ){ // reads the grid
 
 	ifs >> T; if ( !(T.compare( "Needed_Points:" ) == 0) ){
 		cerr << "ERROR: Wrong File Format! code WG 5" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -201,7 +197,6 @@ bool WaveletGrid::read( std::ifstream &ifs ){ // reads the grid
 
 	ifs >> T; if ( !(T.compare( "Surplusses:" ) == 0) ){
 		cerr << "ERROR: Wrong File Format! code WG 6" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -213,7 +208,6 @@ bool WaveletGrid::read( std::ifstream &ifs ){ // reads the grid
 
 	ifs >> T; if ( !(T.compare( "Interpolation_Matrix:" ) == 0) ){
 		cerr << "ERROR: Wrong File Format! code WG 7" << endl;
-		ifs.close();
 		clear();
 		return false;
 	}
@@ -222,13 +216,97 @@ bool WaveletGrid::read( std::ifstream &ifs ){ // reads the grid
 		interpolation_matrix = TasSparse::TsgSparseMatrix::read_generic(ifs);
 		if(interpolation_matrix == 0){
 			cerr << "ERROR: Wrong File Format! code WG 8" << endl;
-			ifs.close();
 			clear();
 			return false;
 		}
 	}
 	return true;
 }
+void WaveletGrid::writeBinary( std::ostream &ofs, bool compressed ) const{
+	int flags[7] = { num_dimensions, num_outputs, order, (points != 0) ? 1 : 0, (needed_points != 0) ? 1 : 0,
+	                 (coefficients != 0) ? 1 : 0, (interpolation_matrix != 0) ? 1 : 0 };
+	twriteBinary( 7, flags, ofs );
+	if ( points != 0 ) points->writeBinary( ofs, compressed );
+	if ( needed_points != 0 ) needed_points->writeBinary( ofs, compressed );
+	if ( coefficients != 0 ) twriteBinary( points->getNumIndexes() * num_outputs, coefficients, ofs );
+	if ( interpolation_matrix != 0 ) interpolation_matrix->writeBinary( ofs, compressed );
+}
+bool WaveletGrid::readBinary( std::istream &ifs ){
+	clear();
+	int flags[7];
+	if ( !treadBinary( 7, flags, ifs ) || ((flags[5] == 1) && (flags[3] == 0)) ){
+		cerr << "ERROR: Wrong File Format! code WG 9" << endl;
+		clear();
+		return false;
+	}
+	num_dimensions = flags[0];
+	num_outputs = flags[1];
+	order = flags[2];
+	rule1D.updateOrder(order);
+
+	bool pass = true;
+	if ( flags[3] == 1 ){
+		points = new IndexSet(1);
+		pass = points->readBinary( ifs );
+	}
+	if ( flags[4] == 1 ){
+		needed_points = new IndexSet(1);
+		pass = pass && needed_points->readBinary( ifs );
+	}
+	if ( pass && (flags[5] == 1) ){
+		coefficients = new double[points->getNumIndexes() * num_outputs];
+		pass = treadBinary( points->getNumIndexes() * num_outputs, coefficients, ifs );
+	}
+	if ( pass && (flags[6] == 1) ){
+		interpolation_matrix = TasSparse::TsgSparseMatrix::read_generic_binary(ifs);
+		pass = (interpolation_matrix != 0);
+	}
+	if ( !pass ){
+		cerr << "ERROR: Wrong File Format! code WG 10" << endl;
+		clear();
+		return false;
+	}
+	return true;
+}
+bool WaveletGrid::mapBinary( const char* &data, const char *end ){
+	clear();
+	const int *flags;
+	if ( !tmapBinary( 7, flags, data, end ) || ((flags[5] == 1) && (flags[3] == 0)) ){
+		cerr << "ERROR: Wrong File Format! code WG 9" << endl;
+		clear();
+		return false;
+	}
+	num_dimensions = flags[0];
+	num_outputs = flags[1];
+	order = flags[2];
+	rule1D.updateOrder(order);
+
+	bool pass = true;
+	if ( flags[3] == 1 ){
+		points = new IndexSet(1);
+		pass = points->mapBinary( data, end );
+	}
+	if ( flags[4] == 1 ){
+		needed_points = new IndexSet(1);
+		pass = pass && needed_points->mapBinary( data, end );
+	}
+	if ( pass && (flags[5] == 1) ){
+		const double *mapped_coefficients;
+		pass = tmapBinary( points->getNumIndexes() * num_outputs, mapped_coefficients, data, end );
+		coefficients = (double*) mapped_coefficients;
+		coefficients_mapped = true;
+	}
+	if ( pass && (flags[6] == 1) ){
+		interpolation_matrix = TasSparse::TsgSparseMatrix::map_generic_binary( data, end );
+		pass = (interpolation_matrix != 0);
+	}
+	if ( !pass ){
+		cerr << "ERROR: Wrong File Format! code WG 10" << endl;
+		clear();
+		return false;
+	}
+	return true;
+}
 
 int WaveletGrid::getNumDimensions() const{ return num_dimensions; }
 int WaveletGrid::getNumOutputs() const{ return num_outputs; };
@@ -239,6 +317,9 @@ int WaveletGrid::getNumPoints() const{ return (points == 0) ? 0 : points->getNum
 void WaveletGrid::getPoints( double* &pnts ) const{
 	if ( pnts != 0 ){ delete[] pnts; }
 	pnts = new double[ num_dimensions * points->getNumIndexes() ];
+	fillPoints( pnts );
+}
+void WaveletGrid::fillPoints( double pnts[] ) const{
 	for( int i=0; i < points->getNumIndexes(); i++ ){
 		const int *point = points->getIndexList(i);
 		for( int j=0; j<num_dimensions; j++ ){
@@ -248,9 +329,12 @@ void WaveletGrid::getPoints( double* &pnts ) const{
 }
 
 void WaveletGrid::getWeights( double* &weights ) const{
-	int num_points = points->getNumIndexes();
 	if ( weights != 0 ){ delete[] weights; }
-	weights = new double[num_points];
+	weights = new double[points->getNumIndexes()];
+	fillWeights( weights );
+}
+void WaveletGrid::fillWeights( double weights[] ) const{
+	int num_points = points->getNumIndexes();
 	#pragma omp parallel for
 	for( int i=0; i<num_points; i++ ){
 		weights[i] = evalIntegral( points->getIndexList(i) );
@@ -260,13 +344,12 @@ void WaveletGrid::getWeights( double* &weights ) const{
 }
 
 void WaveletGrid::getInterpolantWeights( const double x[], double* &weights ) const{
-	int num_points = points->getNumIndexes();
 	if ( weights != 0 ){ delete[] weights; }
-	weights = new double[num_points];
-	#pragma omp parallel for
-	for( int i=0; i<num_points; i++ ){
-			weights[i] = evalBasis( points->getIndexList(i), x );
-	}
+	weights = new double[points->getNumIndexes()];
+	fillInterpolantWeights( x, weights );
+}
+void WaveletGrid::fillInterpolantWeights( const double x[], double weights[] ) const{
+	evalBasisAll( x, weights );
 
 	solveTransposed(weights);
 }
@@ -276,6 +359,9 @@ int WaveletGrid::getNumNeededPoints() const{ return (needed_points == 0) ? 0 : n
 void WaveletGrid::getNeededPoints( double* &pnts ) const{
 	if ( pnts != 0 ){ delete[] pnts; }
 	pnts = new double[ num_dimensions * needed_points->getNumIndexes() ];
+	fillNeededPoints( pnts );
+}
+void WaveletGrid::fillNeededPoints( double pnts[] ) const{
 	for( int i=0; i<needed_points->getNumIndexes(); i++ ){
 			const int *point = needed_points->getIndexList(i);
 			for( int j=0; j<num_dimensions; j++ ){
@@ -316,12 +402,10 @@ void WaveletGrid::loadNeededPoints( const IndexSet *data ){
 }
 
 void WaveletGrid::evaluate( const double x[], double y[] ) const{
+	TSG_PROFILE( profile_evaluate );
 	int num_points = points->getNumIndexes();
 	double *basis_values = new double[num_points];
-	#pragma omp parallel for
-	for( int i=0; i<num_points; i++ ){
-			basis_values[i] = evalBasis( points->getIndexList(i), x );
-	}
+	evalBasisAll( x, basis_values );
 	for( int j=0; j<num_outputs; j++ ){
 			double sum = 0.0;
 			#pragma omp parallel for reduction( + : sum )
@@ -357,6 +441,7 @@ const IndexSet* WaveletGrid::getState() const{
 }
 
 void WaveletGrid::setState( const IndexSet* state ){
+	TSG_PROFILE( profile_refinement );
 	clear();
 
 	num_dimensions = state->getNumDimensions();
@@ -390,6 +475,7 @@ void WaveletGrid::getData( IndexSet* &data ){
 	}
 }
 void WaveletGrid::getUpdateState( IndexSet* &update, double tol, TypeRefinement criteria ) const{
+	TSG_PROFILE( profile_refinement );
 	// implement classical refinement first
 	if ( update != 0 ){ delete update; };
 	update = new IndexSet( num_dimensions, 0, num_outputs );
@@ -412,11 +498,63 @@ void WaveletGrid::getUpdateState( IndexSet* &update, double tol, TypeRefinement
 			}
 	}
 
+	if ( (criteria == refine_direction_selective) || (criteria == refine_fds) ){
+			// unlike the local polynomials, the lifted wavelets are not well posed on sets with missing parents,
+			// a child added in one direction may lack parents in the other directions, add those as well
+			// (fds adds the parents in the refined direction first, but not the ones in the other directions)
+			addMissingParents( update );
+	}
+
 	delete[] map;
 }
+
+void WaveletGrid::addMissingParents( IndexSet *update ) const{
+	/*
+	 * Adds to update the parents (in all directions) of the points in update that are
+	 * neither in points nor in update, repeats until the union of points and update is
+	 * closed with respect to taking parents.
+	 */
+	IndexSet *check = new IndexSet( num_dimensions );
+	check->add( update );
+	while( check->getNumIndexes() > 0 ){
+		IndexSet *missing = new IndexSet( num_dimensions );
+		for( int i=0; i<check->getNumIndexes(); i++ ){
+			for( int j=0; j<num_dimensions; j++ ){
+				addParent( check->getIndexList(i), j, missing, points );
+			}
+		}
+		IndexSet *fresh = new IndexSet( num_dimensions );
+		for( int i=0; i<missing->getNumIndexes(); i++ ){
+			if ( update->getSlot( missing->getIndexList(i) ) == -1 ){
+				fresh->add( missing->getIndexList(i) );
+			}
+		}
+		update->add( fresh );
+		delete missing;
+		delete check;
+		check = fresh;
+	}
+	delete check;
+}
+void WaveletGrid::getMemoryUsage( GridMemory &memory ) const{
+	// the tables of the cubic wavelets are shared by all grids and are not counted
+	memory.addIndexSet( points, memory_index_list, memory_index_map, memory_values );
+	memory.addIndexSet( needed_points, memory_needed_points, memory_needed_points, memory_needed_points );
+	if ( coefficients != 0 ){
+		memory.bytes[ (coefficients_mapped) ? memory_mapped : memory_surplus ] += sizeof(double) * ((size_t) points->getNumIndexes()) * num_outputs;
+	}
+	if ( interpolation_matrix != 0 ){
+		memory.bytes[ (interpolation_matrix->ownsArrays()) ? memory_matrix : memory_mapped ] += interpolation_matrix->getMemoryUsage();
+	}
+	if ( interpolation_lu != 0 ){ memory.bytes[memory_matrix] += interpolation_lu->getMemoryUsage(); }
+}
+
 void WaveletGrid::setUpdate( const IndexSet *update ){
-	if ( coefficients != 0 ){ delete[] coefficients; coefficients = 0; }
+	TSG_PROFILE( profile_refinement );
+	if ( (coefficients != 0) && !coefficients_mapped ){ delete[] coefficients; } coefficients = 0;
 	if ( interpolation_matrix != 0){ delete interpolation_matrix; interpolation_matrix = 0;}
+	if ( interpolation_lu != 0){ delete interpolation_lu; interpolation_lu = 0;}
+	lu_attempted.store( false, std::memory_order_relaxed );
 	if ( needed_points != 0 ){ delete needed_points; needed_points = 0; }
 
 	points->add( update ); //cout << "values " << points->getNumValues() << endl;
@@ -431,6 +569,9 @@ void WaveletGrid::clear(){
 	if ( points != 0 ){ delete points; } points = 0;
 	if ( needed_points != 0 ){ delete needed_points; } needed_points = 0;
 	if (interpolation_matrix != 0){ delete interpolation_matrix; } interpolation_matrix = 0;
+	if (interpolation_lu != 0){ delete interpolation_lu; } interpolation_lu = 0;
+	lu_attempted.store( false, std::memory_order_relaxed );
+	if ( (coefficients != 0) && !coefficients_mapped ){ delete[] coefficients; } coefficients = 0; coefficients_mapped = false;
 	num_dimensions = 0; num_outputs = 0;
 
 }
@@ -443,7 +584,7 @@ void WaveletGrid::addChild( const int point[], int direction, IndexSet *destinat
 	int first, second;
 	rule1D.getChildren( point[direction], first, second );
 	//int kid[num_dimensions];
-	std::vector<int> kid_vec;
+	std::vector<int> kid_vec(num_dimensions);
 	int* kid = &kid_vec[0];
 	
 	tcopy( num_dimensions, point, kid );
@@ -495,10 +636,30 @@ void WaveletGrid::buildInterpolationMatrix(){
 	 * Using the IndexSet points, constructs the interpolation matrix needed for methods
 	 * such as recomputeCoefficients, solveTransposed, etc.
 	 */
+	TSG_PROFILE( profile_matrix );
 	if(interpolation_matrix != 0) { delete interpolation_matrix; }
+	if(interpolation_lu != 0){ delete interpolation_lu; interpolation_lu = 0; }
+	lu_attempted.store( false, std::memory_order_relaxed ); // the new matrix is factored on the first solve
 
 	int num_points = points->getNumIndexes();
 
+	// All points use the same one dimensional rule, tabulate the one dimensional wavelets
+	// at the one dimensional nodes, table[a * num_oned + b] = wavelet a at node b.
+	int num_oned = getMaxOneDIndex() + 1;
+	double *table = 0;
+	if(((long long) num_oned) * num_oned <= WAVELET_MAX_TABLE_SIZE){
+		table = new double[num_oned * num_oned];
+		double *nodes = new double[num_oned];
+		for(int b = 0; b < num_oned; b++){
+			nodes[b] = rule1D.getX(b);
+		}
+		#pragma omp parallel for
+		for(int a = 0; a < num_oned; a++){
+			rule1D.eval(a, nodes, num_oned, &(table[a * num_oned]));
+		}
+		delete[] nodes;
+	}
+
 	TasSparse::TsgSparseCOO coo_mat(num_points, num_points);
 
 //#ifdef _TSG_OMP_ENABLE
@@ -525,9 +686,15 @@ void WaveletGrid::buildInterpolationMatrix(){
 				const int *wavelet = points->getIndexList(j);
 				double v = 1.;
 
-				for(int k = 0; k < num_dimensions; k++){ /* Loop over dimensions */
-					v *= rule1D.eval(wavelet[k], xs[k]);
-				} /* End for dimensions */
+				if(table != 0){
+					for(int k = 0; (k < num_dimensions) && (v != 0.); k++){ /* Loop over dimensions */
+						v *= table[wavelet[k] * num_oned + point[k]];
+					} /* End for dimensions */
+				}else{
+					for(int k = 0; (k < num_dimensions) && (v != 0.); k++){ /* Loop over dimensions */
+						v *= rule1D.eval(wavelet[k], xs[k]);
+					} /* End for dimensions */
+				}
 
 				if(v != 0.){
 				/*
@@ -560,8 +727,68 @@ void WaveletGrid::buildInterpolationMatrix(){
 
 #endif
 	} /* End parallel section */
+	if(table != 0){ delete[] table; }
 	interpolation_matrix = new TasSparse::TsgSparseCSR(coo_mat);
+}
+
+void WaveletGrid::factorInterpolationMatrix() const{
+	/*
+	 * Coarse wavelets do not vanish at the fine nodes, but fine wavelets are mostly zero at
+	 * the coarse ones, hence with the points sorted by level the interpolation matrix is
+	 * nearly block lower-triangular and the LU factors stay sparse. A direct solve is then
+	 * both faster and more predictable than cga. If the fill or the work gets too large,
+	 * the factors are discarded and the solvers fall back to cga.
+	 * The cubic wavelets do not vanish at the coarse nodes, the factors would be nearly dense,
+	 * so they go straight to cga without paying for a factorization that is bound to fail.
+	 */
+	if(interpolation_lu != 0){ delete interpolation_lu; interpolation_lu = 0; }
+	if(order > WAVELET_LU_MAX_ORDER) return;
+
+	TasSparse::TsgSparseCSR *csr = dynamic_cast<TasSparse::TsgSparseCSR*>(interpolation_matrix);
+	if(csr == 0) return;
+
+	int num_points = points->getNumIndexes();
+	int *levels = new int[num_points];
+	int max_level = 0;
+	for(int i = 0; i < num_points; i++){
+		const int *p = points->getIndexList(i);
+		levels[i] = 0;
+		for(int j = 0; j < num_dimensions; j++){
+			levels[i] += rule1D.getLevel(p[j]);
+		}
+		if(levels[i] > max_level) max_level = levels[i];
+	}
 
+	// counting sort by level, the lexicographical order is preserved within each level
+	int *level_start = new int[max_level + 2];
+	tzero(max_level + 2, level_start);
+	for(int i = 0; i < num_points; i++){ level_start[levels[i]+1]++; }
+	for(int l = 0; l <= max_level; l++){ level_start[l+1] += level_start[l]; }
+	int *order = new int[num_points];
+	for(int i = 0; i < num_points; i++){ order[level_start[levels[i]]++] = i; }
+
+	interpolation_lu = new TasSparse::TsgSparseLU();
+	if(!interpolation_lu->factorize(*csr, order, WAVELET_LU_MAX_FILL, WAVELET_LU_MAX_WORK)){
+		delete interpolation_lu;
+		interpolation_lu = 0;
+	}
+
+	delete[] order;
+	delete[] level_start;
+	delete[] levels;
+}
+
+void WaveletGrid::linkFactors() const{
+	// a grid that is only read or mapped and then evaluated never pays for the factorization,
+	// the weights may be requested from many threads, only the first solve needs the lock
+	if(lu_attempted.load(std::memory_order_acquire)) return;
+	#pragma omp critical (tsg_wavelet_link_factors)
+	{
+	if(!lu_attempted.load(std::memory_order_relaxed)){
+		factorInterpolationMatrix();
+		lu_attempted.store(true, std::memory_order_release);
+	}
+	}
 }
 
 void WaveletGrid::recomputeCoefficients(){
@@ -570,10 +797,13 @@ void WaveletGrid::recomputeCoefficients(){
 	 * Make sure buildInterpolationMatrix has been called since the list was updated.
 	 */
 	if(interpolation_matrix == 0){ buildInterpolationMatrix(); }
+	linkFactors();
+	TSG_PROFILE( profile_surplus );
 	//cout << " Computing Surpluses " << endl;
 	int num_points = points->getNumIndexes();
-	if ( coefficients != 0 ){ delete[] coefficients; }
+	if ( (coefficients != 0) && !coefficients_mapped ){ delete[] coefficients; }
 	coefficients = new double[num_points * num_outputs];
+	coefficients_mapped = false;
 
 	double *workspace = new double[2*num_points];
 	double *b = workspace;
@@ -589,7 +819,16 @@ void WaveletGrid::recomputeCoefficients(){
 		}
 
 		// Solve system
-		interpolation_matrix->cga(b, x, num_points, solver_tol);
+		{
+			TSG_PROFILE( profile_solver );
+			if(interpolation_lu != 0){
+				interpolation_lu->solve(b, x);
+			}else{
+				int iterations = 0;
+				interpolation_matrix->cga(b, x, num_points, solver_tol, &iterations);
+				TSG_PROFILE_ITERATIONS( iterations );
+			}
+		}
 
 		// Populate surplus
 		for(int i = 0; i < num_points; i++){
@@ -606,18 +845,28 @@ void WaveletGrid::solveTransposed(double w[]) const{
 	 * weights. RHS values should be passed in through w. At exit, w will contain the
 	 * required weights.
 	 */
-	TasSparse::TsgSparseMatrix *mat = interpolation_matrix->transpose();
-
+	linkFactors();
+	TSG_PROFILE( profile_solver );
 	int num_points = points->getNumIndexes();
 
 	double *y = new double[num_points];
 
 	tcopy(num_points, w, y);
 
+	if(interpolation_lu != 0){
+		interpolation_lu->solveTransposed(y, w);
+		delete[] y;
+		return;
+	}
+
+	TasSparse::TsgSparseMatrix *mat = interpolation_matrix->transpose();
+
 	// Zero out the initial guess
 	tzero(num_points, w);
 
-	TasSparse::TsgCgStatus stat = mat->cga(y, w, num_points, solver_tol);
+	int iterations = 0;
+	TasSparse::TsgCgStatus stat = mat->cga(y, w, num_points, solver_tol, &iterations);
+	TSG_PROFILE_ITERATIONS( iterations );
 	if(stat == TasSparse::max_iter_reached){
 		cerr << "ERROR - solveTransposed: CG did not converge!" << endl;
 	}
@@ -638,6 +887,43 @@ double WaveletGrid::evalBasis( const int p[], const double x[] ) const{
 	return v;
 }
 
+void WaveletGrid::evalBasisAll( const double x[], double basis[] ) const{
+	/*
+	 * Evaluates all basis functions at x. Each one dimensional wavelet is evaluated only
+	 * once per direction, the multidimensional basis is then a product of table entries.
+	 */
+	int num_points = points->getNumIndexes();
+	int num_oned = getMaxOneDIndex() + 1;
+	double *values = new double[num_dimensions * num_oned];
+	for(int k = 0; k < num_dimensions; k++){
+		for(int a = 0; a < num_oned; a++){
+			values[k * num_oned + a] = rule1D.eval(a, x[k]);
+		}
+	}
+	#pragma omp parallel for
+	for(int i = 0; i < num_points; i++){
+		const int *p = points->getIndexList(i);
+		double v = 1.;
+		for(int k = 0; k < num_dimensions; k++){
+			v *= values[k * num_oned + p[k]];
+		}
+		basis[i] = v;
+	}
+	delete[] values;
+}
+
+int WaveletGrid::getMaxOneDIndex() const{
+	int num_points = points->getNumIndexes();
+	int m = 0;
+	for(int i = 0; i < num_points; i++){
+		const int *p = points->getIndexList(i);
+		for(int k = 0; k < num_dimensions; k++){
+			if(p[k] > m) m = p[k];
+		}
+	}
+	return m;
+}
+
 bool WaveletGrid::has_children(const int point[], IndexSet *set) const{
 	/*
 	 * Returns true if the given set has all the children of the specified point, false
@@ -683,12 +969,7 @@ void WaveletGrid::buildUpdateMap( int* &map, double tol, TypeRefinement criteria
 	double *norm = 0;
         computeOutputNormalization( norm );
 
-	if ( criteria != refine_classic ){
-		cout << "WARNING: Refinements other than classical not yet implemented. Defaulting to classical." << endl;
-		criteria = refine_classic;
-	}
-
-	if ( (criteria == refine_classic)  ){
+	if ( (criteria == refine_classic) || (criteria == refine_parents_first) ){
 
 //		double *rel_scale = new double[num_outputs];
 //		tzero(num_outputs, rel_scale);
@@ -877,10 +1158,115 @@ void WaveletGrid::buildUpdateMap( int* &map, double tol, TypeRefinement criteria
 				for( int j=0; j<num_dimensions; j++ ){ map[i*num_dimensions + j] = 1; }
 			}
 		}
+	}else{
+		// direction selective, a point is refined in direction d only if the values on the
+		// line through the point in direction d have a large one dimensional coefficient
+		for( int s=0; s<num_points; s++ ){
+			for( int d=0; d<num_dimensions; d++ ){
+				if ( map[s*num_dimensions + d] == 0 ){
+					const int *point = points->getIndexList( s );
+					// count the number of points on the line
+					int count = 0;
+					for( int i=0; i<num_points; i++ ){
+						count += sameLine( point, points->getIndexList(i), d ) ? 1 : 0;
+					}
+
+					int *pnts = new int[count];
+					count = 0;
+					for( int i=0; i<num_points; i++ ){
+						if ( sameLine( point, points->getIndexList(i), d ) ){
+							pnts[count++] = i;
+						}
+					}
+
+					double *vals = new double[count * num_outputs];
+					computeLineCoefficients( count, pnts, d, vals );
+
+					for( int i=0; i<count; i++ ){
+						bool refine = false;
+						for( int j=0; j<num_outputs; j++ ){
+							refine = refine || ( (fabs( vals[i*num_outputs + j] ) / norm[j] > tol) && (fabs( coefficients[pnts[i]*num_outputs + j] ) / norm[j] > tol) );
+						}
+						if ( refine ){
+							map[pnts[i]*num_dimensions + d] = 1;
+						}else{
+							map[pnts[i]*num_dimensions + d] = -1;
+						}
+					}
+
+					delete[] pnts;
+					delete[] vals;
+				}
+			}
+		}
 	}
 	delete[] norm;
 }
 
+void WaveletGrid::computeLineCoefficients( int count, const int pnts[], int direction, double coeff[] ) const{
+	/*
+	 * Given count points that lie on the same line in the given direction, computes the
+	 * coefficients of the one dimensional wavelet interpolant of the values along the line.
+	 * The result has the same layout as the coefficients, i.e., coeff[i*num_outputs + k].
+	 * The one dimensional system is solved as in recomputeCoefficients(), with points
+	 * ordered by level and a direct solver, or cga if the factorization is not feasible.
+	 */
+	int *oned = new int[count];
+	int *levels = new int[count];
+	int max_level = 0;
+	for( int i=0; i<count; i++ ){
+		oned[i] = points->getIndexList( pnts[i] )[direction];
+		levels[i] = rule1D.getLevel( oned[i] );
+		if ( levels[i] > max_level ) max_level = levels[i];
+	}
+
+	TasSparse::TsgSparseCOO coo_mat( count, count );
+	for( int i=0; i<count; i++ ){
+		double x = rule1D.getX( oned[i] );
+		for( int j=0; j<count; j++ ){
+			double v = rule1D.eval( oned[j], x );
+			if ( v != 0. ) coo_mat.addPoint( i, j, v );
+		}
+	}
+	TasSparse::TsgSparseCSR mat( coo_mat );
+
+	int *order = new int[count];
+	int c = 0;
+	for( int l=0; l<=max_level; l++ ){
+		for( int i=0; i<count; i++ ){
+			if ( levels[i] == l ) order[c++] = i;
+		}
+	}
+
+	TasSparse::TsgSparseLU lu;
+	bool direct = lu.factorize( mat, order, WAVELET_LU_MAX_FILL, WAVELET_LU_MAX_WORK );
+
+	double *b = new double[2*count];
+	double *x = b + count;
+	for( int k=0; k<num_outputs; k++ ){
+		for( int i=0; i<count; i++ ){
+			b[i] = points->getValueList( pnts[i] )[k];
+		}
+		TSG_PROFILE( profile_solver );
+		if ( direct ){
+			lu.solve( b, x );
+		}else{
+			tzero( count, x );
+			int iterations = 0;
+			mat.cga( b, x, count, solver_tol, &iterations );
+			TSG_PROFILE_ITERATIONS( iterations );
+		}
+		for( int i=0; i<count; i++ ){
+			coeff[i*num_outputs + k] = x[i];
+		}
+	}
+
+	delete[] b;
+	delete[] order;
+	delete[] levels;
+	delete[] oned;
+}
+
 bool WaveletGrid::sameLine(const int a[], const int b[], int direction) const{
 	for( int i=0; i<num_dimensions; i++ ){
 		if ( (i != direction) && (a[i] != b[i]) ) return false;
@@ -35,6 +35,7 @@
 #include "tsgSparseMatrices.hpp"
 
 #include <vector>
+#include <atomic>
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -59,17 +60,24 @@ public:
         TypeOneDRule getOneDRule() const;
         const char *getOneDRuleDescription() const;
 
-        void write( std::ofstream &ofs ) const; // write the grid to a file
-        bool read( std::ifstream &ifs ); // reads the grid
+        void write( std::ostream &ofs ) const; // write the grid to a file
+        bool read( std::istream &ifs ); // reads the grid
+        void writeBinary( std::ostream &ofs, bool compressed ) const;
+        bool readBinary( std::istream &ifs );
+        bool mapBinary( const char* &data, const char *end );
 
         int getNumPoints() const;
 
         void getPoints( double* &pnts ) const;
         void getWeights( double* &weights ) const;
         void getInterpolantWeights( const double x[], double* &weights ) const;
+        void fillPoints( double pnts[] ) const;
+        void fillWeights( double weights[] ) const;
+        void fillInterpolantWeights( const double x[], double weights[] ) const;
 
         int getNumNeededPoints() const;
         void getNeededPoints( double* &pnts ) const;
+        void fillNeededPoints( double pnts[] ) const;
         void loadNeededPoints( const double vals[] );
         void loadNeededPoints( const IndexSet *data );
 
@@ -84,6 +92,8 @@ public:
         void getUpdateState( IndexSet* &update, double tol, TypeRefinement criteria ) const; // give the new set of points or tensors
         void setUpdate( const IndexSet *update ); // creates a grid with the data updates
 
+        void getMemoryUsage( GridMemory &memory ) const;
+
 protected:
         void clear();
 
@@ -91,22 +101,30 @@ protected:
         // adds children in direction to destination only if they are not part of exclude
         bool addParent( const int point[], int direction, IndexSet *destination, IndexSet *exclude = 0 ) const;
         // adds the parent if it has not been excluded and returns true if anything has been added
+        void addMissingParents( IndexSet *update ) const;
+        // adds the parents of the points in update that are not present in either points or update
 
         void recomputeCoefficients();
         void solveTransposed(double w[]) const;
 
         double evalBasis( const int p[], const double x[] ) const;
+        void evalBasisAll( const double x[], double basis[] ) const; // basis[i] = evalBasis( points->getIndexList(i), x )
+        int getMaxOneDIndex() const; // the largest one dimensional index used by any point
         double evalIntegral( const int p[] ) const;
 
         // the map has dimensions num_points x num_dimensions, for each point and each direction, it flags wheather it should be refined or not
         void buildUpdateMap( int* &map, double tol, TypeRefinement criteria ) const; // use int for the map so we can flag more than true/false (-1 do not refine, 0 not set, 1 refine)
 
         bool sameLine( const int a[], const int b[], int direction ) const;
+        // computes the one dimensional wavelet coefficients of the values on a line of count points
+        void computeLineCoefficients( int count, const int pnts[], int direction, double coeff[] ) const;
 
         // returns the L-\infty norm in each direction, if the norm is less than a tolerance, it is replaced by 1 indicating that we will work with absolute error in that direction
         void computeOutputNormalization( double* &norm ) const;
 
         void buildInterpolationMatrix();
+        void factorInterpolationMatrix() const; // sparse LU with points ordered by level, leaves interpolation_lu = 0 if not feasible
+        void linkFactors() const; // factors the matrix on the first solve, evaluating the coefficients never needs the LU
 
         bool has_children(const int point[], IndexSet *set) const;
 
@@ -116,8 +134,11 @@ private:
         int num_dimensions, num_outputs, order;
 
         double *coefficients;
+        bool coefficients_mapped; // the coefficients belong to a memory mapped file, do not delete them
 
         TasSparse::TsgSparseMatrix *interpolation_matrix;
+        mutable TasSparse::TsgSparseLU *interpolation_lu;
+        mutable std::atomic<bool> lu_attempted; // set after factorInterpolationMatrix(), lets linkFactors() skip the lock
 
         IndexSet *points;
         IndexSet *needed_points;
@@ -24,7 +24,9 @@
 #include <pyublas/numpy.hpp>
 #include <tuple>
 #include <string>
+#include <sstream>
 #include <vector>
+#include <algorithm>
 
 using namespace TasGrid;
 namespace bpl = boost::python;
@@ -60,7 +62,59 @@ dPyArr double_carray_to_dPyArr(int n, const double* p) {
   return result;
 }
 
+// C-contiguous arrays are used in place, anything else is copied into buffer
+const double* dPyArr_data(dPyArr const &a, vector<double> &buffer) {
+  if (a.size() > 0 && PyArray_ISCARRAY_RO((PyArrayObject*) a.array().handle().get())) {
+    return a.array().data();
+  }
+  buffer.assign(a.begin(), a.end());
+  buffer.push_back(0.0); // never empty, so &buffer[0] is valid
+  return &buffer[0];
+}
+
+// releases the GIL while in scope, no Python objects may be touched meanwhile
+// other Python threads keep running, but they must not use the same grid until the call returns
+class release_gil {
+public:
+  release_gil() : state(PyEval_SaveThread()) {}
+  ~release_gil() { PyEval_RestoreThread(state); }
+private:
+  PyThreadState *state;
+};
+
+// number of points in x, either one point of size dims or an (n, dims) array
+int num_batch_points(dPyArr const &x, int dims) {
+  if (x.ndim() == 2) {
+    bpl_assert(x.dims()[1] == dims, "x must have shape (n, dimensions)");
+    return (int) x.dims()[0];
+  }
+  bpl_assert(x.ndim() == 1 && x.size() == dims, "x must have shape (n, dimensions)");
+  return 1;
+}
+
+// model for sample_cfunc(), fills y (num_x by outputs) with the values at x (num_x by dimensions)
+// it is called from several threads at once and must be thread safe
+typedef void (*tsg_model_fn)(int num_x, int dimensions, const double x[], int outputs, double y[]);
+
 class TSG_Wrap : public TasmanianSparseGrid {
+  // fills the needed points with sampler(n, points, values) and refines until no points are needed or max_iterations is reached
+  template <class Sampler>
+  int sample_loop(Sampler sampler, double tolerance, TypeRefinement criteria, int max_iterations) {
+    int dims = this->getNumDimensions(), outputs = this->getNumOutputs();
+	int iterations = 0;
+	while (this->getNumNeededPoints() > 0 && iterations < max_iterations) {
+	  int n = this->getNumNeededPoints();
+	  vector<double> pnts((size_t) n * dims), vals((size_t) n * outputs);
+	  this->fillNeededPoints(&pnts[0]);
+	  sampler(n, &pnts[0], &vals[0]);
+	  release_gil nogil;
+	  this->loadNeededPoints(&vals[0]);
+	  if (tolerance > 0.0) this->setRefinement(tolerance, criteria);
+	  iterations++;
+	}
+	return iterations;
+  }
+  
 public:
   void make_global_grid(int dimensions, int outputs, int depth, TypeDepth type, TypeOneDRule oned, iPyArr const &a_weights, double alpha, double beta) {
     double alpha_beta[2] = {alpha, beta};
@@ -72,43 +126,83 @@ public:
 	  std::copy(a_weights.begin(), a_weights.end(), a_weights2.begin());
 	  a_weights3 = &a_weights2[0];
 	}
+    release_gil nogil;
     this->makeGlobalGrid(dimensions, outputs, depth, type, oned, a_weights3, alpha_beta);
   }
   
+  void make_local_polynomial_grid(int dimensions, int outputs, int depth, int order, TypeOneDRule boundary) {
+    release_gil nogil;
+    this->makeLocalPolynomialGrid(dimensions, outputs, depth, order, boundary);
+  }
+  
+  void make_wavelet_grid(int dimensions, int outputs, int depth, int order) {
+    release_gil nogil;
+    this->makeWaveletGrid(dimensions, outputs, depth, order);
+  }
+  
   void make_full_tensor_grid(int dimensions, int outputs, iPyArr order, TypeOneDRule oned, double alpha, double beta) {
     bpl_assert(dimensions == order.size(), "dimensions should equal len(order)");
     double alpha_beta[2] = {alpha, beta};
 	vector<int> order2(order.begin(), order.end());
+    release_gil nogil;
     this->makeFullTensorGrid(dimensions, outputs, &order2[0], oned, alpha_beta);
   }
   
   void recycle_global_grid(int depth, TypeDepth type) {
+    release_gil nogil;
     this->recycleGlobalGrid(depth, type);
   }
 
+  void recycle_local_polynomial_grid(int depth, int order) {
+    release_gil nogil;
+    this->recycleLocalPolynomialGrid(depth, order);
+  }
+
+  void recycle_wavelet_grid(int depth, int order) {
+    release_gil nogil;
+    this->recycleWaveletGrid(depth, order);
+  }
+
   void recycle_full_tensor_grid(iPyArr order) {
     vector<int> order2(order.begin(), order.end());
+    release_gil nogil;
     this->recycleFullTensorGrid(&order2[0]);
   }
   
-/*  
-  std::string write_string() const {
+  // the string holds the same bytes as the file written by write_file()
+  std::string write_string(bool binary, bool compressed) const {
     std::ostringstream result;
-	this->write(result);
-	return result;
+	this->write(result, binary, compressed);
+	return result.str();
   }
   
+  // text or binary is detected, the grid is read from the string in place
   bool read_string(std::string const &s) {
-    std::istringstream source(s);
-	return this->read(source);
+	return this->readBuffer(s.data(), s.size());
   }
-*/  
-  void write_file(std::string const &filename) const {
-    this->write(filename.c_str());
+  
+  // the grid is placed in a named shared memory segment, other processes attach to it with read_shared()
+  bool write_shared(std::string const &name) const {
+    release_gil nogil;
+    return this->writeShared(name.c_str());
   }
   
-  bool read_file(std::string const &filename) {
-    return this->read(filename.c_str());
+  // the segment is mapped read-only and shared by all processes that attach to it
+  bool read_shared(std::string const &name) {
+    release_gil nogil;
+    return this->readShared(name.c_str());
+  }
+  
+  // compressed = True writes a smaller binary file that cannot be memory mapped
+  void write_file(std::string const &filename, bool binary, bool compressed) const {
+    release_gil nogil;
+    this->write(filename.c_str(), binary, compressed);
+  }
+  
+  // memory_map = True maps a binary grid file read-only, processes that map the same file share its pages
+  bool read_file(std::string const &filename, bool memory_map) {
+    release_gil nogil;
+    return this->read(filename.c_str(), memory_map);
   }
   
   void set_transform_AB(dPyArr const &a_array, dPyArr const &b_array) {
@@ -126,53 +220,54 @@ public:
 	this->getTransformAB(a, b);
 	result[0] = double_carray_to_dPyArr(dims, a);
 	result[1] = double_carray_to_dPyArr(dims, b);
-	delete a;
-	delete b;
+	delete[] a;
+	delete[] b;
 	return result;
   }
   
+  // the library writes directly into the numpy array
   dPyArr get_points() const {
-    int dims = this->getNumDimensions();
-	int n_points = this->getNumPoints();
-	int array_dims[] = {n_points, dims};	
-	double* output = NULL;
-	this->getPoints(output);
-	dPyArr result = double_carray_to_dPyArr(dims*n_points, output);
-	delete output;
-	result.reshape(2, array_dims);
+	npy_intp array_dims[] = {this->getNumPoints(), this->getNumDimensions()};
+	dPyArr result(2, array_dims);
+	if (array_dims[0] > 0) this->fillPoints(result.array().data());
 	return result;
   }
   
   dPyArr get_weights() const {
-    int n_points = this->getNumPoints();
-	double* output = NULL;
-	this->getWeights(output);
-	dPyArr result = double_carray_to_dPyArr(n_points, output);
-	delete output;
+	dPyArr result(this->getNumPoints());
+	if (result.size() > 0) this->fillWeights(result.array().data());
 	return result;
   }
   
   dPyArr get_interpolant_weights(dPyArr const &x) const {
-    int n_points = this->getNumPoints();
-    vector<double> x2(x.begin(), x.end());
-	double* output = NULL;
-	this->getInterpolantWeights(&x2[0], output);
-	dPyArr result = double_carray_to_dPyArr(n_points, output);
-	delete output;
+    bpl_assert(x.size() == this->getNumDimensions(), "x has wrong size");
+    vector<double> buffer;
+	dPyArr result(this->getNumPoints());
+	if (result.size() > 0) this->fillInterpolantWeights(dPyArr_data(x, buffer), result.array().data());
+	return result;
+  }
+  
+  // x is (n, dimensions), row i of the result holds the interpolant weights at x[i]
+  dPyArr get_interpolant_weights_batch(dPyArr const &x) const {
+    int n = num_batch_points(x, this->getNumDimensions());
+    vector<double> buffer;
+    const double *px = dPyArr_data(x, buffer);
+	npy_intp array_dims[] = {n, this->getNumPoints()};
+	dPyArr result(2, array_dims);
+	double *weights = result.array().data();
+	if (n > 0 && array_dims[1] > 0) {
+	  release_gil nogil;
+	  this->fillInterpolantWeightsBatch(px, n, weights);
+	}
 	return result;
   }
   
   dPyArr get_needed_points() const {
-    int dims = this->getNumDimensions();
-	int n_points = this->getNumNeededPoints();
-	int array_dims[] = {n_points, dims};	
-	double* output = NULL;
-	this->getNeededPoints(output);
+	npy_intp array_dims[] = {this->getNumNeededPoints(), this->getNumDimensions()};
 	dPyArr result;
-	if (output != NULL) {
-	  result = double_carray_to_dPyArr(dims*n_points, output);
-	  delete output;
-	  result.reshape(2, array_dims);
+	if (array_dims[0] > 0) {
+	  result = dPyArr(2, array_dims);
+	  this->fillNeededPoints(result.array().data());
 	}
 	return result;
   }
@@ -181,25 +276,159 @@ public:
     int outputs = this->getNumOutputs();
 	int n_points = this->getNumNeededPoints();
     bpl_assert(vals.size() == outputs*n_points, "vals has wrong size");
-    vector<double> vals2(vals.begin(), vals.end());
-    this->loadNeededPoints(&vals2[0]);
+    vector<double> buffer;
+    const double *pvals = dPyArr_data(vals, buffer);
+    release_gil nogil;
+    this->loadNeededPoints(pvals);
+  }
+
+  // values for one needed point, appended to the log opened with open_value_log()
+  bool load_needed_values(int index, dPyArr const &vals) {
+    bpl_assert(vals.size() == this->getNumOutputs(), "vals has wrong size");
+    vector<double> buffer;
+    return this->loadNeededValues(index, dPyArr_data(vals, buffer));
+  }
+
+  bool open_value_log(std::string const &filename) {
+    return this->openValueLog(filename.c_str());
   }
 
   dPyArr evaluate_wrap(dPyArr const &x) const {
-    vector<double> x2(x.begin(), x.end());
+    bpl_assert(x.size() == this->getNumDimensions(), "x has wrong size");
+    vector<double> buffer;
     dPyArr result(this->getNumOutputs());
-    this->evaluate(&x2[0], &result[0]);	
+    this->evaluate(dPyArr_data(x, buffer), result.array().data());
+	return result;
+  }
+  
+  // x is (n, dimensions), the result is (n, outputs), the points are evaluated in parallel without the GIL
+  dPyArr evaluate_batch(dPyArr const &x) const {
+    int n = num_batch_points(x, this->getNumDimensions());
+    vector<double> buffer;
+    const double *px = dPyArr_data(x, buffer);
+	npy_intp array_dims[] = {n, this->getNumOutputs()};
+	dPyArr result(2, array_dims);
+	double *y = result.array().data();
+	if (n > 0 && array_dims[1] > 0) {
+	  release_gil nogil;
+	  this->evaluateBatch(px, n, y);
+	}
 	return result;
   }
   
+  // model(x) gets an (m, dimensions) array of at most chunk_size needed points and returns the (m, outputs) values
+  // the chunks are dispatched with pool.map(model, chunks), e.g. for a multiprocessing.Pool or a concurrent.futures
+  // executor, or evaluated in order if pool is None; tolerance = 0 loads the current needed points without refinement
+  // returns the number of refinement iterations
+  int sample(bpl::object model, double tolerance, TypeRefinement criteria, int chunk_size, bpl::object pool, int max_iterations) {
+    int dims = this->getNumDimensions(), outputs = this->getNumOutputs();
+    bpl_assert(outputs > 0, "the grid has no outputs");
+    bpl_assert(chunk_size > 0, "chunk_size must be positive");
+	auto python_sampler = [&](int n, const double *pnts, double *vals) {
+	  bpl::list chunks;
+	  for (int s=0; s<n; s+=chunk_size) {
+		npy_intp array_dims[] = {std::min(chunk_size, n - s), dims};
+		dPyArr chunk(2, array_dims);
+		std::copy(pnts + (size_t) s * dims, pnts + (size_t) (s + array_dims[0]) * dims, chunk.array().data());
+		chunks.append(chunk);
+	  }
+	  bpl::list results;
+	  if (pool.is_none()) {
+		for (int c=0; c<bpl::len(chunks); c++) results.append(model(chunks[c]));
+	  } else {
+		results = bpl::list(pool.attr("map")(model, chunks));
+	  }
+	  bpl_assert(bpl::len(results) == bpl::len(chunks), "pool.map() returned the wrong number of chunks");
+	  for (int c=0, s=0; s<n; c++, s+=chunk_size) {
+		bpl::extract<dPyArr> y(results[c]);
+		bpl_assert(y.check(), "model must return an array of floats");
+		dPyArr y_arr = y();
+		bpl_assert(y_arr.size() == std::min(chunk_size, n - s) * outputs, "model returned the wrong number of values");
+		std::copy(y_arr.begin(), y_arr.end(), vals + (size_t) s * outputs);
+	  }
+	};
+	return sample_loop(python_sampler, tolerance, criteria, max_iterations);
+  }
+  
+  // same as sample(), but model is the address of a tsg_model_fn, e.g. from ctypes or a numba cfunc
+  // the chunks are split between the OpenMP threads and the GIL is released
+  int sample_cfunc(size_t address, double tolerance, TypeRefinement criteria, int chunk_size, int max_iterations) {
+    int dims = this->getNumDimensions(), outputs = this->getNumOutputs();
+    bpl_assert(outputs > 0, "the grid has no outputs");
+    bpl_assert(chunk_size > 0, "chunk_size must be positive");
+    bpl_assert(address != 0, "model is a null pointer");
+	tsg_model_fn model = (tsg_model_fn) address;
+	auto c_sampler = [&](int n, const double *pnts, double *vals) {
+	  release_gil nogil;
+	  int num_chunks = (n + chunk_size - 1) / chunk_size;
+	  #pragma omp parallel for schedule(dynamic)
+	  for (int c=0; c<num_chunks; c++) {
+		size_t s = (size_t) c * chunk_size;
+		model(std::min(chunk_size, n - (int) s), dims, pnts + s * dims, outputs, vals + s * outputs);
+	  }
+	};
+	return sample_loop(c_sampler, tolerance, criteria, max_iterations);
+  }
+  
   dPyArr integrate_wrap() const {
     dPyArr result(this->getNumOutputs());
-    this->integrate(&result[0]);	
+	if (result.size() > 0) {
+	  double *y = result.array().data();
+	  release_gil nogil;
+	  this->integrate(y);
+	}
+	return result;
+  }
+  
+  void set_refinement(double tolerance, TypeRefinement criteria) {
+    release_gil nogil;
+    this->setRefinement(tolerance, criteria);
+  }
+
+  // getProfile() as a dict, the name of each phase maps to (calls, seconds)
+  bpl::dict get_profile() const {
+    GridProfile profile = this->getProfile();
+	bpl::dict result;
+	for (int i = 0; i < profile_num_phases; i++) {
+	  result[getProfilePhaseName((TypeProfilePhase) i)] = bpl::make_tuple(profile.count[i], profile.seconds[i]);
+	}
+	result["solver_iterations"] = profile.solver_iterations;
+	result["enabled"] = profile.enabled;
+	return result;
+  }
+
+  // getMemoryUsage() as a dict, the name of each component maps to bytes, "total" excludes the mapped data
+  bpl::dict get_memory_usage() const {
+    GridMemory memory = this->getMemoryUsage();
+	bpl::dict result;
+	for (int i = 0; i < memory_num_components; i++) {
+	  result[getMemoryComponentName((TypeMemoryComponent) i)] = (unsigned long long) memory.bytes[i];
+	}
+	result["total"] = (unsigned long long) memory.getTotal();
 	return result;
   }
     
 };
 
+// the pickled state is the compressed binary format, as bytes
+struct TSG_pickle_suite : bpl::pickle_suite {
+  static bpl::object getstate(TSG_Wrap const &grid) {
+    char *buffer = NULL;
+	size_t length = 0;
+	grid.writeBuffer(buffer, length, true);
+	bpl::object state(bpl::handle<>(PyBytes_FromStringAndSize(buffer, (Py_ssize_t) length)));
+	delete[] buffer;
+	return state;
+  }
+  
+  static void setstate(TSG_Wrap &grid, bpl::object state) {
+    char *buffer = NULL;
+	Py_ssize_t length = 0;
+	bpl_assert(PyBytes_Check(state.ptr()) && PyBytes_AsStringAndSize(state.ptr(), &buffer, &length) == 0, "the state of a TSG must be bytes");
+	bpl_assert(grid.readBuffer(buffer, (size_t) length), "the state does not hold a valid grid");
+  }
+};
+
 BOOST_PYTHON_MODULE(_py_tsg)
 {
   bpl::to_python_converter<dPyArrVector, forward_iterable_to_list<dPyArrVector>>();
@@ -207,10 +436,6 @@ BOOST_PYTHON_MODULE(_py_tsg)
   // functions that don't need a wrapper
 // getVersion()
 // getLicense()
-// makeLocalPolynomialGrid
-// makeWaveletGrid
-// recycleLocalPolynomialGrid
-// recycleWaveletGrid
 // clearTransformAB
 // getNumDimensions
 // getNumOutputs
@@ -219,23 +444,27 @@ BOOST_PYTHON_MODULE(_py_tsg)
 // getNumPoints
 // getNumNeededPoints
 // printStats
-// setRefinement
 
   bpl::class_<TSG_Wrap, boost::noncopyable>("TSG", bpl::init<>())
 		.def("get_version", &TSG_Wrap::getVersion)
 		.def("get_license", &TSG_Wrap::getLicense)
 		.def("make_global_grid", &TSG_Wrap::make_global_grid)
-		.def("make_local_polynomial_grid", &TSG_Wrap::makeLocalPolynomialGrid)
-		.def("make_wavelet_grid", &TSG_Wrap::makeWaveletGrid)
+		.def("make_local_polynomial_grid", &TSG_Wrap::make_local_polynomial_grid)
+		.def("make_wavelet_grid", &TSG_Wrap::make_wavelet_grid)
 		.def("make_full_tensor_grid", &TSG_Wrap::make_full_tensor_grid)
 		.def("recycle_global_grid", &TSG_Wrap::recycle_global_grid)
-		.def("recycle_local_polynomial_grid", &TSG_Wrap::recycleLocalPolynomialGrid)
-		.def("recycle_wavelet_grid", &TSG_Wrap::recycleWaveletGrid)
+		.def("recycle_local_polynomial_grid", &TSG_Wrap::recycle_local_polynomial_grid)
+		.def("recycle_wavelet_grid", &TSG_Wrap::recycle_wavelet_grid)
 		.def("recycle_full_tensor_grid", &TSG_Wrap::recycle_full_tensor_grid)
-		//.def("write_string", &TSG_Wrap::write_string)
-		//.def("read_string", &TSG_Wrap::read_string)
-		.def("write_file", &TSG_Wrap::write_file)
-		.def("read_file", &TSG_Wrap::read_file)
+		.def("write_string", &TSG_Wrap::write_string, (bpl::arg("binary")=false, bpl::arg("compressed")=false))
+		.def("read_string", &TSG_Wrap::read_string)
+		.def("write_file", &TSG_Wrap::write_file, (bpl::arg("filename"), bpl::arg("binary")=false, bpl::arg("compressed")=false))
+		.def("read_file", &TSG_Wrap::read_file, (bpl::arg("filename"), bpl::arg("memory_map")=false))
+		.def("write_shared", &TSG_Wrap::write_shared)
+		.def("read_shared", &TSG_Wrap::read_shared)
+		.def("remove_shared", &TSG_Wrap::removeShared)
+		.staticmethod("remove_shared")
+		.def_pickle(TSG_pickle_suite())
 		.def("set_transform_AB", &TSG_Wrap::set_transform_AB)
 		.def("clear_transform_AB", &TSG_Wrap::clearTransformAB)		
 		.def("get_transform_AB", &TSG_Wrap::get_transform_AB)		
@@ -247,13 +476,24 @@ BOOST_PYTHON_MODULE(_py_tsg)
 		.def("get_points", &TSG_Wrap::get_points)				
 		.def("get_weights", &TSG_Wrap::get_weights)				
 		.def("get_interpolant_weights", &TSG_Wrap::get_interpolant_weights)				
+		.def("get_interpolant_weights_batch", &TSG_Wrap::get_interpolant_weights_batch)
 		.def("get_num_needed_points", &TSG_Wrap::getNumNeededPoints)				
 		.def("get_needed_points", &TSG_Wrap::get_needed_points)				
 		.def("load_needed_points", &TSG_Wrap::load_needed_points)				
+		.def("open_value_log", &TSG_Wrap::open_value_log)
+		.def("load_needed_values", &TSG_Wrap::load_needed_values)
+		.def("get_num_logged_values", &TSG_Wrap::getNumLoggedValues)
+		.def("close_value_log", &TSG_Wrap::closeValueLog)
 		.def("evaluate", &TSG_Wrap::evaluate_wrap)				
+		.def("evaluate_batch", &TSG_Wrap::evaluate_batch)
 		.def("integrate", &TSG_Wrap::integrate_wrap)				
 		.def("print_stats", &TSG_Wrap::printStats)				
-		.def("set_refinement", &TSG_Wrap::setRefinement)	
+		.def("get_profile", &TSG_Wrap::get_profile)
+		.def("clear_profile", &TSG_Wrap::clearProfile)
+		.def("get_memory_usage", &TSG_Wrap::get_memory_usage)
+		.def("set_refinement", &TSG_Wrap::set_refinement)	
+		.def("sample", &TSG_Wrap::sample, (bpl::arg("model"), bpl::arg("tolerance"), bpl::arg("criteria"), bpl::arg("chunk_size")=1024, bpl::arg("pool")=bpl::object(), bpl::arg("max_iterations")=100))
+		.def("sample_cfunc", &TSG_Wrap::sample_cfunc, (bpl::arg("model"), bpl::arg("tolerance"), bpl::arg("criteria"), bpl::arg("chunk_size")=1024, bpl::arg("max_iterations")=100))
   ;
   
   bpl::enum_<TypeOneDRule>("TypeOneDRule")